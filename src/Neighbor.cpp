@@ -26,16 +26,16 @@
 static const std::string _module_id("$Id$");
 
 Neighbor::Neighbor(void) :
-  cell(0), nb1(0), nb2(0) {}
+  cell(0), nb1(0), nb2(0), ring_pos(-1) {}
 
 Neighbor::Neighbor(Cell* c, Node* n1, Node* n2) :
-  cell(c), nb1(n1), nb2(n2) {}
+  cell(c), nb1(n1), nb2(n2), ring_pos(-1) {}
 
 Neighbor::Neighbor(const Neighbor& src) :
-  cell(src.cell), nb1(src.nb1), nb2(src.nb2) {} // copy constructor
+  cell(src.cell), nb1(src.nb1), nb2(src.nb2), ring_pos(src.ring_pos) {} // copy constructor
 
 bool Neighbor::CellEquals(int i) const { return cell->Index() == i; }
-bool Neighbor::Cmp(Neighbor& c) const { return cell->Index() < c.cell->Index(); } // Compare cell indices not pointers.
+bool Neighbor::Cmp(const Neighbor& c) const { return cell->Index() < c.cell->Index(); } // Compare cell indices not pointers.
 bool Neighbor::Eq(Neighbor& c) const { return cell->Index() == c.cell->Index(); }
 Cell* Neighbor::getCell(void) const { return cell; }
 
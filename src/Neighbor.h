@@ -46,13 +46,16 @@ class Neighbor {
   Cell *cell;
   Node *nb1, *nb2;
 
+  // position of the node in cell's node ring (see Cell::BuildNodeRing), or -1
+  int ring_pos;
+
  public:
   Neighbor(void);
   Neighbor(Cell*, Node*, Node*);
   Neighbor(const Neighbor&);
 
   bool CellEquals(int) const;
-  bool Cmp(Neighbor&) const;
+  bool Cmp(const Neighbor&) const;
   bool Eq(Neighbor&) const;
   Cell* getCell(void) const;
   void XMLAdd(xmlNodePtr) const;
@@ -35,7 +35,6 @@ using std::pow;
 Wortel::Wortel()
   : QObject()
   , m_mesh(NULL)
-  , time_now(0)
   , time_start(0)
   , mModel(1) // valid values are 1 .. 12
 {
@@ -135,16 +134,17 @@ void Wortel::CellHouseKeeping(CellBase* c)
   c->SetPrevArea( Acurr);
 
 
+  // Nothing but c is written, so that cells can be kept house in
+  // parallel (see ParallelHouseKeeping)
+
+  // The rules of model 12 have never set the time, which stays at the start time
+  double time_now = mModel == 12 ? time_start : m_mesh->getTime();
+
   //Keep track of tip position
-  static double tip_position = 660.;
-  static double next_tip_position = 660.;
-  if (c->Index() == 0)
+  double tip_position = 660.;
+  if ((mModel == 8 || mModel == 9) && m_mesh->NCells() > 194)
   {
-    tip_position = next_tip_position;
-  }
-  if (c->Index() == 194)
-  {
-    next_tip_position = c->Centroid().y;
+    tip_position = m_mesh->getCell(194).Centroid().y;
   }
 
 
@@ -173,8 +173,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
 
   if (mModel == 1 &&  c->CellType() != 0 )
   {
-    time_now = m_mesh->getTime();
-
     if ( (((c->CellType()) >= 3) && ((c->CellType()) <= 7)) && (c->HasNeighborOfTypeZero() || ( ( c->NumberOfDivisions2() <= 2 ) && ( time_now - c->GetDivisionTime() ) >= 0)) )
     {
       c->EnlargeTargetArea( 2 );
@@ -195,8 +193,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   if ((mModel == 1 || mModel == 4) &&
       c->CellType() != 0 )
   {
-    time_now = m_mesh->getTime();
-
     if ( (((c->CellType()) >= 3) && ((c->CellType()) <= 7)) && (c->HasNeighborOfTypeZero() || ( ( time_now - c->GetDivisionTime() ) <= 3240. && ( time_now - c->GetDivisionTime() ) >= 0)) )
     {
       c->EnlargeTargetArea( 0.02 * ( c->Area() ) );
@@ -217,8 +213,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   if ((mModel == 3 || mModel == 5 || mModel == 6 || mModel == 7) &&
       c->CellType() != 0 )
   {
-    time_now = m_mesh->getTime();
-
     if ( (((c->CellType()) >= 3) && ((c->CellType()) <= 7)) && (c->HasNeighborOfTypeZero() || ( ( c->NumberOfDivisions2() <= 3 ) && ( time_now - c->GetDivisionTime() ) >= 0)) )
     {
       c->EnlargeTargetArea( 0.02 * ( c->Area() ) );
@@ -238,7 +232,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
 
   if (mModel == 8 || mModel == 9)
   {
-    time_now = m_mesh->getTime();
     double CCnoise2 = 1 /*+ (RANDOM()-0.5)/5*/;
 
     if ( ( tip_position - (c->Centroid().y) ) < /*180.*/240.)
@@ -261,8 +254,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   if (mModel == 10)
 
   {
-    time_now = m_mesh->getTime();
-
     if (time_now <= 4320)
     {
       if ( c->CellType() != 0 )
@@ -302,8 +293,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   if (mModel == 11)
 
   {
-    time_now = m_mesh->getTime();
-
     if (time_now <= 4320)
     {
       if ( c->CellType() != 0 )
@@ -379,7 +368,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   if (mModel == 1 || mModel == 3 || mModel == 5)
 
   {
-    time_now = m_mesh->getTime();
     double CCnoise = 1 + (RANDOM()-0.5)/2;//to add noise at the start
     double CCnoise2 = 1 + (RANDOM()-0.5)/5;
 
@@ -430,7 +418,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   // TIMER + TIMER (CELL CYCLE): MODELS 2, 4 (CF. TABLE S1 FOR PARAMETERS)
   if (mModel == 2 || mModel == 4)
   {
-    time_now = m_mesh->getTime();
     double CCnoise = 1 + (RANDOM()-0.5)/2;
     double CCnoise2 = 1 + (RANDOM()-0.5)/5;//to add noise overall
 
@@ -479,7 +466,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   // COUNTER + SIZER(CELL CYCLE): MODELS 6,7 (CF. TABLE S1 FOR PARAMETERS)
   if (mModel == 6 || mModel == 7)
   {
-    time_now = m_mesh->getTime();
     double CCnoise = 1 + (RANDOM()-0.5)/2;
     double CCnoise2 = 1 + (RANDOM()-0.5)/5;
 
@@ -558,7 +544,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   // RULER + SIZER(CELL CYCLE): MODEL 8 (CF. TABLE S1 FOR PARAMETERS)
   if (mModel == 8)
   {
-    time_now = m_mesh->getTime();
     double CCnoise2 = 1 + (RANDOM()-0.5)/5;
 
     if ( ( tip_position - (c->Centroid().y) ) < 180.)
@@ -582,7 +567,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   if (mModel == 9)
 
   {
-    time_now = m_mesh->getTime();
     double CCnoise2 = 1 + (RANDOM()-0.5)/5;
 
     if ( ( tip_position - (c->Centroid().y) ) < 240.)
@@ -598,8 +582,6 @@ void Wortel::CellHouseKeeping(CellBase* c)
   // MODEL 10, 11 (CF. TABLE S1 FOR PARAMETERS)
   if (mModel == 10 || mModel == 11)
   {
-    time_now = m_mesh->getTime();
-
     if (time_now <= 4320)
     {
       double CCnoise = 1 + (RANDOM()-0.5)/2;
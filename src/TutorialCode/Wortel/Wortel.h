@@ -68,13 +68,18 @@ public:
   // to be executed for coloring a cell
   virtual void SetCellColor(CellBase* c, QColor* color);
 
+  // CellHouseKeeping writes only its own cell
+  virtual bool ParallelHouseKeeping() { return true; }
+
+  // the dynamics only write the derivatives they are given
+  virtual bool ParallelDynamics() { return true; }
+
   // see SimPluginInterface
   virtual double PINflux(CellBase* this_cell, CellBase* adjacent_cell, Wall* w);
 
 private:
   /// Points to the mesh this model works with.
   Mesh*   m_mesh;
-  double time_now;
   double time_start;
   int mModel;
 
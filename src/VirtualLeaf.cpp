@@ -39,6 +39,8 @@
 #include "canvas.h"
 #include "cell.h"
 #include "output.h"
+#include "checkpoint.h"
+#include "moments.h"
 #include <qwidget.h>
 #include <q3process.h>
 #include <qapplication.h>
@@ -192,7 +194,7 @@ void MainBase::Plot(int resize_stride)
       fname.width(6);
       fname << count << ".png";
       // Write high-res PNG snapshot every plot step
-      Save(fname.str().c_str(), "PNG", 1024, 768);
+      SaveInBackground(fname.str().c_str(), 1024, 768);
     }
 
     if (!(count%par.xml_storage_stride)) {
@@ -202,9 +204,24 @@ void MainBase::Plot(int resize_stride)
       fname.width(6);
       fname << count << ".xml";
       // Write XML file every ten plot steps
-      mesh.XMLSave(fname.str().c_str(), XMLSettingsTree());
+      XMLSaveInBackground(fname.str().c_str());
     }
   }
+
+  if (par.trajectory_stride > 0 && !(count%par.trajectory_stride)) {
+    AppendTrajectoryFrame();
+  }
+
+  // Plot is called more than once for the same time step
+  if (par.checkpoint_stride > 0 && !(count%par.checkpoint_stride) && mesh.getTime() != checkpoint_time) {
+    checkpoint_time = mesh.getTime();
+    stringstream fname;
+    fname << par.datadir << "/leaf.";
+    fname.fill('0');
+    fname.width(6);
+    fname << count << ".vlc";
+    SaveCheckpoint(fname.str().c_str());
+  }
 }
 
 
@@ -215,7 +232,13 @@ INIT {
     if (qApp->type()==QApplication::Tty) {
       
       xmlNode *settings;
-      mesh.XMLRead(leaffile, &settings);
+      bool checkpoint = CheckpointReader::CheckpointP(leaffile);
+      if (checkpoint) {
+	mesh.CheckpointRead(leaffile, &settings);
+      } else {
+	mesh.XMLRead(leaffile, &settings);
+      }
+      main_window->RestartTrajectory(checkpoint);
       
       main_window->XMLReadSettings(settings);
       xmlFree(settings);
@@ -310,6 +333,55 @@ void vlMessageOutput(QtMsgType type, const char *msg)
 }
 
 
+/* Write the cells of all frames of a trajectory as comma separated
+   values: frame, time, cell, area, centroid and chemicals. */
+void ExportTrajectory(const char *fname, ostream &out)
+{
+  TrajectoryReader reader(fname);
+  TrajectoryFrame frame;
+  vector<double> px, py;
+
+  for (int f=0;f<reader.NFrames();f++) {
+    reader.Read(f, frame);
+    if (f==0) {
+      out << "frame,time,cell,area,x,y";
+      for (int c=0;c<frame.nchem;c++) {
+	out << ",chem" << c;
+      }
+      out << endl;
+    }
+
+    for (int i=0;i<frame.NCells();i++) {
+      // centroid of the polygon, from the moments as in CellBase::Centroid
+      int first=frame.cell_node_offsets[i], n=frame.cell_node_offsets[i+1]-first;
+      px.resize(n+1);
+      py.resize(n+1);
+      for (int k=0;k<n;k++) {
+	px[k]=frame.node_x[frame.cell_nodes[first+k]];
+	py[k]=frame.node_y[frame.cell_nodes[first+k]];
+      }
+      px[n] = n ? px[0] : 0.;
+      py[n] = n ? py[0] : 0.;
+
+      PolygonMoments m;
+      CalcPolygonMoments(&px[0], &py[0], n, m);
+      double x=0., y=0.;
+      if (m.area != 0.) {
+	x = m.x / (3.*m.area);
+	y = m.y / (3.*m.area);
+      }
+
+      out << f << ',' << frame.time << ',' << i << ',' << frame.cell_area[i] << ',' << x << ',' << y;
+      for (int c=0;c<frame.nchem;c++) {
+	out << ',' << frame.cell_chem[i*frame.nchem + c];
+      }
+      out << '\n';
+    }
+  }
+  out << flush;
+}
+
+
 Parameter par;
 
 int main(int argc,char **argv) {
@@ -318,6 +390,8 @@ int main(int argc,char **argv) {
     int c;
     char *leaffile=0;
     char *modelfile=0;
+    char *convertfile=0;
+    char *trajectoryfile=0;
 
     while (1) {
 
@@ -326,12 +400,15 @@ int main(int argc,char **argv) {
       static struct option long_options[] = {
 	{"batch", no_argument, NULL, 'b'},
 	{"leaffile", required_argument, NULL, 'l'},
-	{"model", required_argument, NULL, 'm'} 
+	{"model", required_argument, NULL, 'm'},
+	{"convert", required_argument, NULL, 'c'},
+	{"export", required_argument, NULL, 'e'},
+	{NULL, 0, NULL, 0}
       };
 
       // short option 'p' creates trouble for non-commandline usage on MacOSX. Option -p changed to -P (capital)
-      static char *short_options = "blm";
-      c = getopt_long (argc, argv, "bl:m:",
+      static char *short_options = "blmce";
+      c = getopt_long (argc, argv, "bl:m:c:e:",
 		       long_options, &option_index);
       if (c == -1)
 	break;
@@ -367,6 +444,25 @@ int main(int argc,char **argv) {
 	}
 	break;
 
+      case 'c':
+	// convert the leaf file to a checkpoint, or a checkpoint to
+	// LeafML, and quit
+	convertfile=strdup(optarg);
+	if (!convertfile) {
+	  throw("Out of memory");
+	}
+	batch=true;
+	break;
+
+      case 'e':
+	// write a trajectory as comma separated values, and quit
+	trajectoryfile=strdup(optarg);
+	if (!trajectoryfile) {
+	  throw("Out of memory");
+	}
+	batch=true;
+	break;
+
       case '?':
 	break;
 
@@ -383,6 +479,11 @@ int main(int argc,char **argv) {
       printf ("\n");
     }
 
+    if (trajectoryfile) {
+      ExportTrajectory(trajectoryfile, cout);
+      return 0;
+    }
+
     bool useGUI = !batch;
     qInstallMsgHandler(vlMessageOutput); // custom message handler
     QApplication app(argc,argv,useGUI);
@@ -439,13 +540,35 @@ int main(int argc,char **argv) {
 
 	  main_window->Plot();
     */
+    if (convertfile) {
+      if (!leaffile) {
+	throw("Option --convert needs a leaf file (option -l) to convert.");
+      }
+      xmlNode *settings;
+      if (CheckpointReader::CheckpointP(leaffile)) {
+	mesh.CheckpointRead(leaffile, &settings);
+	mesh.XMLSave(convertfile, settings);
+      } else {
+	mesh.XMLRead(leaffile, &settings);
+	mesh.CheckpointSave(convertfile, settings);
+      }
+      printf("Converted '%s' to '%s'\n", leaffile, convertfile);
+      return 0;
+    }
+
     if (batch) {
       double t=0.;
       do {
 	t = main_window->TimeStep();
       } while (t < par.maxt);
-    } else
-      return app.exec();
+      main_window->FlushSnapshots();
+      main_window->CloseTrajectory();
+    } else {
+      int result = app.exec();
+      main_window->FlushSnapshots();
+      main_window->CloseTrajectory();
+      return result;
+    }
 
   } catch (const char *message) {
     if (batch) { 
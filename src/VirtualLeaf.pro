@@ -85,31 +85,45 @@ HEADERS += \
  cellbase.h \
  cell.h \
  cellitem.h \
+ checkpoint.h \
+ edgegrid.h \
  forwardeuler.h \
        hull.h \ 
  infobar.h \
+ leafmlreader.h \
+ leafmlwriter.h \
  mainbase.h \
  mainbase.h \
  matrix.h \
  mesh.h \
  modelcatalogue.h \
+ moments.h \
  Neighbor.h \
  node.h \
  nodeitem.h \
  nodeset.h \
+ nodestore.h \
+ odestats.h \
  OptionFileDialog.h \
  output.h \
  parameter.h \
  pardialog.h \
  parse.h \
  pi.h \
+ pool.h \
  qcanvasarrow.h \
  random.h \
+ rosenbrock.h \
  rungekutta.h \
  simitembase.h \
  simplugin.h \
+ slotmap.h \
+ smallvector.h \
+ snapshotwriter.h \
+ sparsejacobian.h \
  sqr.h \
  tiny.h \
+ trajectory.h \
  transporterdialog.h \
  UniqueMessage.h \
  vector.h \
@@ -126,24 +140,35 @@ SOURCES += \
  cellbase.cpp \
  cell.cpp \
  cellitem.cpp \
+ checkpoint.cpp \
+ edgegrid.cpp \
  forwardeuler.cpp \
  hull.cpp \
+ leafmlreader.cpp \
+ leafmlwriter.cpp \
  mainbase.cpp \
  matrix.cpp \
  mesh.cpp \
  modelcatalogue.cpp \
+ moments.cpp \
  Neighbor.cpp \
  node.cpp \
  nodeitem.cpp \
  nodeset.cpp \
+ nodestore.cpp \
  OptionFileDialog.cpp \
  output.cpp \
  parameter.cpp \
  pardialog.cpp \
  parse.cpp \
+ pool.cpp \
  random.cpp \
+ rosenbrock.cpp \
  rungekutta.cpp \
  simitembase.cpp \
+ snapshotwriter.cpp \
+ sparsejacobian.cpp \
+ trajectory.cpp \
  transporterdialog.cpp \
  UniqueMessage.cpp \
  vector.cpp \
@@ -0,0 +1,401 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+// Micro-benchmark for the Runge-Kutta integrator. Reads the cell and
+// wall topology and the initial chemical and transporter values from
+// LeafML files (e.g. data/leaves/*.xml), sets up a linear
+// reaction-diffusion system on it with the same state layout as
+// Mesh::ReactDiffuse, and integrates it with both the current
+// RungeKutta and the original, allocating implementation.
+//
+// Usage: rkbench [-r repeat] [-t time] leaf.xml [leaf.xml ...]
+//
+// "repeat" tiles each leaf that many times to get a larger system.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include "rungekutta.h"
+#include "warning.h"
+#include "maxmin.h"
+
+static const std::string _module_id("$Id$");
+
+using namespace std;
+
+// The reaction-diffusion system: each cell has nchem chemicals that
+// decay and diffuse through the walls; each wall has nchem transporters
+// on either side, which relax towards the concentration in the
+// adjacent cell.
+class LeafSystem {
+
+ public:
+  LeafSystem(void) : nchem(0), ncells(0) {}
+
+  bool Read(const char *fname, int repeat);
+
+  int NEqs(void) const { return (int)y0.size(); }
+
+  void Derivs(const double *y, double *dydx) const {
+    int nwalls = (int)c1.size();
+    double *dcell = dydx;
+    const double *ycell = y;
+    for (int i=0;i<ncells*nchem;i++) {
+      dcell[i] = -decay * ycell[i];
+    }
+    const double *ywall = y + ncells*nchem;
+    double *dwall = dydx + ncells*nchem;
+    for (int w=0;w<nwalls;w++) {
+      const double *t1 = ywall + 2*w*nchem, *t2 = t1 + nchem;
+      double *dt1 = dwall + 2*w*nchem, *dt2 = dt1 + nchem;
+      for (int c=0;c<nchem;c++) {
+	double conc1 = c1[w]>=0 ? ycell[c1[w]*nchem+c] : 0.;
+	double conc2 = c2[w]>=0 ? ycell[c2[w]*nchem+c] : 0.;
+	double flux = diffusion * length[w] * (conc2 - conc1);
+	if (c1[w]>=0) dcell[c1[w]*nchem+c] += flux;
+	if (c2[w]>=0) dcell[c2[w]*nchem+c] -= flux;
+	dt1[c] = relax * (conc1 - t1[c]);
+	dt2[c] = relax * (conc2 - t2[c]);
+      }
+    }
+  }
+
+  vector<double> y0;
+
+ private:
+  static const double decay;
+  static const double diffusion;
+  static const double relax;
+
+  int nchem, ncells;
+  vector<int> c1, c2;
+  vector<double> length;
+};
+
+const double LeafSystem::decay = 0.1;
+const double LeafSystem::diffusion = 1e-3;
+const double LeafSystem::relax = 1.;
+
+static xmlNode *FirstChild(xmlNode *node, const char *name)
+{
+  for (xmlNode *cur = node ? node->children : 0; cur; cur = cur->next) {
+    if (cur->type == XML_ELEMENT_NODE && !xmlStrcmp(cur->name, (const xmlChar *)name))
+      return cur;
+  }
+  return 0;
+}
+
+static double Attribute(xmlNode *node, const char *name, double def)
+{
+  xmlChar *v = xmlGetProp(node, (const xmlChar *)name);
+  if (!v) return def;
+  double d = atof((const char *)v);
+  xmlFree(v);
+  return d;
+}
+
+// Append the "v" attributes of all <val> children of node to vals,
+// padded or truncated to n values
+static void ReadVals(xmlNode *node, int n, vector<double> &vals)
+{
+  int i=0;
+  for (xmlNode *cur = node ? node->children : 0; cur && i<n; cur = cur->next) {
+    if (cur->type == XML_ELEMENT_NODE && !xmlStrcmp(cur->name, (const xmlChar *)"val")) {
+      vals.push_back(Attribute(cur, "v", 0.));
+      i++;
+    }
+  }
+  for (;i<n;i++) vals.push_back(0.);
+}
+
+bool LeafSystem::Read(const char *fname, int repeat)
+{
+  xmlDoc *doc = xmlReadFile(fname, 0, XML_PARSE_NOWARNING);
+  if (!doc) return false;
+  xmlNode *root = xmlDocGetRootElement(doc);
+  xmlNode *cells = FirstChild(root, "cells");
+  xmlNode *walls = FirstChild(root, "walls");
+  if (!cells || !walls) {
+    xmlFreeDoc(doc);
+    return false;
+  }
+
+  vector<double> cellvals, wallvals;
+  vector<int> wc1, wc2;
+  vector<double> wlength;
+  int n=0;
+  nchem = 0;
+  for (xmlNode *cur = cells->children; cur; cur = cur->next) {
+    if (cur->type != XML_ELEMENT_NODE || xmlStrcmp(cur->name, (const xmlChar *)"cell"))
+      continue;
+    xmlNode *chem = FirstChild(cur, "chem");
+    if (!nchem && chem) nchem = (int)Attribute(chem, "n", 0);
+    ReadVals(chem, nchem, cellvals);
+    n++;
+  }
+  if (!nchem) {
+    xmlFreeDoc(doc);
+    return false;
+  }
+  // cells read before nchem was known got no values
+  cellvals.insert(cellvals.begin(), n*nchem - cellvals.size(), 0.);
+
+  for (xmlNode *cur = walls->children; cur; cur = cur->next) {
+    if (cur->type != XML_ELEMENT_NODE || xmlStrcmp(cur->name, (const xmlChar *)"wall"))
+      continue;
+    wc1.push_back((int)Attribute(cur, "c1", -1));
+    wc2.push_back((int)Attribute(cur, "c2", -1));
+    wlength.push_back(Attribute(cur, "length", 1.));
+    ReadVals(FirstChild(cur, "transporters1"), nchem, wallvals);
+    ReadVals(FirstChild(cur, "transporters2"), nchem, wallvals);
+  }
+  xmlFreeDoc(doc);
+
+  // tile the leaf; the copies are not connected
+  ncells = n*repeat;
+  c1.clear(); c2.clear(); length.clear(); y0.clear();
+  for (int r=0;r<repeat;r++) {
+    y0.insert(y0.end(), cellvals.begin(), cellvals.end());
+    for (unsigned int w=0;w<wc1.size();w++) {
+      c1.push_back(wc1[w]>=0 ? wc1[w]+r*n : -1);
+      c2.push_back(wc2[w]>=0 ? wc2[w]+r*n : -1);
+      length.push_back(wlength[w]);
+    }
+  }
+  for (int r=0;r<repeat;r++) {
+    y0.insert(y0.end(), wallvals.begin(), wallvals.end());
+  }
+  return true;
+}
+
+// The Cash-Karp integrator as it was before the work arrays were made
+// persistent, i.e. with heap allocations in every step.
+class LegacyRungeKutta {
+
+ public:
+  LegacyRungeKutta(const LeafSystem &s) : sys(s) {}
+
+  void odeint(double *ystart, int nvar, double x1, double x2, double eps, double h1,
+	      double hmin, int *nok, int *nbad);
+
+ private:
+  void derivs(double, double *y, double *dydx) { sys.Derivs(y, dydx); }
+
+  void rkqs(double *y, double *dydx, int n, double *x, double htry, double eps,
+	    double *yscal, double *hdid, double *hnext);
+  void rkck(double *y, double *dydx, int n, double x, double h, double *yout,
+	    double *yerr);
+
+  const LeafSystem &sys;
+};
+
+void LegacyRungeKutta::rkqs(double *y, double *dydx, int n, double *x, double htry, double eps,
+			    double *yscal, double *hdid, double *hnext)
+{
+  int i;
+  double errmax,h,htemp,xnew,*yerr,*ytemp;
+  yerr=new double[n];
+  ytemp=new double[n];
+
+  h=htry;
+  for (;;) {
+    rkck(y,dydx,n,*x,h,ytemp,yerr);
+    errmax=0.0;
+    for (i=0;i<n;i++) errmax=FMAX(errmax,fabs(yerr[i]/yscal[i]));
+    errmax /= eps;
+    if (errmax <= 1.0) break;
+    htemp=0.9*h*pow(errmax,-0.25);
+    h=(h >= 0.0 ? FMAX(htemp,0.1*h) : FMIN(htemp,0.1*h));
+    xnew=(*x)+h;
+    if (xnew == *x) MyWarning::error("stepsize underflow in rkqs");
+  }
+  if (errmax > 1.89e-4) *hnext=0.9*h*pow(errmax,-0.2);
+  else *hnext=5.0*h;
+  *x += (*hdid=h);
+  for (i=0;i<n;i++) y[i]=ytemp[i];
+  delete[] ytemp;
+  delete[] yerr;
+}
+
+void LegacyRungeKutta::rkck(double *y, double *dydx, int n, double x, double h, double *yout, double *yerr)
+{
+  int i;
+  static double a2=0.2,a3=0.3,a4=0.6,a5=1.0,a6=0.875,b21=0.2,
+    b31=3.0/40.0,b32=9.0/40.0,b41=0.3,b42 = -0.9,b43=1.2,
+    b51 = -11.0/54.0, b52=2.5,b53 = -70.0/27.0,b54=35.0/27.0,
+    b61=1631.0/55296.0,b62=175.0/512.0,b63=575.0/13824.0,
+    b64=44275.0/110592.0,b65=253.0/4096.0,c1=37.0/378.0,
+    c3=250.0/621.0,c4=125.0/594.0,c6=512.0/1771.0,
+    dc5 = -277.00/14336.0;
+  double dc1=c1-2825.0/27648.0,dc3=c3-18575.0/48384.0,
+    dc4=c4-13525.0/55296.0,dc6=c6-0.25;
+  double *ak2,*ak3,*ak4,*ak5,*ak6,*ytemp;
+  ak2=new double[n];
+  ak3=new double[n];
+  ak4=new double[n];
+  ak5=new double[n];
+  ak6=new double[n];
+  ytemp=new double[n];
+  for (i=0;i<n;i++)
+    ytemp[i]=y[i]+b21*h*dydx[i];
+  derivs(x+a2*h,ytemp,ak2);
+  for (i=0;i<n;i++)
+    ytemp[i]=y[i]+h*(b31*dydx[i]+b32*ak2[i]);
+  derivs(x+a3*h,ytemp,ak3);
+  for (i=0;i<n;i++)
+    ytemp[i]=y[i]+h*(b41*dydx[i]+b42*ak2[i]+b43*ak3[i]);
+  derivs(x+a4*h,ytemp,ak4);
+  for (i=0;i<n;i++)
+    ytemp[i]=y[i]+h*(b51*dydx[i]+b52*ak2[i]+b53*ak3[i]+b54*ak4[i]);
+  derivs(x+a5*h,ytemp,ak5);
+  for (i=0;i<n;i++)
+    ytemp[i]=y[i]+h*(b61*dydx[i]+b62*ak2[i]+b63*ak3[i]+b64*ak4[i]+b65*ak5[i]);
+  derivs(x+a6*h,ytemp,ak6);
+  for (i=0;i<n;i++)
+    yout[i]=y[i]+h*(c1*dydx[i]+c3*ak3[i]+c4*ak4[i]+c6*ak6[i]);
+  for (i=0;i<n;i++)
+    yerr[i]=h*(dc1*dydx[i]+dc3*ak3[i]+dc4*ak4[i]+dc5*ak5[i]+dc6*ak6[i]);
+  delete[] ytemp;
+  delete[] ak6;
+  delete[] ak5;
+  delete[] ak4;
+  delete[] ak3;
+  delete[] ak2;
+}
+
+void LegacyRungeKutta::odeint(double *ystart, int nvar, double x1, double x2, double eps, double h1, double hmin, int *nok, int *nbad)
+{
+  int nstp,i;
+  double x,hnext,hdid,h;
+  double *yscal,*y,*dydx;
+  yscal=new double[nvar];
+  y=new double[nvar];
+  dydx=new double[nvar];
+  x=x1;
+  h=SIGN(h1,x2-x1);
+  *nok = (*nbad) = 0;
+  for (i=0;i<nvar;i++) y[i]=ystart[i];
+  for (nstp=0;nstp<10000;nstp++) {
+    derivs(x,y,dydx);
+    for (i=0;i<nvar;i++)
+      yscal[i]=fabs(y[i])+fabs(dydx[i]*h)+1.0e-30;
+    if ((x+h-x2)*(x+h-x1) > 0.0) h=x2-x;
+    rkqs(y,dydx,nvar,&x,h,eps,yscal,&hdid,&hnext);
+    if (hdid == h) ++(*nok); else ++(*nbad);
+    if ((x-x2)*(x2-x1) >= 0.0) {
+      for (i=0;i<nvar;i++) ystart[i]=y[i];
+      delete[] dydx;
+      delete[] y;
+      delete[] yscal;
+      return;
+    }
+    if (fabs(hnext) <= hmin) MyWarning::error("Step size too small in odeint");
+    h=hnext;
+  }
+  MyWarning::error("Too many steps in routine odeint");
+}
+
+class BenchRungeKutta : public RungeKutta {
+
+ public:
+  BenchRungeKutta(const LeafSystem &s) : sys(s) {}
+
+ protected:
+  virtual void derivs(double, double *y, double *dydx) { sys.Derivs(y, dydx); }
+
+ private:
+  const LeafSystem &sys;
+};
+
+// Integrate in steps of delta_t up to end_time, as Mesh::ReactDiffuse
+// does, and return the CPU time taken.
+template<class Solver>
+static double Run(Solver &solver, const LeafSystem &sys, double end_time, vector<double> &y, int &steps)
+{
+  const double delta_t = 0.1, eps = 1e-3;
+  y = sys.y0;
+  steps = 0;
+  clock_t start = clock();
+  for (double t=0.; t<end_time; t+=delta_t) {
+    int nok, nbad;
+    solver.odeint(&y[0], sys.NEqs(), t, t+delta_t, eps, delta_t, 1e-10, &nok, &nbad);
+    steps += nok+nbad;
+  }
+  return (double)(clock()-start)/CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+  int repeat = 1;
+  double end_time = 100.;
+  int first = 1;
+  for (; first<argc && argv[first][0]=='-'; first++) {
+    if (!strcmp(argv[first], "-r") && first+1<argc) {
+      repeat = atoi(argv[++first]);
+    } else if (!strcmp(argv[first], "-t") && first+1<argc) {
+      end_time = atof(argv[++first]);
+    } else {
+      fprintf(stderr, "Usage: %s [-r repeat] [-t time] leaf.xml [leaf.xml ...]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (first>=argc || repeat<1) {
+    fprintf(stderr, "Usage: %s [-r repeat] [-t time] leaf.xml [leaf.xml ...]\n", argv[0]);
+    return 1;
+  }
+
+  printf("%-24s %8s %8s %10s %10s %8s %10s\n",
+	 "model", "nvar", "steps", "legacy(s)", "new(s)", "speedup", "max|dy|");
+  for (int i=first; i<argc; i++) {
+    LeafSystem sys;
+    if (!sys.Read(argv[i], repeat)) {
+      fprintf(stderr, "%s: no cells, walls or chemicals, skipped\n", argv[i]);
+      continue;
+    }
+
+    LegacyRungeKutta legacy(sys);
+    BenchRungeKutta current(sys);
+    vector<double> y_legacy, y_current;
+    int steps_legacy, steps_current;
+    double t_legacy = Run(legacy, sys, end_time, y_legacy, steps_legacy);
+    double t_current = Run(current, sys, end_time, y_current, steps_current);
+
+    // both must follow exactly the same trajectory
+    double maxdiff = 0.;
+    for (unsigned int j=0;j<y_legacy.size();j++) {
+      maxdiff = FMAX(maxdiff, fabs(y_legacy[j]-y_current[j]));
+    }
+    const char *base = strrchr(argv[i], '/');
+    printf("%-24s %8d %8d %10.3f %10.3f %8.2f %10.3g\n",
+	   base ? base+1 : argv[i], sys.NEqs(), steps_current,
+	   t_legacy, t_current, t_current>0. ? t_legacy/t_current : 0., maxdiff);
+  }
+  xmlCleanupParser();
+  return 0;
+}
+
+/* finis */
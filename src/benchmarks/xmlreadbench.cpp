@@ -0,0 +1,176 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+// Micro-benchmark for reading LeafML files. Reads all numerical
+// attributes of the nodes, cells, walls and chemical values of LeafML
+// files (e.g. data/leaves/*.xml) in two ways: as Mesh::XMLReadTree
+// does, parsing the file into a document tree and copying each
+// attribute out of it, and as Mesh::XMLRead does, in a single pass
+// with LeafMLReader. Building the mesh itself is the same for both.
+//
+// Usage: xmlreadbench [-r repeat] leaf.xml [leaf.xml ...]
+//
+// Each file is read "repeat" times in either way.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <QLocale>
+#include "leafmlreader.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+using namespace std;
+
+// The numerical attributes that are read from each element
+struct ElementAttributes {
+  const char *element;
+  const char *attributes[6];
+};
+
+static const ElementAttributes leafml_attributes[] = {
+  { "node", { "x", "y", 0 } },
+  { "cell", { "area", "target_area", "target_length", "lambda_celllength", "stiffness", 0 } },
+  { "boundary_polygon", { "area", "target_area", "target_length", "lambda_celllength", "stiffness", 0 } },
+  { "wall", { "length", 0 } },
+  { "val", { "v", 0 } },
+  { 0, { 0 } }
+};
+
+static const char *const *Attributes(const char *element)
+{
+  for (const ElementAttributes *e=leafml_attributes; e->element; e++) {
+    if (!strcmp(e->element, element)) {
+      return e->attributes;
+    }
+  }
+  return 0;
+}
+
+// As XMLReadTree: walk the document tree, and copy and convert each attribute
+static void SumTree(const xmlNode *cur, const QLocale &standardlocale, double &sum, long &n)
+{
+  bool ok;
+  for (; cur!=NULL; cur=cur->next) {
+    if (cur->type != XML_ELEMENT_NODE) continue;
+    const char *const *a = Attributes((const char *)cur->name);
+    for (; a && *a; a++) {
+      xmlChar *v_str = xmlGetProp((xmlNode *)cur, BAD_CAST *a);
+      if (v_str != 0) {
+	sum += standardlocale.toDouble((char *)v_str, &ok);
+	if (!ok) MyWarning::error("Could not convert \"%s\" to double in XMLRead.",(char *)v_str);
+	n++;
+	xmlFree(v_str);
+      }
+    }
+    SumTree(cur->children, standardlocale, sum, n);
+  }
+}
+
+static bool ReadTree(const char *fname, double &sum, long &n)
+{
+  xmlDocPtr doc = xmlParseFile(fname);
+  if (doc == NULL) {
+    return false;
+  }
+  QLocale standardlocale(QLocale::C);
+  SumTree(xmlDocGetRootElement(doc), standardlocale, sum, n);
+  xmlFreeDoc(doc);
+  return true;
+}
+
+// As XMLRead: one pass, attributes converted in place
+static bool ReadStream(const char *fname, double &sum, long &n)
+{
+  LeafMLReader reader(fname);
+  while (reader.Next()) {
+    if (!reader.StartP()) continue;
+    const char *const *a = Attributes(reader.Name());
+    for (; a && *a; a++) {
+      const char *v_str = reader.Attribute(*a);
+      if (v_str != 0) {
+	sum += reader.ToDouble(v_str);
+	n++;
+      }
+    }
+  }
+  return !reader.Failed();
+}
+
+static double Time(bool (*read)(const char *, double &, long &), const char *fname, int repeat, double &sum, long &n, bool &ok)
+{
+  clock_t start = clock();
+  ok = true;
+  for (int r=0;r<repeat && ok;r++) {
+    sum = 0.; n = 0;
+    ok = read(fname, sum, n);
+  }
+  return (double)(clock()-start)/CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+  int repeat = 1;
+  int first = 1;
+  for (; first<argc && argv[first][0]=='-'; first++) {
+    if (!strcmp(argv[first], "-r") && first+1<argc) {
+      repeat = atoi(argv[++first]);
+    } else {
+      fprintf(stderr, "Usage: %s [-r repeat] leaf.xml [leaf.xml ...]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (first>=argc || repeat<1) {
+    fprintf(stderr, "Usage: %s [-r repeat] leaf.xml [leaf.xml ...]\n", argv[0]);
+    return 1;
+  }
+
+  printf("%-24s %8s %10s %10s %8s %10s\n",
+	 "model", "values", "tree(s)", "stream(s)", "speedup", "|dsum|");
+  for (int i=first; i<argc; i++) {
+    double sum_tree, sum_stream;
+    long n_tree, n_stream;
+    bool ok_tree, ok_stream;
+    double t_tree = Time(ReadTree, argv[i], repeat, sum_tree, n_tree, ok_tree);
+    double t_stream = Time(ReadStream, argv[i], repeat, sum_stream, n_stream, ok_stream);
+    if (!ok_tree || !ok_stream) {
+      fprintf(stderr, "%s: could not be parsed, skipped\n", argv[i]);
+      continue;
+    }
+    // both must read exactly the same values
+    if (n_tree != n_stream) {
+      MyWarning::error("%s: %ld values read from the tree, but %ld in one pass", argv[i], n_tree, n_stream);
+    }
+    const char *base = strrchr(argv[i], '/');
+    printf("%-24s %8ld %10.3f %10.3f %8.2f %10.3g\n",
+	   base ? base+1 : argv[i], n_stream, t_tree, t_stream,
+	   t_stream>0. ? t_tree/t_stream : 0., sum_tree>sum_stream ? sum_tree-sum_stream : sum_stream-sum_tree);
+  }
+  xmlCleanupParser();
+  return 0;
+}
+
+/* finis */
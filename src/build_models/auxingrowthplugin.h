@@ -38,6 +38,10 @@ class AuxinGrowthPlugin : public QObject, SimPluginInterface {
 	
   // Executed after the cellular mechanics steps have equillibrized
   virtual void CellHouseKeeping (CellBase *c);
+  // CellHouseKeeping only changes its own cell, so it may run in parallel
+  virtual bool ParallelHouseKeeping(void) { return true; }
+  // the dynamics only write the derivatives they are given
+  virtual bool ParallelDynamics(void) { return true; }
   // Differential equations describing transport of chemicals from cell to cell
   virtual void CelltoCellTransport(Wall *w, double *dchem_c1, double *dchem_c2);
     
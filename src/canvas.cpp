@@ -72,6 +72,7 @@
 #include "wallitem.h"
 #include "mesh.h"
 #include "xmlwrite.h"
+#include "checkpoint.h"
 #include "OptionFileDialog.h"
 #include <cstdlib>
 #include <cstdio>
@@ -477,6 +478,7 @@ Main::Main(QGraphicsScene& c, Mesh& m, QWidget* parent, const char* name, Qt::Wi
 
   file->insertItem("&Read leaf", this, SLOT(readStateXML()));
   file->insertItem("&Save leaf", this, SLOT(saveStateXML()));
+  file->insertItem("Save &checkpoint", this, SLOT(saveCheckpoint()));
   file->insertItem("Snapshot", this, SLOT(snapshot()), Qt::CTRL + Qt::SHIFT + Qt::Key_S);
 
   file->insertSeparator();
@@ -729,6 +731,54 @@ void Main::saveStateXML()
 }
 
 
+/*! Save a checkpoint, from which the simulation can be continued
+  exactly; it is read back with "Read leaf" */
+void Main::saveCheckpoint()
+{
+
+  stopSimulation();
+  Q3FileDialog* fd = new Q3FileDialog(this, "file dialog", TRUE);
+  fd->setMode(Q3FileDialog::AnyFile);
+  fd->setFilter("Checkpoints (*.vlc)");
+  fd->setDir(par.datadir);
+  QString fileName;
+
+  if (fd->exec() == QDialog::Accepted) {
+    fileName = fd->selectedFile();
+
+    // extract extension from filename
+    QFileInfo fi(fileName);
+    QString extension = fi.suffix();
+
+    if (extension.isEmpty()) {
+      extension = "vlc";
+      fileName += ".";
+      fileName += extension;
+    }
+
+    if (QFile::exists(fileName) &&
+      QMessageBox::question(
+        this,
+        tr("Overwrite File? -- Leaf Growth"),
+        tr("A file called %1 already exists."
+          " Do you want to overwrite it?")
+        .arg(fileName),
+        tr("&Yes"), tr("&No"),
+        QString::null, 1, 1)) {
+      return saveCheckpoint();
+
+    }
+    else {
+
+      SaveCheckpoint((const char*)fileName);
+      QString status_message;
+      status_message = QString("Wrote checkpoint to %1").arg(fileName);
+      cerr << status_message.toStdString().c_str() << endl;
+      statusBar()->showMessage(status_message);
+    }
+  }
+}
+
 
 void Main::snapshot()
 {
@@ -836,7 +886,16 @@ int Main::readStateXML(const char* filename, bool geometry, bool pars, bool simt
 
   try {
     xmlNode* settings;
-    mesh.XMLRead((const char*)filename, &settings, geometry, pars, simtime);
+    bool checkpoint = CheckpointReader::CheckpointP(filename);
+    if (checkpoint) {
+      mesh.CheckpointRead(filename, &settings, geometry, pars, simtime);
+    } else {
+      mesh.XMLRead((const char*)filename, &settings, geometry, pars, simtime);
+    }
+    if (geometry) {
+      // only a simulation restarted in time continues its trajectory
+      RestartTrajectory(checkpoint && simtime);
+    }
 #ifdef QDEBUG
     qDebug() << "Reading done." << endl;
 #endif
@@ -998,7 +1057,7 @@ void Main::readStateXML()
 #endif
   OptionFileDialog* fd = new OptionFileDialog(this, "read dialog", TRUE);
   fd->setMode(OptionFileDialog::ExistingFile);
-  fd->setFilter("LeafML files (*.xml)");
+  fd->setFilter("LeafML files and checkpoints (*.xml *.vlc)");
   if (working_dir) {
     fd->setDir(*working_dir);
   }
@@ -210,6 +210,7 @@ class Main : public Q3MainWindow, public MainBase {
   void exportCellData();
   void exportCellData(QString);
   void saveStateXML();
+  void saveCheckpoint();
   void snapshot();
   void savePars();
   void readPars();
@@ -22,6 +22,8 @@
 #include <QDebug>
 
 #include <string>
+#include <set>
+#include <limits>
 #include "cell.h"
 #include "node.h"
 #include "mesh.h"
@@ -111,13 +113,13 @@ void Cell::Apoptose(void)
   qDebug() << "This is cell " << Index() << endl;
   qDebug() << "Number of walls: " << walls.size() << endl;
 #endif
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (CellWalls::iterator w = walls.begin(); w != walls.end(); w++) {
 #ifdef QDEBUG
     qDebug() << "Before apoptosis, wall " << (*w)->Index() << " says: c1 = "
       << (*w)->c1->Index() << ", c2 = " << (*w)->c2->Index() << endl;
 #endif
   }
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (CellWalls::iterator w = walls.begin(); w != walls.end(); w++) {
 
     bool illegal_flag = false;
     if ((*w)->c1 == (*w)->c2)
@@ -175,9 +177,9 @@ void Cell::Apoptose(void)
 
     Node& no(*(*n));
     // locate myself in the node's owner list
-    list<Neighbor>::iterator cellpos;
+    NodeOwners::iterator cellpos;
     bool cell_found = false;
-    for (list<Neighbor>::iterator nb = no.owners.begin(); nb != no.owners.end(); nb++) {
+    for (NodeOwners::iterator nb = no.owners.begin(); nb != no.owners.end(); nb++) {
       if (nb->cell == this) {
         cellpos = nb;
         cell_found = true;
@@ -225,7 +227,7 @@ void Cell::ConstructConnections(void)
     //cerr << "Node " << *i << endl << " = " << *(*i) << endl;
     // 1. Tidy up existing connections (which are part of this cell)
     if ((*i)->owners.size() > 0) {
-      list<Neighbor>::iterator neighb_with_this_cell =
+      NodeOwners::iterator neighb_with_this_cell =
         // remove myself from the neighbor list of the node
         find_if((*i)->owners.begin(),
         (*i)->owners.end(),
@@ -708,7 +710,7 @@ void Cell::DivideWalls(ItList new_node_locations, const Vector from, const Vecto
 
       /*************** 1. Find the correct wall element  ********************/
 
-      list<Wall*>::iterator w, start_search;
+      CellWalls::iterator w, start_search;
       w = start_search = walls.begin();
       do {
         // Find wall between this cell and neighbor cell
@@ -817,7 +819,7 @@ void Cell::DivideWalls(ItList new_node_locations, const Vector from, const Vecto
       // give the node to the daughter
       // (find references to parent cell from this node,
       // and remove them)
-      list<Neighbor>::iterator neighb_with_this_cell =
+      NodeOwners::iterator neighb_with_this_cell =
         find_if((*i)->owners.begin(),
         (*i)->owners.end(),
           bind2nd(mem_fun_ref(&Neighbor::CellEquals), this->Index()));
@@ -976,8 +978,8 @@ void Cell::DivideWalls(ItList new_node_locations, const Vector from, const Vecto
   //cerr << "Correct walls of cell " << Index() << " and daughter " << daughter->Index() << endl;
 
   // Move Walls to daughter cell
-  list <Wall*> copy_walls = walls;
-  for (list<Wall*>::iterator w = copy_walls.begin(); w != copy_walls.end(); w++) {
+  CellWalls copy_walls = walls;
+  for (CellWalls::iterator w = copy_walls.begin(); w != copy_walls.end(); w++) {
 
     //cerr << "Doing wall, before:  " << **w << endl;
 
@@ -1025,6 +1027,12 @@ void Cell::Move(const Vector T) {
 }
 
 double Cell::Displace(double dx, double dy, double dh)
+{
+  GlobalRandom rng;
+  return Displace(dx, dy, dh, rng);
+}
+
+template<class RNG> double Cell::Displace(double dx, double dy, double dh, RNG &rng)
 {
 
   // Displace whole cell, add resulting energy to dh,
@@ -1052,7 +1060,7 @@ double Cell::Displace(double dx, double dy, double dh)
 
   double old_length = 0.;
   for (list<Node*>::const_iterator i = nodes.begin(); i != nodes.end(); i++) {
-    for (list<Neighbor>::const_iterator n = (*i)->owners.begin(); n != (*i)->owners.end(); n++) {
+    for (NodeOwners::const_iterator n = (*i)->owners.begin(); n != (*i)->owners.end(); n++) {
       if (n->getCell() != this) {
         length_edges.push_back(pair <Node*, Node*>(*i, n->nb1));
         length_edges.push_back(pair <Node*, Node*>(*i, n->nb2));
@@ -1089,7 +1097,7 @@ double Cell::Displace(double dx, double dy, double dh)
   dh += (new_area_energy - old_area_energy) + (new_length_energy - old_length_energy) * lambda_celllength +
     par.lambda_length * (new_length - old_length);
 
-  if (dh < 0 || RANDOM() < exp(-dh / par.T)) {
+  if (dh < 0 || rng.Uniform() < exp(-dh / par.T)) {
 
     // update areas of cells
     //cerr << "neighbors: ";
@@ -1111,6 +1119,9 @@ double Cell::Displace(double dx, double dy, double dh)
   return dh;
 }
 
+template double Cell::Displace<GlobalRandom>(double dx, double dy, double dh, GlobalRandom &rng);
+template double Cell::Displace<PhiloxBuffer>(double dx, double dy, double dh, PhiloxBuffer &rng);
+
 
 void Cell::Displace(void)
 {
@@ -1124,7 +1135,7 @@ double Cell::Energy(void) const
   double length_contribution = 0.;
 
   for (list<Node*>::const_iterator i = nodes.begin(); i != nodes.end(); i++) {
-    for (list<Neighbor>::const_iterator n = (*i)->owners.begin(); n != (*i)->owners.end(); n++) {
+    for (NodeOwners::const_iterator n = (*i)->owners.begin(); n != (*i)->owners.end(); n++) {
       if (n->getCell() == this) {
         length_contribution +=
           DSQR(Node::target_length - (*(*i) - *(n->nb1)).Norm()) +
@@ -1149,58 +1160,211 @@ double Cell::Energy(void) const
 
 
 
-bool Cell::SelfIntersect(void)
+/*! \brief Do segments (v1, v2) and (v3, v4) cross?
+
+  Segments that meet within TINY of an end point of either one, and
+  parallel segments, do not count as crossing.
+  method used: http://astronomy.swin.edu.au/~pbourke/geometry/lineline2d/
+*/
+static inline bool SegmentsCrossP(const Vector &v1, const Vector &v2, const Vector &v3, const Vector &v4)
 {
-  // The (obvious) O(N*N) algorithm
+  double denominator =
+    (v4.y - v3.y) * (v2.x - v1.x) - (v4.x - v3.x) * (v2.y - v1.y);
 
-  // Compare each edge against each other edge
+  double ua =
+    ((v4.x - v3.x) * (v1.y - v3.y) - (v4.y - v3.y) * (v1.x - v3.x)) / denominator;
+  double ub =
+    ((v2.x - v1.x) * (v1.y - v3.y) - (v2.y - v1.y) * (v1.x - v3.x)) / denominator;
 
-  // An O(N log(N)) algorithm by Shamos & Hoey (1976) supposedly exists;
-  // it was mentioned on comp.graphics.algorithms
+  return (TINY < ua && ua < 1. - TINY) && (TINY < ub && ub < 1. - TINY);
+}
 
-  // But I haven't been able to lay my hand on the paper.
-  // Let's try whether we need it....
+namespace {
 
-  // method used: http://astronomy.swin.edu.au/~pbourke/geometry/lineline2d/
+  // An edge of the polygon, from its left to its right end point
+  struct SweepSegment {
+    const Vector *left, *right;
 
-  for (list<Node*>::const_iterator i = nodes.begin(); i != nodes.end(); i++) {
+    // height of the segment at sweep position x
+    inline double YAt(double x) const {
+      if (right->x == left->x) return min(left->y, right->y);
+      return left->y + (right->y - left->y) * (x - left->x) / (right->x - left->x);
+    }
+    inline double Slope(void) const {
+      if (right->x == left->x) return numeric_limits<double>::infinity();
+      return (right->y - left->y) / (right->x - left->x);
+    }
+  };
+
+  struct SweepEvent {
+    double x, y;
+    int segment;
+    bool left;
+    // by x, insertions before removals, then by y
+    bool operator<(const SweepEvent &e) const {
+      if (x != e.x) return x < e.x;
+      if (left != e.left) return left;
+      return y < e.y;
+    }
+  };
+
+  // Orders the segments crossing the sweep line from bottom to top
+  struct SweepOrder {
+    const vector<SweepSegment> *segments;
+    const double *sweep_x;
+    bool operator()(int a, int b) const {
+      if (a == b) return false;
+      const SweepSegment &sa = (*segments)[a], &sb = (*segments)[b];
+      double ya = sa.YAt(*sweep_x), yb = sb.YAt(*sweep_x);
+      if (ya != yb) return ya < yb;
+      double ma = sa.Slope(), mb = sb.Slope();
+      if (ma != mb) return ma < mb;
+      return a < b;
+    }
+  };
 
-    list<Node*>::const_iterator j = i;
-    ++j;
-    for (; j != nodes.end(); j++)
-    {
+  enum SweepContact { NoContact, Crossing, Touching };
 
-      Vector v1 = *(*i);
-      list<Node*>::const_iterator nb = i;
-      nb++;
-      if (nb == nodes.end()) {
-        nb = nodes.begin();
-      }
-      Vector v2 = *(*nb);
-      Vector v3 = *(*j);
-      nb = j;
-      nb++;
-      if (nb == nodes.end()) {
-        nb = nodes.begin();
-      }
-      Vector v4 = *(*nb);
+  inline double Orientation(const Vector &a, const Vector &b, const Vector &c) {
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+  }
 
-      double denominator =
-        (v4.y - v3.y) * (v2.x - v1.x) - (v4.x - v3.x) * (v2.y - v1.y);
+  // is p, which is collinear with segment s, on s?
+  inline bool OnSegmentP(const SweepSegment &s, const Vector &p) {
+    return min(s.left->x, s.right->x) <= p.x && p.x <= max(s.left->x, s.right->x) &&
+      min(s.left->y, s.right->y) <= p.y && p.y <= max(s.left->y, s.right->y);
+  }
 
-      double ua =
-        ((v4.x - v3.x) * (v1.y - v3.y) - (v4.y - v3.y) * (v1.x - v3.x)) / denominator;
-      double ub =
-        ((v2.x - v1.x) * (v1.y - v3.y) - (v2.y - v1.y) * (v1.x - v3.x)) / denominator;
+  // Crossing if segments a and b cross in the sense of SegmentsCrossP;
+  // Touching if they otherwise meet (except at a shared node), which
+  // may change their order on the sweep line unnoticed.
+  SweepContact Contact(const vector<SweepSegment> &segments, int a, int b) {
+    const SweepSegment &sa = segments[a], &sb = segments[b];
 
+    if (SegmentsCrossP(*sa.left, *sa.right, *sb.left, *sb.right)) {
+      return Crossing;
+    }
+    if (sa.left == sb.left || sa.left == sb.right || sa.right == sb.left || sa.right == sb.right) {
+      return NoContact;
+    }
 
-      if ((TINY < ua && ua < 1. - TINY) && (TINY < ub && ub < 1. - TINY)) {
-        //cerr << "ua = " << ua << ", ub = " << ub << endl;
-        return true;
+    double o1 = Orientation(*sa.left, *sa.right, *sb.left), o2 = Orientation(*sa.left, *sa.right, *sb.right);
+    double o3 = Orientation(*sb.left, *sb.right, *sa.left), o4 = Orientation(*sb.left, *sb.right, *sa.right);
+
+    if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0))) {
+      return Touching; // crossing within TINY of an end point
+    }
+    if ((o1 == 0 && OnSegmentP(sa, *sb.left)) || (o2 == 0 && OnSegmentP(sa, *sb.right)) ||
+      (o3 == 0 && OnSegmentP(sb, *sa.left)) || (o4 == 0 && OnSegmentP(sb, *sa.right))) {
+      return Touching;
+    }
+    return NoContact;
+  }
+
+  // The O(N*N) test of each edge against each other edge
+  bool AllPairsCrossP(const vector<SweepSegment> &segments) {
+    for (int a = 0; a < (int)segments.size(); a++) {
+      for (int b = a + 1; b < (int)segments.size(); b++) {
+        if (SegmentsCrossP(*segments[a].left, *segments[a].right, *segments[b].left, *segments[b].right)) {
+          return true;
+        }
       }
     }
+    return false;
+  }
+}
+
+/*! \brief Test whether any two edges of the cell cross.
+
+  Uses the sweep line algorithm of Shamos & Hoey (1976), O(N log N): the
+  edges cut by a vertical line sweeping from left to right are kept
+  ordered by height, and only edges that become neighbors in that order
+  are tested against each other. The leftmost crossing is always between
+  two such neighbors, so the sweep stops as soon as one is found.
+
+  Crossings are tested as in SegmentsCrossP, so edges that merely touch
+  (such as consecutive edges at their shared node) do not count. The
+  sweep is only valid until the first contact of two edges, however,
+  so if two edges touch elsewhere, all pairs of edges are compared
+  instead.
+*/
+bool Cell::SelfIntersect(void)
+{
+  const int n = nodes.size();
+  if (n < 4) {
+    // a triangle cannot intersect itself
+    return false;
+  }
+
+  vector<SweepSegment> segments(n);
+  vector<SweepEvent> events(2 * n);
+
+  int k = 0;
+  for (list<Node*>::const_iterator i = nodes.begin(); i != nodes.end(); i++, k++) {
+    list<Node*>::const_iterator nb = i;
+    nb++;
+    if (nb == nodes.end()) {
+      nb = nodes.begin();
+    }
+    const Vector *v1 = *i, *v2 = *nb;
+    if (v2->x < v1->x || (v2->x == v1->x && v2->y < v1->y)) {
+      swap(v1, v2);
+    }
+    segments[k].left = v1;
+    segments[k].right = v2;
+
+    SweepEvent in = { v1->x, v1->y, k, true };
+    SweepEvent out = { v2->x, v2->y, k, false };
+    events[2 * k] = in;
+    events[2 * k + 1] = out;
   }
+  sort(events.begin(), events.end());
+
+  double sweep_x = events.front().x;
+  SweepOrder order = { &segments, &sweep_x };
+  typedef set<int, SweepOrder> SweepStatus;
+  SweepStatus status(order);
+  vector<SweepStatus::iterator> position(n);
+
+  for (vector<SweepEvent>::const_iterator e = events.begin(); e != events.end(); e++) {
+    sweep_x = e->x;
+    int s = e->segment;
+    SweepContact contact = NoContact;
+
+    if (e->left) {
+      SweepStatus::iterator pos = status.insert(s).first;
+      position[s] = pos;
+
+      SweepStatus::iterator above = pos;
+      above++;
+      if (above != status.end()) {
+        contact = Contact(segments, s, *above);
+      }
+      if (contact == NoContact && pos != status.begin()) {
+        SweepStatus::iterator below = pos;
+        below--;
+        contact = Contact(segments, s, *below);
+      }
+    }
+    else {
+      SweepStatus::iterator pos = position[s];
+      SweepStatus::iterator above = pos;
+      above++;
+      if (pos != status.begin() && above != status.end()) {
+        SweepStatus::iterator below = pos;
+        below--;
+        contact = Contact(segments, *below, *above);
+      }
+      status.erase(pos);
+    }
 
+    if (contact == Crossing) {
+      return true;
+    }
+    if (contact == Touching) {
+      return AllPairsCrossP(segments);
+    }
+  }
   return false;
 }
 
@@ -1273,6 +1437,77 @@ bool Cell::MoveSelfIntersectsP(Node* moving_node_ind, Vector new_pos)
   return false;
 }
 
+/*! \brief Copy the node list into node_ring and record each node's
+  position in it in the node's Neighbor entry for this cell.
+
+  The ring is only valid as long as "nodes" is unchanged; the Monte
+  Carlo sweep defers node insertions until it has finished, so Mesh
+  rebuilds it once per sweep.
+*/
+void Cell::BuildNodeRing(void)
+{
+  node_ring.assign(nodes.begin(), nodes.end());
+
+  for (int k = 0; k < (int)node_ring.size(); k++) {
+    for (NodeOwners::iterator o = node_ring[k]->owners.begin(); o != node_ring[k]->owners.end(); o++) {
+      if (o->cell == this) {
+        o->ring_pos = k;
+      }
+    }
+  }
+}
+
+/*! \brief As MoveSelfIntersectsP(Node*, Vector), using the position of
+  the moving node in node_ring stored in "owner" (its Neighbor entry for
+  this cell).
+
+  Looking up the moving node and its neighbors is then O(1), and the
+  remaining edges are read from contiguous memory. Falls back to the
+  list-based test if the ring is out of date.
+*/
+bool Cell::MoveSelfIntersectsP(const Neighbor &owner, Node *moving_node_ind, Vector new_pos) const
+{
+  const int n = node_ring.size();
+  const int pos = owner.ring_pos;
+
+  if (pos < 0 || pos >= n || node_ring[pos] != moving_node_ind || n != (int)nodes.size()) {
+    return const_cast<Cell *>(this)->MoveSelfIntersectsP(moving_node_ind, new_pos);
+  }
+
+  const Vector neighbor_of_moving_node[2] = {
+    *node_ring[pos + 1 < n ? pos + 1 : 0],
+    *node_ring[pos > 0 ? pos - 1 : n - 1]
+  };
+
+  // the n-2 edges (k, k+1) that do not contain the moving node, starting
+  // after it
+  for (int e = 1; e < n - 1; e++) {
+    int k = pos + e;
+    if (k >= n) k -= n;
+    int k1 = k + 1;
+    if (k1 >= n) k1 -= n;
+
+    const Vector &v3 = *node_ring[k];
+    const Vector &v4 = *node_ring[k1];
+
+    for (int j = 0; j < 2; j++) { // loop over the two neighbors of moving node
+
+      double denominator =
+        (v4.y - v3.y) * (neighbor_of_moving_node[j].x - new_pos.x) - (v4.x - v3.x) * (neighbor_of_moving_node[j].y - new_pos.y);
+
+      double ua =
+        ((v4.x - v3.x) * (new_pos.y - v3.y) - (v4.y - v3.y) * (new_pos.x - v3.x)) / denominator;
+      double ub =
+        ((neighbor_of_moving_node[j].x - new_pos.x) * (new_pos.y - v3.y) - (neighbor_of_moving_node[j].y - new_pos.y) * (new_pos.x - v3.x)) / denominator;
+
+      if ((TINY < ua && ua < 1. - TINY) && (TINY < ub && ub < 1. - TINY)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 /*! \brief Test if this cell intersects with the given line.
 
  */
@@ -1347,12 +1582,12 @@ void Cell::ConstructWalls(void)
     list<Cell*> owning_cells;
     Node& n(*(*i));
 
-    for (list<Neighbor>::const_iterator j = n.owners.begin(); j != n.owners.end(); j++) {
+    for (NodeOwners::const_iterator j = n.owners.begin(); j != n.owners.end(); j++) {
       owning_cells.push_back(j->cell);
     }
 
     Node& n2(*(*nb));
-    for (list<Neighbor>::const_iterator j = n2.owners.begin(); j != n2.owners.end(); j++) {
+    for (NodeOwners::const_iterator j = n2.owners.begin(); j != n2.owners.end(); j++) {
       owning_cells.push_back(j->cell);
     }
 
@@ -1431,7 +1666,7 @@ void Cell::Flux(double* flux, double* D)
   for (int c = 0; c < NChem(); c++)
     flux[c] = 0.;
 
-  for (list<Wall*>::iterator i = walls.begin(); i != walls.end(); i++) {
+  for (CellWalls::iterator i = walls.begin(); i != walls.end(); i++) {
 
     // leaf cannot take up chemicals from environment ("no flux boundary")
     if ((*i)->c2->BoundaryPolP()) continue;
@@ -1631,7 +1866,7 @@ void Cell::DrawValence(QGraphicsScene* c) const {
 void Cell::SetWallLengths(void)
 {
 
-  for (list<Wall*>::iterator de = walls.begin(); de != walls.end(); de++) {
+  for (CellWalls::iterator de = walls.begin(); de != walls.end(); de++) {
 
     // Step 1: find the path of nodes leading along the Wall.
     // A Wall often represents a curved cell wall: we want the total
@@ -1683,17 +1918,18 @@ void Cell::AddWall(Wall* w)
   walls.push_back(w);
 
   // Add wall to Mesh's list if it isn't there yet
-  if (find(m->walls.begin(), m->walls.end(), w) == m->walls.end()) {
+  if (!m->walls.contains(w)) {
     m->walls.push_back(w);
   }
 }
 
 //! Remove Wall w from the list of Walls
-list<Wall*>::iterator Cell::RemoveWall(Wall* w)
+CellWalls::iterator Cell::RemoveWall(Wall* w)
 {
 
-  // remove wall from Mesh's list
-  m->walls.erase(find(m->walls.begin(), m->walls.end(), w));
+  // remove wall from Mesh's list, and from its state vector
+  m->walls.erase(w);
+  w->DetachTransporters();
 
   // remove wall from Cell's list
   return walls.erase(find(walls.begin(), walls.end(), w));
@@ -43,6 +43,9 @@
 #include <libxml/tree.h>
 #include <QMouseEvent>
 
+class Neighbor;
+class LeafMLWriter;
+
 class Cell : public CellBase 
 {
 
@@ -112,13 +115,17 @@ class Cell : public CellBase
   }
 
   double Displace(double dx, double dy, double dh);
+  // as above, drawing the acceptance test from "rng"; instantiated for
+  // GlobalRandom and PhiloxBuffer
+  template<class RNG> double Displace(double dx, double dy, double dh, RNG &rng);
   void Displace(void);
   double Energy(void) const;
   bool SelfIntersect(void);
   bool MoveSelfIntersectsP(Node *nid, Vector new_pos);
+  bool MoveSelfIntersectsP(const Neighbor &owner, Node *nid, Vector new_pos) const;
   bool IntersectsWithLineP(const Vector v1, const Vector v2);
 
-  void XMLAdd(xmlNodePtr cells_node) const;
+  void XMLAdd(LeafMLWriter &writer) const;
 
   void ConstructWalls(void);
   void Flux(double *flux, double *D);
@@ -128,7 +135,7 @@ class Cell : public CellBase
   double MeanArea(void);
 
   void Apoptose(void); // Cell kills itself
-  list<Wall *>::iterator RemoveWall( Wall *w );
+  CellWalls::iterator RemoveWall( Wall *w );
   void AddWall( Wall *w );
 
   void Draw(QGraphicsScene *c, QString tooltip = QString::Null());
@@ -150,7 +157,7 @@ class Cell : public CellBase
   void ChemMonValue(double t, double *x);
 
  protected:
-  void XMLAddCore(xmlNodePtr xmlcell) const;
+  void XMLAddCore(LeafMLWriter &writer) const;
   int XMLRead(xmlNode *cur);
   void DivideWalls(ItList new_node_locations, const Vector from, const Vector to, bool wall_fixed = false, NodeSet *node_set = 0);
 
@@ -160,6 +167,14 @@ class Cell : public CellBase
   static double offset[3];
   static double factor;
   Mesh *m;
+
+  // contiguous copy of "nodes", valid during a Monte Carlo sweep. It
+  // holds the nodes rather than indices into flat coordinate arrays:
+  // the coordinates live in the Node objects, which the sweep moves,
+  // and NodeStore only copies them for SetCellIntegrals
+  vector<Node *> node_ring;
+  void BuildNodeRing(void);
+
   void ConstructConnections(void);
   void SetWallLengths(void);
 };
@@ -187,7 +202,7 @@ class BoundaryPolygon : public Cell {
   }
   virtual void Draw(QGraphicsScene *c, QString tooltip = QString::Null());
 
-  virtual void XMLAdd(xmlNodePtr parent_node) const;
+  virtual void XMLAdd(LeafMLWriter &writer) const;
 
   virtual bool BoundaryPolP(void) const { return true; } 
 };
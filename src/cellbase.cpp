@@ -47,6 +47,8 @@
 #include "mesh.h"
 #include "sqr.h"
 #include "tiny.h"
+#include "moments.h"
+#include "pool.h"
 
 static const std::string _module_id("$Id$");
 
@@ -70,11 +72,11 @@ CellBase::CellBase(QObject* parent) :
   Vector()
 {
 
-  chem = new double[NChem()];
+  chem = own_chem = ObjectPools().AllocateDoubles(NChem());
   for (int i = 0; i < NChem(); i++) {
     chem[i] = 0.;
   }
-  new_chem = new double[NChem()];
+  new_chem = ObjectPools().AllocateDoubles(NChem());
   for (int i = 0; i < NChem(); i++) {
     new_chem[i] = 0.;
   }
@@ -109,11 +111,11 @@ CellBase::CellBase(double x, double y, double z) : QObject(), Vector(x, y, z)
     static_data_members = new CellsStaticDatamembers();
   }
 #endif
-  chem = new double[NChem()];
+  chem = own_chem = ObjectPools().AllocateDoubles(NChem());
   for (int i = 0; i < NChem(); i++) {
     chem[i] = 0.;
   }
-  new_chem = new double[NChem()];
+  new_chem = ObjectPools().AllocateDoubles(NChem());
   for (int i = 0; i < NChem(); i++) {
     new_chem[i] = 0.;
   }
@@ -144,11 +146,11 @@ CellBase::CellBase(double x, double y, double z) : QObject(), Vector(x, y, z)
 CellBase::CellBase(const CellBase& src) : QObject(), Vector(src)
 {
 
-  chem = new double[NChem()];
+  chem = own_chem = ObjectPools().AllocateDoubles(NChem());
   for (int i = 0; i < NChem(); i++) {
     chem[i] = src.chem[i];
   }
-  new_chem = new double[NChem()];
+  new_chem = ObjectPools().AllocateDoubles(NChem());
   for (int i = 0; i < NChem(); i++) {
     new_chem[i] = src.new_chem[i];
   }
@@ -239,7 +241,7 @@ void CellBase::SetTransporters(int ch, double conc)
     error << "SetChemical: value ch = " << ch << " is out of range\n";
     throw error.str().c_str();
   }
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (CellWalls::iterator w = walls.begin(); w != walls.end(); w++) {
     (*w)->setTransporter(this, ch, conc);
   }
 }
@@ -263,7 +265,7 @@ ostream& CellBase::print(ostream& os) const
   }
   os << " } ";
 
-  for (list<Wall*>::const_iterator i = walls.begin(); i != walls.end(); i++) {
+  for (CellWalls::const_iterator i = walls.begin(); i != walls.end(); i++) {
     (*i)->print(os);
     os << ", ";
   }
@@ -272,7 +274,7 @@ ostream& CellBase::print(ostream& os) const
   os << " [ area = " << area << " ]";
   os << " [ walls = ";
 
-  for (list<Wall*>::const_iterator i = walls.begin(); i != walls.end(); i++) {
+  for (CellWalls::const_iterator i = walls.begin(); i != walls.end(); i++) {
     os << (*i)->n1->Index() << " -> " << (*i)->n2->Index() << ", " << (*i)->c1->Index() << " | " << (*i)->c2->Index() << ", ";
   }
   os << " ] ";
@@ -289,54 +291,55 @@ ostream& operator<<(ostream& os, const CellBase& c)
 }
 
 
-double CellBase::CalcArea(void) const
+/*! \brief Compute the area and moments of the cell's polygon in one
+  pass (see CalcPolygonMoments), after copying the node coordinates to
+  contiguous arrays.
+*/
+void CellBase::CalcMoments(PolygonMoments &m) const
 {
+  // cells with up to this many nodes are handled without allocation
+  const int stack_nodes = 256;
+  double stack_x[stack_nodes + 1], stack_y[stack_nodes + 1];
+  vector<double> heap_x, heap_y;
+
+  const int n = nodes.size();
+  double *x = stack_x, *y = stack_y;
+  if (n > stack_nodes) {
+    heap_x.resize(n + 1);
+    heap_y.resize(n + 1);
+    x = &heap_x[0];
+    y = &heap_y[0];
+  }
 
-  double loc_area = 0.;
-
-  for (list<Node*>::const_iterator i = nodes.begin(); i != (nodes.end()); i++) {
+  int k = 0;
+  for (list<Node*>::const_iterator i = nodes.begin(); i != nodes.end(); i++, k++) {
+    x[k] = (*i)->x;
+    y[k] = (*i)->y;
+  }
+  x[n] = n ? x[0] : 0.;
+  y[n] = n ? y[0] : 0.;
 
-    list<Node*>::const_iterator i_plus_1 = i; i_plus_1++;
-    if (i_plus_1 == nodes.end())
-      i_plus_1 = nodes.begin();
+  CalcPolygonMoments(x, y, n, m);
+}
 
-    loc_area += (*i)->x * (*i_plus_1)->y;
-    loc_area -= (*i_plus_1)->x * (*i)->y;
-  }
+double CellBase::CalcArea(void) const
+{
+  PolygonMoments m;
+  CalcMoments(m);
 
   // http://technology.niagarac.on.ca/courses/ctec1335/docs/arrays2.pdf	
-  return fabs(loc_area) / 2.0;
+  return fabs(m.area) / 2.0;
 }
 
 Vector CellBase::Centroid(void) const
 {
+  PolygonMoments m;
+  CalcMoments(m);
 
-  double area = 0.;
-  double integral_x_dxdy = 0., integral_y_dxdy = 0.;
+  double area = fabs(m.area) / 2.0;
 
-  for (list<Node*>::const_iterator i = nodes.begin(); i != (nodes.end()); i++) {
-
-    list<Node*>::const_iterator i_plus_1 = i; i_plus_1++;
-    if (i_plus_1 == nodes.end())
-      i_plus_1 = nodes.begin();
-
-    area += (*i)->x * (*i_plus_1)->y;
-    area -= (*i_plus_1)->x * (*i)->y;
-
-    integral_x_dxdy +=
-      ((*i_plus_1)->x + (*i)->x) *
-      ((*i)->x * (*i_plus_1)->y -
-      (*i_plus_1)->x * (*i)->y);
-    integral_y_dxdy +=
-      ((*i_plus_1)->y + (*i)->y) *
-      ((*i)->x * (*i_plus_1)->y -
-      (*i_plus_1)->x * (*i)->y);
-  }
-
-  area = fabs(area) / 2.0;
-
-  integral_x_dxdy /= 6.;
-  integral_y_dxdy /= 6.;
+  double integral_x_dxdy = m.x / 6.;
+  double integral_y_dxdy = m.y / 6.;
 
   Vector centroid(integral_x_dxdy, integral_y_dxdy, 0);
   centroid /= area;
@@ -353,45 +356,12 @@ void CellBase::SetIntegrals(void) const
 
   // these values will be updated after each move of the CellBase wall
 
-  intgrl_xx = 0.; intgrl_xy = 0.; intgrl_yy = 0.;
-  intgrl_x = 0.; intgrl_y = 0.;
-  area = 0.;
-  list<Node*>::const_iterator nb;
-  list<Node*>::const_iterator i = nodes.begin();
-
-  for (; i != (nodes.end()); i++) {
-
-    nb = i; nb++; if (nb == nodes.end()) nb = nodes.begin();
-
-    area += (*i)->x * (*nb)->y;
-    area -= (*nb)->x * (*i)->y;
-    intgrl_xx +=
-      ((*i)->x * (*i)->x +
-      (*nb)->x * (*i)->x +
-        (*nb)->x * (*nb)->x) *
-        ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y);
-    intgrl_xy +=
-      ((*nb)->x * (*i)->y -
-      (*i)->x * (*nb)->y) *
-        ((*i)->x * (2 * (*i)->y + (*nb)->y) +
-      (*nb)->x * ((*i)->y + 2 * (*nb)->y));
-    intgrl_yy +=
-      ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y) *
-        ((*i)->y * (*i)->y +
-      (*nb)->y * (*i)->y +
-          (*nb)->y * (*nb)->y);
-    intgrl_x +=
-      ((*nb)->x + (*i)->x) *
-      ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y);
-    intgrl_y +=
-      ((*nb)->y + (*i)->y) *
-      ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y);
-  }
-  area = fabs(area) / 2.0;
+  PolygonMoments m;
+  CalcMoments(m);
+
+  intgrl_xx = m.xx; intgrl_xy = m.xy; intgrl_yy = m.yy;
+  intgrl_x = m.x; intgrl_y = m.y;
+  area = fabs(m.area) / 2.0;
 }
 
 double CellBase::Length(Vector* long_axis, double* width)  const
@@ -441,45 +411,11 @@ double CellBase::CalcLength(Vector* long_axis, double* width)  const
   // Calculate inertia tensor
   // see file inertiatensor.nb for explanation of this method
 
-  double my_intgrl_xx = 0., my_intgrl_xy = 0., my_intgrl_yy = 0.;
-  double my_intgrl_x = 0., my_intgrl_y = 0., my_area = 0.;
-  my_area = 0.;
-  list<Node*>::const_iterator nb;
-  list<Node*>::const_iterator i = nodes.begin();
-
-  for (; i != (nodes.end()); i++) {
-
-    nb = i; nb++; if (nb == nodes.end()) nb = nodes.begin();
-
-    my_area += (*i)->x * (*nb)->y;
-    my_area -= (*nb)->x * (*i)->y;
-    my_intgrl_xx +=
-      ((*i)->x * (*i)->x +
-      (*nb)->x * (*i)->x +
-        (*nb)->x * (*nb)->x) *
-        ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y);
-    my_intgrl_xy +=
-      ((*nb)->x * (*i)->y -
-      (*i)->x * (*nb)->y) *
-        ((*i)->x * (2 * (*i)->y + (*nb)->y) +
-      (*nb)->x * ((*i)->y + 2 * (*nb)->y));
-    my_intgrl_yy +=
-      ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y) *
-        ((*i)->y * (*i)->y +
-      (*nb)->y * (*i)->y +
-          (*nb)->y * (*nb)->y);
-    my_intgrl_x +=
-      ((*nb)->x + (*i)->x) *
-      ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y);
-    my_intgrl_y +=
-      ((*nb)->y + (*i)->y) *
-      ((*i)->x * (*nb)->y -
-      (*nb)->x * (*i)->y);
-  }
+  PolygonMoments m;
+  CalcMoments(m);
 
+  double my_intgrl_xx = m.xx, my_intgrl_xy = m.xy, my_intgrl_yy = m.yy;
+  double my_intgrl_x = m.x, my_intgrl_y = m.y, my_area = m.area;
 
   //my_area/=2.0;
   my_area = fabs(my_area) / 2.0;
@@ -516,7 +452,7 @@ void CellBase::ConstructNeighborList(void)
 
   neighbors.clear();
   for (//list<Wall *>::const_reverse_iterator wit=walls.rbegin();
-    list<Wall*>::const_iterator wit = walls.begin();
+    CellWalls::const_iterator wit = walls.begin();
     // somehow the reverse_iterator returns by walls needs to be casted to const to let this work.
     // it seems to me it is a bug in the STL implementation...
 
@@ -670,7 +606,7 @@ void CellBase::SetTransporters(int ch) //WORTEL
     throw error.str().c_str();
   }
 
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++)
+  for (CellWalls::iterator w = walls.begin(); w != walls.end(); w++)
   {
 
     Vector ref(1., 0., 0.);
@@ -1082,7 +1018,7 @@ void CellBase::SetTransporters(int ch, double conc, double lat)
     throw error.str().c_str();
   }
 
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++)
+  for (CellWalls::iterator w = walls.begin(); w != walls.end(); w++)
   {
     Vector ref(1., 0., 0.);
     Vector wa = Vector(*(*w)->N2()) - Vector(*(*w)->N1());
@@ -37,6 +37,8 @@
 #include "wall.h"
 #include "warning.h"
 #include "assert.h"
+#include "pool.h"
+#include "smallvector.h"
 
 extern Parameter par;
 using namespace std;
@@ -45,6 +47,10 @@ class Mesh;
 class Node;
 class CellBase;
 class NodeSet;
+struct PolygonMoments;
+
+// The walls of a cell; most cells have no more than eight
+typedef SmallVector<Wall *, 8> CellWalls;
 
 struct ParentInfo {
 
@@ -85,19 +91,24 @@ class CellBase :  public QObject, public Vector
   friend class Node;
   friend class WallBase;
   friend class SimPluginInterface;
+  friend class NodeStore;
 
  public:
   CellBase(QObject *parent=0);
   CellBase(double x,double y,double z=0); // constructor
 
   virtual ~CellBase() {
-    delete[] chem;
-    delete[] new_chem;
+    PoolSet::Free(own_chem);
+    PoolSet::Free(new_chem);
     if (division_axis) delete division_axis;
     //cerr << "CellBase " << index << " is dying. " << endl;
   }
 
   CellBase(const CellBase &src); // copy constructor
+
+  // cells are allocated from the object pools
+  static void *operator new(size_t size) { return ObjectPools().Allocate(size); }
+  static void operator delete(void *p) { PoolSet::Free(p); }
   virtual bool BoundaryPolP(void) const { return false; } 
 
 
@@ -105,6 +116,15 @@ class CellBase :  public QObject, public Vector
   CellBase operator=(const Vector &src);
 
   void SetChemical(int chem, double conc);
+  //! Copy the chemicals back into the cell's own array and point "chem"
+  //! at it, e.g. when the cell leaves the mesh's state vector
+  void DetachChem(void) {
+    if (chem == own_chem) return;
+    for (int i = 0; i < NChem(); i++) {
+      own_chem[i] = chem[i];
+    }
+    chem = own_chem;
+  }
   inline void SetNewChem(int chem, double conc)
   { 
     new_chem[chem] = conc;
@@ -175,6 +195,7 @@ class CellBase :  public QObject, public Vector
 
   double Length(Vector *long_axis = 0, double *width = 0) const;
   double CalcLength(Vector *long_axis = 0, double *width = 0) const;
+  void CalcMoments(PolygonMoments &m) const;
 
   double ExactCircumference(void) const;
   inline int Index(void) const { return index; }
@@ -206,7 +227,7 @@ class CellBase :  public QObject, public Vector
 
   inline double WallCircumference(void) const {
     double sum=0.;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum +=  (*w)->Length();
@@ -217,7 +238,7 @@ class CellBase :  public QObject, public Vector
 
   QList<WallBase *> getWalls(void) {
     QList<WallBase *> wall_list;
-    for (list<Wall *>::iterator i=walls.begin();
+    for (CellWalls::iterator i=walls.begin();
 	 i!=walls.end();
 	 i++) {
       wall_list << *i;
@@ -271,7 +292,7 @@ class CellBase :  public QObject, public Vector
   double SumChemicalsOfNeighbors(int chem)
   {
     double sum=0.;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum +=  (*w)->Length() * ( (*w)->c1!=this ? (*w)->c1->Chemical(chem) : (*w)->c2->Chemical(chem) );
@@ -282,7 +303,7 @@ class CellBase :  public QObject, public Vector
   //! Generalization of the previous member function
   template<class P, class Op> P ReduceNeighbors(Op f) {
     P sum=0;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum += (*w)->c1 != this ? f( *((*w)->c1) ) : f ( *((*w)->c2) ); 
@@ -292,7 +313,7 @@ class CellBase :  public QObject, public Vector
 
   //! The same, but now for the walls
   template<class P, class Op> P ReduceWalls(Op f, P sum) {
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum += f( **w ); 
@@ -304,7 +325,7 @@ class CellBase :  public QObject, public Vector
   template<class P, class Op> P ReduceCellAndWalls(Op f)
   {
     P sum = 0;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum += ((*w)->c1 == this) ? 
@@ -319,7 +340,7 @@ class CellBase :  public QObject, public Vector
   double SumTransporters(int ch)
   {
     double sum=0.;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum += (*w)->getTransporter(this, ch);
@@ -334,7 +355,7 @@ class CellBase :  public QObject, public Vector
   double SumLengthTransporters(int ch)
   {
     double sum=0.;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum += (*w)->getTransporter(this, ch) * (*w)->Length();
@@ -348,7 +369,7 @@ class CellBase :  public QObject, public Vector
   double SumLengthTransportersChemical(int trch, int ch)
   {
     double sum=0.;
-    for (list<Wall *>::const_iterator w=walls.begin();
+    for (CellWalls::const_iterator w=walls.begin();
 	 w!=walls.end();
 	 w++) {
       sum += (*w)->getTransporter(this, trch) * ( (*w)->c1!=this ? (*w)->c1->Chemical(ch) : (*w)->c2->Chemical(ch) );
@@ -407,9 +428,12 @@ class CellBase :  public QObject, public Vector
   // lists ordered (clockwise), but I am not yet 100% sure...).
   list<CellBase *> neighbors;
 
-  list<Wall *> walls;
+  CellWalls walls;
 
+  // "chem" points either to the cell's own array, or to its slot in the
+  // mesh's state vector (see Mesh::BindState)
   double *chem;
+  double *own_chem;
   double *new_chem;
 
   boundary_type boundary;
@@ -474,7 +498,7 @@ public:
   bool HasNeighborOfTypeZero()//WORTEL
   {
     int prod = 1;
-    for (std::list<Wall*>::const_iterator w = walls.begin(); w != walls.end(); w++)
+    for (CellWalls::const_iterator w = walls.begin(); w != walls.end(); w++)
         {
           prod *= ( (*w)->c1 != this ? ( (*w)->c1->cell_type ) : ( (*w)->c2->cell_type ) );
         }
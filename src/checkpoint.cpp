@@ -0,0 +1,690 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include "checkpoint.h"
+#include "mesh.h"
+#include "parameter.h"
+#include "random.h"
+#include "nodeset.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+using namespace std;
+
+static inline uint64_t Align8(uint64_t n) { return (n + 7) & ~(uint64_t)7; }
+
+void CheckpointWriter::Section(const char *name, const void *data, size_t record_size, size_t count)
+{
+  Entry e;
+  e.name = name;
+  e.data = data;
+  e.record_size = record_size;
+  e.count = data ? count : 0;
+  entries.push_back(e);
+}
+
+bool CheckpointWriter::Write(const char *fname) const
+{
+  CheckpointHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.version = CHECKPOINT_VERSION;
+  header.byte_order = CHECKPOINT_BYTE_ORDER;
+  header.nsections = entries.size();
+
+  // lay out the sections after the table
+  vector<CheckpointSection> table(entries.size());
+  uint64_t offset = Align8(sizeof(header) + table.size() * sizeof(CheckpointSection));
+  for (size_t i=0;i<entries.size();i++) {
+    memset(&table[i], 0, sizeof(CheckpointSection));
+    strncpy(table[i].name, entries[i].name.c_str(), sizeof(table[i].name) - 1);
+    table[i].offset = offset;
+    table[i].count = entries[i].count;
+    table[i].record_size = entries[i].record_size;
+    offset = Align8(offset + (uint64_t)entries[i].record_size * entries[i].count);
+  }
+  header.size = offset;
+
+  FILE *fp = fopen(fname, "wb");
+  if (!fp) return false;
+
+  static const char padding[8] = {0};
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+  if (ok && !table.empty()) {
+    ok = fwrite(&table[0], sizeof(CheckpointSection), table.size(), fp) == table.size();
+  }
+  uint64_t pos = sizeof(header) + table.size() * sizeof(CheckpointSection);
+  for (size_t i=0;ok && i<entries.size();i++) {
+    ok = fwrite(padding, 1, table[i].offset - pos, fp) == table[i].offset - pos;
+    size_t bytes = entries[i].record_size * entries[i].count;
+    if (ok && bytes) {
+      ok = fwrite(entries[i].data, 1, bytes, fp) == bytes;
+    }
+    pos = table[i].offset + bytes;
+  }
+  if (ok) {
+    ok = fwrite(padding, 1, offset - pos, fp) == offset - pos;
+  }
+  return fclose(fp) == 0 && ok;
+}
+
+CheckpointReader::CheckpointReader(const char *fname) :
+  file(fname), data(0), size(0), sections(0), nsections(0)
+{
+  if (!file.open(QIODevice::ReadOnly)) {
+    throw("Could not open checkpoint file.");
+  }
+  size = file.size();
+  if (size < sizeof(CheckpointHeader) || !(data = file.map(0, size))) {
+    throw("Could not read checkpoint file.");
+  }
+
+  const CheckpointHeader *header = (const CheckpointHeader *)data;
+  if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic))) {
+    throw("Not a checkpoint file.");
+  }
+  if (header->byte_order != CHECKPOINT_BYTE_ORDER) {
+    throw("Checkpoint file was written on a machine of different byte order.");
+  }
+  if (header->version != CHECKPOINT_VERSION) {
+    throw("Checkpoint file was written by a different version of VirtualLeaf.");
+  }
+  nsections = header->nsections;
+  if (header->size != size || sizeof(CheckpointHeader) + (uint64_t)nsections * sizeof(CheckpointSection) > size) {
+    throw("Checkpoint file is truncated.");
+  }
+  sections = (const CheckpointSection *)(data + sizeof(CheckpointHeader));
+}
+
+CheckpointReader::~CheckpointReader(void)
+{
+  if (data) {
+    file.unmap((uchar *)data);
+  }
+}
+
+bool CheckpointReader::CheckpointP(const char *fname)
+{
+  FILE *fp = fopen(fname, "rb");
+  if (!fp) return false;
+  char magic[8];
+  bool is_checkpoint = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+    !memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic));
+  fclose(fp);
+  return is_checkpoint;
+}
+
+const void *CheckpointReader::Lookup(const char *name, size_t record_size, size_t &count) const
+{
+  count = 0;
+  for (uint32_t i=0;i<nsections;i++) {
+    const CheckpointSection &s = sections[i];
+    if (strncmp(s.name, name, sizeof(s.name))) continue;
+
+    if (s.record_size != record_size) {
+      Error(name, "has records of the wrong size");
+    }
+    if (s.offset % 8 || s.offset > size || s.count > (size - s.offset) / (record_size ? record_size : 1)) {
+      Error(name, "extends past the end of the file");
+    }
+    count = s.count;
+    return count ? data + s.offset : 0;
+  }
+  return 0;
+}
+
+void CheckpointReader::Error(const char *name, const char *what) const
+{
+  // the message must survive the throw
+  static string message;
+  message = string("Checkpoint section \"") + name + "\" " + what + ".";
+  throw(message.c_str());
+}
+
+// The records of the checkpoint sections that Mesh writes. They are
+// written as is, so their layouts must not change without increasing
+// CHECKPOINT_VERSION.
+
+struct CheckpointGlobals {
+  double time;
+  double node_target_length;
+  double offset_x, offset_y, magnification, base_area;
+  int32_t nchem;
+  int32_t reserved;
+};
+
+enum { NODE_FIXED = 1, NODE_BOUNDARY = 2, NODE_SAM = 4, NODE_DEAD = 8 };
+
+struct CheckpointNode {
+  double x, y;
+  int32_t flags;
+  int32_t nodeset; // or -1
+};
+
+enum { CELL_FIXED = 1, CELL_PIN_FIXED = 2, CELL_AT_BOUNDARY = 4, CELL_DEAD = 8, CELL_SOURCE = 16 };
+
+// The cells, followed by the boundary polygon; their nodes and walls
+// are ranges of the sections "cell_nodes" and "cell_walls"
+struct CheckpointCell {
+  double x, y, z;
+  double area, target_area, target_length, lambda_celllength, stiffness;
+  double intgrl_xx, intgrl_xy, intgrl_yy, intgrl_x, intgrl_y;
+  double source_conc, cell_cycle_time, division_time, astrain, prev_area;
+  double cellvec_x, cellvec_y, cellvec_z;
+  int32_t boundary, cell_type, div_counter, div_counter2, source_chem, flags;
+  int32_t first_node, nnodes, first_wall, nwalls;
+};
+
+enum { WALL_DEAD = 1 };
+
+struct CheckpointWall {
+  int32_t c1, c2; // -1 is the boundary polygon
+  int32_t n1, n2;
+  int32_t wall_type, flags;
+  double length, viz_flux, wall_strength, wall_strain;
+};
+
+static string NodeToText(xmlNode *node)
+{
+  string text;
+  xmlBufferPtr buf = xmlBufferCreate();
+  if (xmlNodeDump(buf, NULL, node, 0, 0) >= 0) {
+    text.assign((const char *)xmlBufferContent(buf), xmlBufferLength(buf));
+  }
+  xmlBufferFree(buf);
+  return text;
+}
+
+static xmlNode *TextToNode(const char *text, size_t n)
+{
+  if (!text || !n) return 0;
+  xmlDocPtr doc = xmlReadMemory(text, n, NULL, NULL, 0);
+  if (!doc) {
+    throw("Checkpoint file contains malformed parameters or settings.");
+  }
+  xmlNode *node = xmlCopyNode(xmlDocGetRootElement(doc), 1);
+  xmlFreeDoc(doc);
+  return node;
+}
+
+/*! Write the complete state of the simulation to a checkpoint file
+  (see CheckpointWriter): the geometry and chemistry of the mesh, the
+  parameters, the simulation time, the state of the random number
+  generator and the step size of the stiff ODE solver, so that
+  CheckpointRead continues the simulation exactly as if it had not
+  been interrupted. As for XMLSave, "options" is a settings tree to be
+  stored along; it is freed.
+*/
+void Mesh::CheckpointSave(const char *fname, xmlNode *options) const
+{
+  const int nchem = Cell::NChem();
+
+  // not while the values are in the ODE solver's arrays
+  assert(StateInPlaceP());
+
+  CheckpointGlobals globals;
+  memset(&globals, 0, sizeof(globals));
+  globals.time = time;
+  globals.node_target_length = Node::target_length;
+  globals.offset_x = Cell::offset[0];
+  globals.offset_y = Cell::offset[1];
+  globals.magnification = Cell::factor;
+  globals.base_area = Cell::BaseArea();
+  globals.nchem = nchem;
+
+  // node sets are numbered by their position
+  vector<int32_t> nodeset_offsets(1, 0), nodeset_nodes;
+  for (vector<NodeSet *>::const_iterator s=node_sets.begin(); s!=node_sets.end(); s++) {
+    for (NodeSet::const_iterator n=(*s)->begin(); n!=(*s)->end(); n++) {
+      nodeset_nodes.push_back((*n)->Index());
+    }
+    nodeset_offsets.push_back(nodeset_nodes.size());
+  }
+
+  vector<CheckpointNode> node_records(nodes.size());
+  for (size_t i=0;i<nodes.size();i++) {
+    const Node *n = nodes[i];
+    CheckpointNode &r = node_records[i];
+    memset(&r, 0, sizeof(r));
+    r.x = n->x;
+    r.y = n->y;
+    r.flags = (n->fixed ? NODE_FIXED : 0) | (n->boundary ? NODE_BOUNDARY : 0) |
+      (n->sam ? NODE_SAM : 0) | (n->dead ? NODE_DEAD : 0);
+    r.nodeset = -1;
+    if (n->node_set) {
+      r.nodeset = find(node_sets.begin(), node_sets.end(), n->node_set) - node_sets.begin();
+    }
+  }
+
+  vector<CheckpointCell> cell_records(cells.size() + 1);
+  vector<int32_t> cell_nodes, cell_walls;
+  for (size_t i=0;i<cell_records.size();i++) {
+    const Cell *c = i < cells.size() ? cells[i] : boundary_polygon;
+    CheckpointCell &r = cell_records[i];
+    memset(&r, 0, sizeof(r));
+    r.x = c->x; r.y = c->y; r.z = c->z;
+    r.area = c->area;
+    r.target_area = c->target_area;
+    r.target_length = c->target_length;
+    r.lambda_celllength = c->lambda_celllength;
+    r.stiffness = c->stiffness;
+    r.intgrl_xx = c->intgrl_xx; r.intgrl_xy = c->intgrl_xy; r.intgrl_yy = c->intgrl_yy;
+    r.intgrl_x = c->intgrl_x; r.intgrl_y = c->intgrl_y;
+    r.source_conc = c->source_conc;
+    r.cell_cycle_time = c->cell_cycle_time;
+    r.division_time = c->division_time;
+    r.astrain = c->astrain;
+    r.prev_area = c->prev_area;
+    r.cellvec_x = c->cellvec.x; r.cellvec_y = c->cellvec.y; r.cellvec_z = c->cellvec.z;
+    r.boundary = c->boundary;
+    r.cell_type = c->cell_type;
+    r.div_counter = c->div_counter;
+    r.div_counter2 = c->div_counter2;
+    r.source_chem = c->source_chem;
+    r.flags = (c->fixed ? CELL_FIXED : 0) | (c->pin_fixed ? CELL_PIN_FIXED : 0) |
+      (c->at_boundary ? CELL_AT_BOUNDARY : 0) | (c->dead ? CELL_DEAD : 0) | (c->source ? CELL_SOURCE : 0);
+
+    r.first_node = cell_nodes.size();
+    for (list<Node *>::const_iterator n=c->nodes.begin(); n!=c->nodes.end(); n++) {
+      cell_nodes.push_back((*n)->Index());
+    }
+    r.nnodes = cell_nodes.size() - r.first_node;
+
+    r.first_wall = cell_walls.size();
+    for (CellWalls::const_iterator w=c->walls.begin(); w!=c->walls.end(); w++) {
+      cell_walls.push_back((*w)->slot);
+    }
+    r.nwalls = cell_walls.size() - r.first_wall;
+  }
+
+  vector<CheckpointWall> wall_records;
+  wall_records.reserve(walls.size());
+  for (SlotMap<Wall>::const_iterator i=walls.begin(); i!=walls.end(); i++) {
+    const Wall *w = *i;
+    CheckpointWall r;
+    memset(&r, 0, sizeof(r));
+    r.c1 = w->c1->Index();
+    r.c2 = w->c2->Index();
+    r.n1 = w->n1->Index();
+    r.n2 = w->n2->Index();
+    r.wall_type = w->wall_type;
+    r.flags = w->dead ? WALL_DEAD : 0;
+    r.length = w->length;
+    r.viz_flux = w->viz_flux;
+    r.wall_strength = w->wall_strength;
+    r.wall_strain = w->wall_strain;
+    wall_records.push_back(r);
+  }
+
+  // the chemicals and transporters, laid out as in Derivatives
+  vector<double> state_values;
+  state_values.reserve((cells.size() + 2 * walls.size()) * nchem);
+  for (vector<Cell *>::const_iterator c=cells.begin(); c!=cells.end(); c++) {
+    state_values.insert(state_values.end(), (*c)->chem, (*c)->chem + nchem);
+  }
+  for (SlotMap<Wall>::const_iterator w=walls.begin(); w!=walls.end(); w++) {
+    state_values.insert(state_values.end(), (*w)->transporters1, (*w)->transporters1 + nchem);
+    state_values.insert(state_values.end(), (*w)->transporters2, (*w)->transporters2 + nchem);
+  }
+  vector<double> polygon_chem(boundary_polygon->chem, boundary_polygon->chem + nchem);
+
+  vector<int32_t> shuffled_node_ind, shuffled_cell_ind;
+  for (vector<Node *>::const_iterator n=shuffled_nodes.begin(); n!=shuffled_nodes.end(); n++) {
+    shuffled_node_ind.push_back((*n)->Index());
+  }
+  for (vector<Cell *>::const_iterator c=shuffled_cells.begin(); c!=shuffled_cells.end(); c++) {
+    shuffled_cell_ind.push_back((*c)->Index());
+  }
+
+  RandomState random_state;
+  GetRandomState(random_state);
+
+  // the parameters, and the settings, in LeafML, which covers them all
+  string parameters;
+  {
+    xmlNodePtr par_root = xmlNewNode(NULL, BAD_CAST "leaf");
+    par.XMLAdd(par_root);
+    parameters = NodeToText(par_root->children);
+    xmlFreeNode(par_root);
+  }
+  string settings;
+  if (options) {
+    settings = NodeToText(options);
+    xmlFreeNode(options);
+  }
+
+  CheckpointWriter writer;
+  writer.Section("globals", &globals, sizeof(globals), 1);
+  writer.Section("nodes", node_records);
+  writer.Section("nodeset_offsets", nodeset_offsets);
+  writer.Section("nodeset_nodes", nodeset_nodes);
+  writer.Section("cells", cell_records);
+  writer.Section("cell_nodes", cell_nodes);
+  writer.Section("cell_walls", cell_walls);
+  writer.Section("walls", wall_records);
+  writer.Section("state", state_values);
+  writer.Section("polygon_chem", polygon_chem);
+  writer.Section("shuffled_nodes", shuffled_node_ind);
+  writer.Section("shuffled_cells", shuffled_cell_ind);
+  writer.Section("random", &random_state, sizeof(random_state), 1);
+  writer.Section("stiff_step", &stiff_step, sizeof(stiff_step), 1);
+  writer.Section("parameter", parameters.data(), 1, parameters.size());
+  writer.Section("settings", settings.data(), 1, settings.size());
+
+  if (!writer.Write(fname)) {
+    MyWarning::warning("Could not write checkpoint file %s.", fname);
+  }
+}
+
+// Are all "n" indices in [lo, hi)?
+static bool InRange(const int32_t *ind, size_t n, int lo, int hi)
+{
+  for (size_t i=0;i<n;i++) {
+    if (ind[i] < lo || ind[i] >= hi) return false;
+  }
+  return true;
+}
+
+/*! Restore the simulation from a checkpoint file written by
+  CheckpointSave. As for XMLRead, "geometry", "pars" and "simtime"
+  select what is restored, and *settings is set to a copy of the
+  settings tree, or 0. The random number generator is restored along
+  with the parameters. The file is mapped into memory and checked in
+  full before the current mesh is replaced, so that a damaged file
+  leaves it as it was.
+*/
+void Mesh::CheckpointRead(const char *fname, xmlNode **settings, bool geometry, bool pars, bool simtime)
+{
+  CheckpointReader reader(fname);
+
+  const CheckpointGlobals *globals = reader.Required<CheckpointGlobals>("globals", 1);
+
+  size_t nnodes, ncells, nwalls, nnodesets, ncellnodes, ncellwalls, nnodesetnodes;
+  const CheckpointNode *node_records = reader.Section<CheckpointNode>("nodes", nnodes);
+  const int32_t *nodeset_offsets = reader.Section<int32_t>("nodeset_offsets", nnodesets);
+  const int32_t *nodeset_nodes = reader.Section<int32_t>("nodeset_nodes", nnodesetnodes);
+  const CheckpointCell *cell_records = reader.Section<CheckpointCell>("cells", ncells);
+  const int32_t *cell_nodes = reader.Section<int32_t>("cell_nodes", ncellnodes);
+  const int32_t *cell_walls = reader.Section<int32_t>("cell_walls", ncellwalls);
+  const CheckpointWall *wall_records = reader.Section<CheckpointWall>("walls", nwalls);
+
+  if (geometry) {
+    // the last "cell" is the boundary polygon
+    if (ncells < 1 || nnodesets < 1) {
+      throw("Checkpoint file contains no mesh.");
+    }
+    ncells--;
+    nnodesets--;
+
+    const int nchem = Cell::NChem();
+    if (globals->nchem != nchem) {
+      throw("Checkpoint file was written for a model with a different number of chemicals.");
+    }
+    reader.Required<double>("state", (ncells + 2 * nwalls) * nchem);
+    reader.Required<double>("polygon_chem", nchem);
+    reader.Required<int32_t>("shuffled_nodes", nnodes);
+
+    bool ok = nodeset_offsets[0] == 0 && nodeset_offsets[nnodesets] == (int32_t)nnodesetnodes &&
+      InRange(nodeset_nodes, nnodesetnodes, 0, nnodes);
+    for (size_t i=0;ok && i<nnodesets;i++) {
+      ok = nodeset_offsets[i] <= nodeset_offsets[i+1];
+    }
+    for (size_t i=0;ok && i<nnodes;i++) {
+      ok = node_records[i].nodeset >= -1 && node_records[i].nodeset < (int)nnodesets;
+    }
+    for (size_t i=0;ok && i<=ncells;i++) {
+      const CheckpointCell &r = cell_records[i];
+      ok = r.first_node >= 0 && r.nnodes >= 0 && (size_t)r.first_node + r.nnodes <= ncellnodes &&
+	r.first_wall >= 0 && r.nwalls >= 0 && (size_t)r.first_wall + r.nwalls <= ncellwalls;
+    }
+    ok = ok && InRange(cell_nodes, ncellnodes, 0, nnodes) && InRange(cell_walls, ncellwalls, 0, nwalls);
+    for (size_t i=0;ok && i<nwalls;i++) {
+      const CheckpointWall &r = wall_records[i];
+      ok = r.c1 >= -1 && r.c1 < (int)ncells && r.c2 >= -1 && r.c2 < (int)ncells &&
+	r.n1 >= 0 && r.n1 < (int)nnodes && r.n2 >= 0 && r.n2 < (int)nnodes;
+    }
+    size_t nshuffled;
+    const int32_t *shuffled_cell_ind = reader.Section<int32_t>("shuffled_cells", nshuffled);
+    ok = ok && nshuffled == ncells && InRange(shuffled_cell_ind, ncells, 0, ncells) &&
+      InRange(reader.Required<int32_t>("shuffled_nodes", nnodes), nnodes, 0, nnodes);
+    if (!ok) {
+      throw("Checkpoint file refers to nodes, cells or walls that do not exist.");
+    }
+  }
+
+  size_t nparameters, nsettings;
+  const char *parameters = reader.Section<char>("parameter", nparameters);
+  const char *settings_text = reader.Section<char>("settings", nsettings);
+
+  if (pars && !nparameters) {
+    throw("Checkpoint file contains no parameters.");
+  }
+  const RandomState *random_state = pars ? reader.Required<RandomState>("random", 1) : 0;
+
+  // parse the parameters before anything is changed
+  xmlNode *parameter_tree = pars ? TextToNode(parameters, nparameters) : 0;
+
+  // if settings field is not found, *settings will be returned 0.
+  if (settings) {
+    *settings = TextToNode(settings_text, nsettings);
+  }
+
+  if (geometry) {
+
+    for (vector<Node *>::iterator i=nodes.begin(); i!=nodes.end(); i++) {
+      delete *i;
+    }
+    nodes.clear();
+    Node::nnodes = 0;
+    Node::target_length = globals->node_target_length;
+
+    nodes.reserve(nnodes);
+    for (size_t i=0;i<nnodes;i++) {
+      const CheckpointNode &r = node_records[i];
+      Node *new_node = new Node(r.x, r.y);
+      new_node->m = this;
+      new_node->fixed = r.flags & NODE_FIXED;
+      new_node->boundary = r.flags & NODE_BOUNDARY;
+      new_node->sam = r.flags & NODE_SAM;
+      new_node->dead = r.flags & NODE_DEAD;
+      new_node->node_set = 0;
+      nodes.push_back(new_node);
+    }
+
+    for (vector<NodeSet *>::iterator i=node_sets.begin(); i!=node_sets.end(); i++) {
+      delete *i;
+    }
+    node_sets.clear();
+    for (size_t s=0;s<nnodesets;s++) {
+      NodeSet *new_nodeset = new NodeSet();
+      node_sets.push_back(new_nodeset);
+      for (int k=nodeset_offsets[s];k<nodeset_offsets[s+1];k++) {
+	new_nodeset->AddNode(nodes[nodeset_nodes[k]]);
+      }
+    }
+    // Node::node_set as it was saved. XMLRead takes the sets from the
+    // lists alone, which gives a node the last set that lists it; that
+    // need not be the one it pointed to, and a restart must be exact
+    for (size_t i=0;i<nnodes;i++) {
+      nodes[i]->node_set = node_records[i].nodeset >= 0 ? node_sets[node_records[i].nodeset] : 0;
+    }
+
+    for (vector<Cell *>::iterator i=cells.begin(); i!=cells.end(); i++) {
+      delete *i;
+    }
+    cells.clear();
+    Cell::NCells() = 0;
+    if (boundary_polygon) {
+      delete boundary_polygon;
+      boundary_polygon = 0;
+    }
+
+    Cell::setOffset(globals->offset_x, globals->offset_y);
+    Cell::SetMagnification(globals->magnification);
+    Cell::BaseArea() = globals->base_area;
+
+    cells.reserve(ncells);
+    for (size_t i=0;i<=ncells;i++) {
+      const CheckpointCell &r = cell_records[i];
+      Cell *c;
+      if (i < ncells) {
+	c = new Cell(r.x, r.y, r.z);
+	cells.push_back(c);
+      } else {
+	c = boundary_polygon = new BoundaryPolygon(r.x, r.y, r.z);
+      }
+      c->m = this;
+      c->area = r.area;
+      c->target_area = r.target_area;
+      c->target_length = r.target_length;
+      c->lambda_celllength = r.lambda_celllength;
+      c->stiffness = r.stiffness;
+      c->source_conc = r.source_conc;
+      c->cell_cycle_time = r.cell_cycle_time;
+      c->division_time = r.division_time;
+      c->astrain = r.astrain;
+      c->prev_area = r.prev_area;
+      c->cellvec = Vector(r.cellvec_x, r.cellvec_y, r.cellvec_z);
+      c->boundary = (Cell::boundary_type)r.boundary;
+      c->cell_type = r.cell_type;
+      c->div_counter = r.div_counter;
+      c->div_counter2 = r.div_counter2;
+      c->source_chem = r.source_chem;
+      c->fixed = r.flags & CELL_FIXED;
+      c->pin_fixed = r.flags & CELL_PIN_FIXED;
+      c->at_boundary = r.flags & CELL_AT_BOUNDARY;
+      c->dead = r.flags & CELL_DEAD;
+      c->source = r.flags & CELL_SOURCE;
+
+      const int32_t *ring = cell_nodes + r.first_node;
+      for (int k=0;k<r.nnodes;k++) {
+	AddNodeToCell(c,
+		      nodes[ring[k]],
+		      nodes[ring[(r.nnodes+k-1)%r.nnodes]],
+		      nodes[ring[(k+1)%r.nnodes]]);
+      }
+    }
+
+    for (SlotMap<Wall>::iterator i=walls.begin(); i!=walls.end(); i++) {
+      delete *i;
+    }
+    walls.clear();
+    Wall::nwalls = 0;
+
+    walls.reserve(nwalls);
+    for (size_t i=0;i<nwalls;i++) {
+      const CheckpointWall &r = wall_records[i];
+      Wall *w = new Wall(nodes[r.n1], nodes[r.n2],
+			 r.c1 != -1 ? cells[r.c1] : boundary_polygon,
+			 r.c2 != -1 ? cells[r.c2] : boundary_polygon);
+      w->wall_type = (Wall::WallType)r.wall_type;
+      w->dead = r.flags & WALL_DEAD;
+      w->length = r.length;
+      w->viz_flux = r.viz_flux;
+      w->wall_strength = r.wall_strength;
+      w->wall_strain = r.wall_strain;
+      walls.push_back(w);
+    }
+
+    for (size_t i=0;i<=ncells;i++) {
+      const CheckpointCell &r = cell_records[i];
+      Cell *c = i < ncells ? cells[i] : boundary_polygon;
+      for (int k=r.first_wall;k<r.first_wall+r.nwalls;k++) {
+	c->walls.push_back(walls[cell_walls[k]]);
+      }
+    }
+
+    XMLConnectGeometry();
+
+    // XMLConnectGeometry recalculates the cells' integrals, and
+    // reshuffles; take them as they were, which may differ in the
+    // last bits, and in order
+    for (size_t i=0;i<=ncells;i++) {
+      const CheckpointCell &r = cell_records[i];
+      Cell *c = i < ncells ? cells[i] : boundary_polygon;
+      c->area = r.area;
+      c->intgrl_xx = r.intgrl_xx; c->intgrl_xy = r.intgrl_xy; c->intgrl_yy = r.intgrl_yy;
+      c->intgrl_x = r.intgrl_x; c->intgrl_y = r.intgrl_y;
+    }
+
+    const int32_t *shuffled_node_ind = reader.Required<int32_t>("shuffled_nodes", nnodes);
+    const int32_t *shuffled_cell_ind = reader.Required<int32_t>("shuffled_cells", ncells);
+    shuffled_nodes.resize(nnodes);
+    for (size_t i=0;i<nnodes;i++) {
+      shuffled_nodes[i] = nodes[shuffled_node_ind[i]];
+    }
+    shuffled_cells.resize(ncells);
+    for (size_t i=0;i<ncells;i++) {
+      shuffled_cells[i] = cells[shuffled_cell_ind[i]];
+    }
+
+    const int nchem = Cell::NChem();
+    const double *y = reader.Required<double>("state", (ncells + 2 * nwalls) * nchem);
+    for (vector<Cell *>::iterator c=cells.begin(); c!=cells.end(); c++) {
+      copy(y, y + nchem, (*c)->chem);
+      y += nchem;
+    }
+    for (SlotMap<Wall>::iterator w=walls.begin(); w!=walls.end(); w++) {
+      copy(y, y + nchem, (*w)->transporters1);
+      copy(y + nchem, y + 2 * nchem, (*w)->transporters2);
+      y += 2 * nchem;
+    }
+    const double *polygon_chem = reader.Required<double>("polygon_chem", nchem);
+    copy(polygon_chem, polygon_chem + nchem, boundary_polygon->chem);
+  }
+
+  if (pars) {
+    xmlNode *root_element = xmlNewNode(NULL, BAD_CAST "leaf");
+    xmlAddChild(root_element, parameter_tree);
+    XMLReadPars(root_element);
+    xmlFreeNode(root_element);
+
+    // XMLReadPars has reseeded; continue where the run left off instead
+    SetRandomState(*random_state);
+  }
+  // a new mesh starts the stiff solver afresh; a restart continues
+  // with the step size it had reached
+  if (geometry || simtime) {
+    stiff_step = 0.;
+  }
+  if (geometry) {
+    InvalidateEdgeGrid();
+  }
+  if (simtime) {
+    time = globals->time;
+    size_t n;
+    const double *step = reader.Section<double>("stiff_step", n);
+    if (n == 1) {
+      stiff_step = *step;
+    }
+  }
+}
+
+/* finis */
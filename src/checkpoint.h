@@ -0,0 +1,138 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <QFile>
+
+/*! \brief Checkpoint files: the complete state of a simulation, in
+  binary, for fast saving and exact restarts.
+
+  A checkpoint is a CheckpointHeader, a table of CheckpointSections,
+  and the sections' data: flat arrays of fixed-size records, each
+  starting at a multiple of eight bytes, in the byte order of the
+  machine that wrote it. A file can therefore be mapped into memory
+  and its arrays used where they are, without parsing. The format has
+  a version number, which must be increased whenever a record changes;
+  sections a reader does not know are ignored, so new ones can be
+  added without.
+
+  See Mesh::CheckpointSave and Mesh::CheckpointRead for the contents.
+*/
+
+#define CHECKPOINT_MAGIC "VLEAFCKP"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_BYTE_ORDER 0x01020304
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order; // CHECKPOINT_BYTE_ORDER, as written
+  uint32_t nsections;
+  uint32_t reserved;
+  uint64_t size; // of the whole file, to detect truncation
+};
+
+struct CheckpointSection {
+  char name[16]; // zero padded
+  uint64_t offset; // from the start of the file
+  uint64_t count; // number of records
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+//! Collects sections, and writes them out as a checkpoint file
+class CheckpointWriter {
+
+ public:
+  //! Add a section; the data must remain valid until Write
+  void Section(const char *name, const void *data, size_t record_size, size_t count);
+
+  template<class T> inline void Section(const char *name, const std::vector<T> &v) {
+    Section(name, v.empty() ? 0 : &v[0], sizeof(T), v.size());
+  }
+
+  //! \return false if the file could not be written
+  bool Write(const char *fname) const;
+
+ private:
+  struct Entry {
+    std::string name;
+    const void *data;
+    size_t record_size, count;
+  };
+  std::vector<Entry> entries;
+};
+
+//! Maps a checkpoint file into memory, and looks up its sections
+class CheckpointReader {
+
+ public:
+  //! Throws an error message if the file is not a valid checkpoint
+  CheckpointReader(const char *fname);
+  ~CheckpointReader(void);
+
+  //! Does the file start like a checkpoint?
+  static bool CheckpointP(const char *fname);
+
+  //! The records of section "name", and their number, or 0 if the
+  //! section is missing. A section with records of another size than
+  //! T is an error.
+  template<class T> inline const T *Section(const char *name, size_t &count) const {
+    return (const T *)Lookup(name, sizeof(T), count);
+  }
+
+  //! As Section, but a missing section, or one of another number of
+  //! records than "count", is an error
+  template<class T> inline const T *Required(const char *name, size_t count) const {
+    size_t n;
+    const T *data = Section<T>(name, n);
+    if (!data && count) Error(name, "is missing");
+    if (n != count) Error(name, "has the wrong number of records");
+    return data;
+  }
+
+ private:
+  CheckpointReader(const CheckpointReader &);
+  CheckpointReader &operator=(const CheckpointReader &);
+
+  const void *Lookup(const char *name, size_t record_size, size_t &count) const;
+  void Error(const char *name, const char *what) const;
+
+  QFile file;
+  const uchar *data;
+  size_t size;
+  const CheckpointSection *sections;
+  uint32_t nsections;
+};
+
+#endif
+
+/* finis */
@@ -0,0 +1,221 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include "edgegrid.h"
+#include "tiny.h"
+
+static const std::string _module_id("$Id$");
+
+EdgeGrid::EdgeGrid(void) :
+  x0(0.), y0(0.), bucket_size(1.), nx(0), ny(0) {}
+
+void EdgeGrid::Clear(void)
+{
+  edges.clear();
+  node_edges.clear();
+  buckets.clear();
+  nx = ny = 0;
+}
+
+void EdgeGrid::Build(const vector<Edge> &new_edges, int n_nodes)
+{
+  Clear();
+  edges = new_edges;
+  node_edges.resize(n_nodes);
+
+  if (edges.empty()) return;
+
+  double minx = edges[0].first->x, maxx = minx;
+  double miny = edges[0].first->y, maxy = miny;
+  double sum_length = 0.;
+
+  for (int e = 0; e < (int)edges.size(); e++) {
+    const Node *n[2] = { edges[e].first, edges[e].second };
+    for (int i = 0; i < 2; i++) {
+      minx = min(minx, n[i]->x); maxx = max(maxx, n[i]->x);
+      miny = min(miny, n[i]->y); maxy = max(maxy, n[i]->y);
+      if (n[i]->Index() < n_nodes) {
+        node_edges[n[i]->Index()].push_back(e);
+      }
+    }
+    sum_length += (*n[1] - *n[0]).Norm();
+  }
+
+  // Buckets of about twice the mean edge length, so that a segment
+  // typically overlaps few buckets, but no more buckets than edges
+  double width = maxx - minx, height = maxy - miny;
+  bucket_size = max(2. * sum_length / edges.size(), sqrt(width * height / edges.size()));
+  if (bucket_size <= 0.) bucket_size = 1.;
+
+  // leave a margin of one bucket for nodes that move outward; beyond
+  // that, coordinates are clamped to the outermost buckets
+  x0 = minx - bucket_size;
+  y0 = miny - bucket_size;
+  nx = (int)(width / bucket_size) + 3;
+  ny = (int)(height / bucket_size) + 3;
+  buckets.resize(nx * ny);
+
+  for (int e = 0; e < (int)edges.size(); e++) {
+    AddToBuckets(e, *edges[e].first, *edges[e].second);
+  }
+}
+
+inline int EdgeGrid::BucketX(double x) const
+{
+  int i = (int)floor((x - x0) / bucket_size);
+  return i < 0 ? 0 : (i >= nx ? nx - 1 : i);
+}
+
+inline int EdgeGrid::BucketY(double y) const
+{
+  int j = (int)floor((y - y0) / bucket_size);
+  return j < 0 ? 0 : (j >= ny ? ny - 1 : j);
+}
+
+void EdgeGrid::AddToBuckets(int e, const Vector &v1, const Vector &v2)
+{
+  int i1 = BucketX(min(v1.x, v2.x)), i2 = BucketX(max(v1.x, v2.x));
+  int j1 = BucketY(min(v1.y, v2.y)), j2 = BucketY(max(v1.y, v2.y));
+
+  for (int j = j1; j <= j2; j++) {
+    for (int i = i1; i <= i2; i++) {
+      buckets[j * nx + i].push_back(e);
+    }
+  }
+}
+
+void EdgeGrid::RemoveFromBuckets(int e, const Vector &v1, const Vector &v2)
+{
+  int i1 = BucketX(min(v1.x, v2.x)), i2 = BucketX(max(v1.x, v2.x));
+  int j1 = BucketY(min(v1.y, v2.y)), j2 = BucketY(max(v1.y, v2.y));
+
+  for (int j = j1; j <= j2; j++) {
+    for (int i = i1; i <= i2; i++) {
+      vector<int> &bucket = buckets[j * nx + i];
+      vector<int>::iterator pos = find(bucket.begin(), bucket.end(), e);
+      if (pos != bucket.end()) {
+        *pos = bucket.back();
+        bucket.pop_back();
+      }
+    }
+  }
+}
+
+void EdgeGrid::MoveNode(const Node *n, const Vector &old_pos)
+{
+  if (buckets.empty() || n->Index() >= (int)node_edges.size()) return;
+
+  const vector<int> &incident = node_edges[n->Index()];
+  for (vector<int>::const_iterator e = incident.begin(); e != incident.end(); e++) {
+    const Node *other = edges[*e].first == n ? edges[*e].second : edges[*e].first;
+    RemoveFromBuckets(*e, old_pos, *other);
+    AddToBuckets(*e, *n, *other);
+  }
+}
+
+/*! Edges of which both ends have moved are taken out of the buckets
+  of where both ends were, which calling MoveNode for each node in turn
+  would get wrong.
+*/
+void EdgeGrid::MoveNodes(const vector< pair<const Node *, Vector> > &moved)
+{
+  if (buckets.empty()) return;
+
+  vector<int> incident;
+  for (vector< pair<const Node *, Vector> >::const_iterator m = moved.begin(); m != moved.end(); m++) {
+    int i = m->first->Index();
+    if (i < (int)node_edges.size()) {
+      incident.insert(incident.end(), node_edges[i].begin(), node_edges[i].end());
+    }
+  }
+  sort(incident.begin(), incident.end());
+  incident.erase(unique(incident.begin(), incident.end()), incident.end());
+
+  for (vector<int>::const_iterator e = incident.begin(); e != incident.end(); e++) {
+    const Node *n1 = edges[*e].first, *n2 = edges[*e].second;
+    Vector old1 = *n1, old2 = *n2;
+    for (vector< pair<const Node *, Vector> >::const_iterator m = moved.begin(); m != moved.end(); m++) {
+      if (m->first == n1) old1 = m->second;
+      if (m->first == n2) old2 = m->second;
+    }
+    RemoveFromBuckets(*e, old1, old2);
+    AddToBuckets(*e, *n1, *n2);
+  }
+}
+
+bool EdgeGrid::MoveIntersectsP(const Node *n, const Vector &new_pos) const
+{
+  if (buckets.empty() || n->Index() >= (int)node_edges.size()) return false;
+
+  const vector<int> &incident = node_edges[n->Index()];
+  for (vector<int>::const_iterator e = incident.begin(); e != incident.end(); e++) {
+    const Node *other = edges[*e].first == n ? edges[*e].second : edges[*e].first;
+    if (IntersectsWithLineP(new_pos, *other, n)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*! Same test and TINY tolerance as Cell::IntersectsWithLineP, so that
+  segments that merely touch at an end point do not count as crossing.
+*/
+bool EdgeGrid::IntersectsWithLineP(const Vector &v1, const Vector &v2, const Node *skip) const
+{
+  if (buckets.empty()) return false;
+
+  int i1 = BucketX(min(v1.x, v2.x)), i2 = BucketX(max(v1.x, v2.x));
+  int j1 = BucketY(min(v1.y, v2.y)), j2 = BucketY(max(v1.y, v2.y));
+
+  for (int j = j1; j <= j2; j++) {
+    for (int i = i1; i <= i2; i++) {
+      const vector<int> &bucket = buckets[j * nx + i];
+      for (vector<int>::const_iterator e = bucket.begin(); e != bucket.end(); e++) {
+
+        const Edge &edge = edges[*e];
+        if (edge.first == skip || edge.second == skip) {
+          continue;
+        }
+
+        const Vector &v3 = *edge.first;
+        const Vector &v4 = *edge.second;
+
+        double denominator =
+          (v4.y - v3.y) * (v2.x - v1.x) - (v4.x - v3.x) * (v2.y - v1.y);
+
+        double ua =
+          ((v4.x - v3.x) * (v1.y - v3.y) - (v4.y - v3.y) * (v1.x - v3.x)) / denominator;
+        double ub =
+          ((v2.x - v1.x) * (v1.y - v3.y) - (v2.y - v1.y) * (v1.x - v3.x)) / denominator;
+
+        if ((TINY < ua && ua < 1. - TINY) && (TINY < ub && ub < 1. - TINY)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/* finis */
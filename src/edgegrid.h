@@ -0,0 +1,87 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _EDGEGRID_H_
+#define _EDGEGRID_H_
+
+#include <vector>
+#include "vector.h"
+#include "node.h"
+
+using namespace std;
+
+/*! \brief Uniform grid of buckets over the edges (cell wall segments) of
+  the mesh, for local segment crossing queries.
+
+  Each edge is stored once, in every bucket overlapped by its bounding
+  box. Mesh rebuilds the grid at the start of each Monte Carlo sweep and
+  moves the edges of a node along with each displacement (including
+  those of node sets and fixed cells, which move many nodes), so
+  that a proposed move can be tested against all nearby edges, whatever
+  cell (or the boundary polygon) they belong to.
+*/
+class EdgeGrid {
+
+ public:
+  EdgeGrid(void);
+
+  void Clear(void);
+
+  // "edges" must be unique; "n_nodes" is one more than the largest node index
+  void Build(const vector<Edge> &edges, int n_nodes);
+
+  // Update the buckets of the edges of "n", which has moved from "old_pos"
+  void MoveNode(const Node *n, const Vector &old_pos);
+
+  // As MoveNode, for nodes that have moved together, each listed with
+  // its old position
+  void MoveNodes(const vector< pair<const Node *, Vector> > &moved);
+
+  // Would any edge of "n" cross another edge if "n" were moved to "new_pos"?
+  bool MoveIntersectsP(const Node *n, const Vector &new_pos) const;
+
+  // Does segment (v1, v2) cross any edge that does not contain node "skip"?
+  bool IntersectsWithLineP(const Vector &v1, const Vector &v2, const Node *skip = 0) const;
+
+  inline bool EmptyP(void) const { return edges.empty(); }
+
+ private:
+  inline int BucketX(double x) const;
+  inline int BucketY(double y) const;
+  void AddToBuckets(int e, const Vector &v1, const Vector &v2);
+  void RemoveFromBuckets(int e, const Vector &v1, const Vector &v2);
+
+  vector<Edge> edges;
+  // per node index, the edges that contain the node
+  vector< vector<int> > node_edges;
+  // nx * ny buckets of edge indices, row major
+  vector< vector<int> > buckets;
+
+  double x0, y0, bucket_size;
+  int nx, ny;
+};
+
+#endif
+
+/* finis */
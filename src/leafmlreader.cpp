@@ -0,0 +1,168 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <cctype>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "leafmlreader.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+LeafMLReader::LeafMLReader(const char *fname) :
+  failed(false), pending(false), type(XML_READER_TYPE_NONE)
+{
+  reader = xmlReaderForFile(fname, NULL, 0);
+  if (!reader) {
+    failed = true;
+  }
+
+  // strtod uses the decimal point of the C locale, which Qt may have
+  // set from the environment
+  decimal_point = localeconv()->decimal_point[0];
+}
+
+LeafMLReader::~LeafMLReader(void)
+{
+  if (reader) {
+    xmlFreeTextReader(reader);
+  }
+}
+
+int LeafMLReader::Read(void)
+{
+  if (failed) return -1;
+  int result = xmlTextReaderRead(reader);
+  if (result < 0) {
+    failed = true;
+  }
+  return result;
+}
+
+bool LeafMLReader::Next(void)
+{
+  if (failed) return false;
+
+  for (;;) {
+    if (pending) {
+      pending = false;
+    } else if (Read() <= 0) {
+      type = XML_READER_TYPE_NONE;
+      return false;
+    }
+    type = xmlTextReaderNodeType(reader);
+    if (type == XML_READER_TYPE_ELEMENT || type == XML_READER_TYPE_END_ELEMENT) {
+      return true;
+    }
+  }
+}
+
+bool LeafMLReader::NextChild(int depth)
+{
+  // an empty element has no children, nor an end tag
+  if (StartP() && Depth() == depth && EmptyP()) {
+    return false;
+  }
+  while (Next()) {
+    if (Depth() <= depth) {
+      return false;
+    }
+    if (StartP() && Depth() == depth + 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LeafMLReader::Skip(void)
+{
+  if (failed || !StartP() || EmptyP()) return;
+  int result = xmlTextReaderNext(reader);
+  if (result < 0) {
+    failed = true;
+  }
+  // positioned on the node after the element; Next() starts from there
+  pending = result > 0;
+  type = XML_READER_TYPE_NONE;
+  if (result == 0) {
+    // end of the document
+    pending = false;
+  }
+}
+
+xmlNode *LeafMLReader::CopySubtree(void)
+{
+  xmlNode *node = xmlTextReaderExpand(reader);
+  if (!node) {
+    failed = true;
+    return 0;
+  }
+  xmlNode *copy = xmlCopyNode(node, 1);
+  Skip();
+  return copy;
+}
+
+bool LeafMLReader::Is(const char *name) const
+{
+  return !strcmp(Name(), name);
+}
+
+const char *LeafMLReader::Attribute(const char *name) const
+{
+  xmlNode *node = xmlTextReaderCurrentNode(reader);
+  for (xmlAttr *a = node->properties; a; a = a->next) {
+    if (!strcmp((const char *)a->name, name)) {
+      // LeafML attributes are plain text, without entity references
+      xmlNode *text = a->children;
+      if (text && text->type == XML_TEXT_NODE && !text->next) {
+        return (const char *)text->content;
+      }
+      xmlChar *v = xmlNodeListGetString(a->doc, text, 1);
+      value = v ? (const char *)v : "";
+      xmlFree(v);
+      return value.c_str();
+    }
+  }
+  return 0;
+}
+
+double LeafMLReader::ToDouble(const char *s) const
+{
+  const char *p = s;
+  if (decimal_point != '.') {
+    number = s;
+    size_t dp = number.find('.');
+    if (dp != std::string::npos) number[dp] = decimal_point;
+    p = number.c_str();
+  }
+
+  char *end;
+  double v = strtod(p, &end);
+  while (isspace((unsigned char)*end)) end++;
+  if (end == p || *end) {
+    MyWarning::error("Could not convert \"%s\" to double in XMLRead.", s);
+  }
+  return v;
+}
+
+/* finis */
@@ -0,0 +1,103 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _LEAFMLREADER_H_
+#define _LEAFMLREADER_H_
+
+#include <string>
+#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+
+/*! \brief Reads a LeafML document in one forward pass, element by
+  element, through libxml2's xmlTextReader.
+
+  Only the element being read is kept in memory, and its attributes
+  are looked up in place, without copying them. Typical use, for an
+  element "parent" the reader is positioned on:
+
+  \code
+  int depth = reader.Depth();
+  while (reader.NextChild(depth)) {
+    if (reader.Is("child")) {
+      const char *v = reader.Attribute("v");
+      ...
+    }
+  }
+  \endcode
+
+  Small subtrees that are easier to handle as a tree (the parameters,
+  the settings) can be copied out with CopySubtree.
+*/
+class LeafMLReader {
+
+ public:
+  LeafMLReader(const char *fname);
+  ~LeafMLReader(void);
+
+  //! The file could not be opened, or is not well-formed XML
+  inline bool Failed(void) const { return failed; }
+
+  //! Move to the next start or end tag; false at the end of the document
+  bool Next(void);
+  //! Move to the next child element of the (open) element at "depth";
+  //! false, positioned at its end tag, when there are no more
+  bool NextChild(int depth);
+  //! Move past the end of the current element without reading its
+  //! children
+  void Skip(void);
+  //! Copy the current element and all it contains, and move past it
+  xmlNode *CopySubtree(void);
+
+  inline bool StartP(void) const { return type == XML_READER_TYPE_ELEMENT; }
+  inline bool EndP(void) const { return type == XML_READER_TYPE_END_ELEMENT; }
+  inline bool EmptyP(void) const { return xmlTextReaderIsEmptyElement(reader) == 1; }
+  inline int Depth(void) const { return xmlTextReaderDepth(reader); }
+  inline const char *Name(void) const { return (const char *)xmlTextReaderConstName(reader); }
+  bool Is(const char *name) const;
+
+  //! The value of attribute "name" of the current element, or 0. Valid
+  //! until the reader moves on, or the next call of Attribute.
+  const char *Attribute(const char *name) const;
+
+  //! Convert a number written in LeafML, which always uses a decimal
+  //! point, whatever the locale; a malformed number is an error.
+  double ToDouble(const char *s) const;
+
+ private:
+  LeafMLReader(const LeafMLReader &);
+  LeafMLReader &operator=(const LeafMLReader &);
+
+  int Read(void);
+
+  xmlTextReaderPtr reader;
+  bool failed;
+  bool pending; // Skip has already read the next node
+  int type;
+  char decimal_point;
+  mutable std::string number, value;
+};
+
+#endif
+
+/* finis */
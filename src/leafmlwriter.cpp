@@ -0,0 +1,163 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "leafmlwriter.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+LeafMLWriter::LeafMLWriter(const char *f) : fname(f), failed(false)
+{
+  // Transparent compression seems not to work on Windows. So write uncompressed XML to ensure compatibility of LeafML files.
+  writer = xmlNewTextWriterFilename(fname, 0);
+  if (!writer) {
+    MyWarning::warning("Could not open %s for writing", fname);
+    failed = true;
+    return;
+  }
+  Start();
+}
+
+LeafMLWriter::LeafMLWriter(xmlBufferPtr buffer) : fname("memory buffer"), failed(false)
+{
+  writer = xmlNewTextWriterMemory(buffer, 0);
+  if (!writer) {
+    MyWarning::warning("Could not write LeafML to memory");
+    failed = true;
+    return;
+  }
+  Start();
+}
+
+void LeafMLWriter::Start(void)
+{
+  xmlTextWriterSetIndent(writer, 1);
+  xmlTextWriterSetIndentString(writer, BAD_CAST "  ");
+
+  // printf uses the decimal point of the C locale, which Qt may have
+  // set from the environment; LeafML always uses '.'
+  decimal_point = localeconv()->decimal_point[0];
+
+  Check(xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL));
+}
+
+LeafMLWriter::~LeafMLWriter(void)
+{
+  if (writer) {
+    EndDocument();
+  }
+}
+
+void LeafMLWriter::Check(int result)
+{
+  if (result < 0) {
+    MyWarning::warning("Error writing %s", fname);
+    xmlFreeTextWriter(writer);
+    writer = 0;
+    failed = true;
+  }
+}
+
+void LeafMLWriter::StartElement(const char *name)
+{
+  if (!writer) return;
+  Check(xmlTextWriterStartElement(writer, BAD_CAST name));
+}
+
+void LeafMLWriter::EndElement(void)
+{
+  if (!writer) return;
+  Check(xmlTextWriterEndElement(writer));
+}
+
+void LeafMLWriter::Attribute(const char *name, const char *value)
+{
+  if (!writer) return;
+  Check(xmlTextWriterWriteAttribute(writer, BAD_CAST name, BAD_CAST value));
+}
+
+void LeafMLWriter::Attribute(const char *name, int value)
+{
+  Attribute(name, (long)value);
+}
+
+void LeafMLWriter::Attribute(const char *name, long value)
+{
+  // format the digits backwards from the end of buf
+  char *p = buf + sizeof(buf);
+  *--p = '\0';
+  unsigned long u = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (value < 0) {
+    *--p = '-';
+  }
+  Attribute(name, p);
+}
+
+void LeafMLWriter::Attribute(const char *name, double value)
+{
+  snprintf(buf, sizeof(buf), "%g", value);
+  if (decimal_point != '.') {
+    char *dp = strchr(buf, decimal_point);
+    if (dp) *dp = '.';
+  }
+  Attribute(name, buf);
+}
+
+void LeafMLWriter::Subtree(const xmlNode *node)
+{
+  if (!writer) return;
+
+  if (node->type == XML_ELEMENT_NODE) {
+    StartElement((const char *)node->name);
+    for (const xmlAttr *a = node->properties; a; a = a->next) {
+      xmlChar *value = xmlNodeGetContent((xmlNode *)a);
+      Attribute((const char *)a->name, value ? (const char *)value : "");
+      xmlFree(value);
+    }
+    for (const xmlNode *child = node->children; child; child = child->next) {
+      Subtree(child);
+    }
+    EndElement();
+  }
+  else if (node->type == XML_TEXT_NODE) {
+    Check(xmlTextWriterWriteString(writer, node->content));
+  }
+}
+
+void LeafMLWriter::EndDocument(void)
+{
+  if (!writer) return;
+  Check(xmlTextWriterEndDocument(writer));
+  if (writer) {
+    xmlFreeTextWriter(writer);
+    writer = 0;
+  }
+}
+
+/* finis */
@@ -0,0 +1,84 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _LEAFMLWRITER_H_
+#define _LEAFMLWRITER_H_
+
+#include <libxml/tree.h>
+#include <libxml/xmlwriter.h>
+
+/*! \brief Writes a LeafML document element by element, straight to a
+  buffered file, through libxml2's xmlTextWriter.
+
+  Unlike building the document tree first and saving that, memory use
+  does not grow with the size of the mesh. The output is byte for byte
+  what xmlSaveFormatFileEnc(..., "UTF-8", 1) writes for the same tree:
+  two-space indentation, empty elements closed with "/>", and numbers
+  formatted as an ostream with default settings would ("%g"), whatever
+  the C locale.
+
+  Write errors are reported once, with MyWarning::warning, after which
+  the writer ignores all further calls.
+*/
+class LeafMLWriter {
+
+ public:
+  LeafMLWriter(const char *fname);
+  //! Write to "buffer" instead, which is complete after EndDocument
+  LeafMLWriter(xmlBufferPtr buffer);
+  ~LeafMLWriter(void);
+
+  inline bool Failed(void) const { return failed; }
+
+  void StartElement(const char *name);
+  void EndElement(void);
+
+  void Attribute(const char *name, const char *value);
+  void Attribute(const char *name, int value);
+  void Attribute(const char *name, long value);
+  void Attribute(const char *name, double value);
+
+  //! Write a document (sub)tree, e.g. the parameters or the settings
+  void Subtree(const xmlNode *node);
+
+  //! Close all open elements and flush the file
+  void EndDocument(void);
+
+ private:
+  LeafMLWriter(const LeafMLWriter &);
+  LeafMLWriter &operator=(const LeafMLWriter &);
+
+  void Start(void);
+  void Check(int result);
+
+  xmlTextWriterPtr writer;
+  const char *fname;
+  bool failed;
+  char decimal_point;
+  char buf[32];
+};
+
+#endif
+
+/* finis */
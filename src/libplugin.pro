@@ -43,11 +43,14 @@ TEMPLATE = lib
 HEADERS = \
  cellbase.h \
  matrix.h \
+ moments.h \
  output.h \
  parameter.h \
  parse.h \
+ pool.h \
  random.h \
  simplugin.h \
+ smallvector.h \
  UniqueMessage.h \
  vector.h \
  wallbase.h \
@@ -56,9 +59,11 @@ HEADERS = \
 SOURCES = \
  cellbase.cpp \
  matrix.cpp \
+ moments.cpp \
  output.cpp \
  parameter.cpp \
  parse.cpp \
+ pool.cpp \
  random.cpp \
  simplugin.cpp \
  UniqueMessage.cpp \
@@ -338,21 +338,14 @@ int MainBase::Save(const char* fname, const char* format, int sizex, int sizey)
 
   if (!QString(format).contains("PDF", Qt::CaseInsensitive)) {
 
-    QImage* image = new QImage(QSize(sizex, sizey), QImage::Format_RGB32);
-    image->fill(QColor(Qt::white).rgb());
-    QPainter* painter = new QPainter(image);
-    canvas.render(painter);
+    QImage image = Render(sizex, sizey);
 #ifdef QDEBUG
     qDebug() << "Native Image Filename: " << QDir::toNativeSeparators(QString(fname)) << endl;
 #endif
-    if (!image->save(QDir::toNativeSeparators(QString(fname)))) { // please do not add "format" here! It is much better to have the system guess the file format from the extension. That prevents loads of cross-platform problems.
+    if (!image.save(QDir::toNativeSeparators(QString(fname)))) { // please do not add "format" here! It is much better to have the system guess the file format from the extension. That prevents loads of cross-platform problems.
       MyWarning::warning("Image '%s' not saved successfully. Is the disk full or the extension not recognized?", fname);
-      delete painter;
-      delete image;
       return 1;
     }
-    delete painter;
-    delete image;
   }
   else {
     QPrinter pdf(QPrinter::HighResolution);
@@ -366,6 +359,86 @@ int MainBase::Save(const char* fname, const char* format, int sizex, int sizey)
   return 0;
 }
 
+/*! Render the canvas into an image of sizex by sizey pixels */
+QImage MainBase::Render(int sizex, int sizey)
+{
+  QImage image(QSize(sizex, sizey), QImage::Format_RGB32);
+  image.fill(QColor(Qt::white).rgb());
+  {
+    QPainter painter(&image);
+    canvas.render(&painter);
+  }
+  return image;
+}
+
+/*! Render the canvas now, and leave encoding and writing the image to
+  the snapshot writer, so that the simulation can continue meanwhile.
+*/
+void MainBase::SaveInBackground(const char *fname, int sizex, int sizey)
+{
+  if (QString(fname).isEmpty()) {
+    MyWarning::warning("No output filename given. Saving nothing.\n");
+    return;
+  }
+  snapshots.WriteImage(fname, Render(sizex, sizey));
+}
+
+/*! Capture the mesh in LeafML now, in memory, and leave writing it to
+  the snapshot writer.
+*/
+void MainBase::XMLSaveInBackground(const char *fname)
+{
+  xmlBufferPtr buffer = xmlBufferCreate();
+  mesh.XMLSave(buffer, fname, XMLSettingsTree());
+  snapshots.WriteData(fname, QByteArray((const char *)xmlBufferContent(buffer), xmlBufferLength(buffer)));
+  xmlBufferFree(buffer);
+}
+
+/*! Append the mesh to par.datadir/trajectory.vlt, which is opened
+  the first time. An existing trajectory is overwritten, unless the
+  run was restarted from a checkpoint (see RestartTrajectory); then
+  it is continued from the time of the checkpoint.
+*/
+void MainBase::AppendTrajectoryFrame(void)
+{
+  // Plot is called more than once for the same time step
+  if (mesh.getTime() == trajectory_time) return;
+
+  if (trajectory_time < 0 && !trajectory.IsOpen()) {
+    QString fname = QString("%1/trajectory.vlt").arg(par.datadir);
+    if (!trajectory.Open(fname.toStdString().c_str(), trajectory_continue)) return;
+    if (trajectory_continue) {
+      trajectory.Truncate(mesh.getTime());
+    }
+  }
+  trajectory_time = mesh.getTime();
+
+  TrajectoryFrame frame;
+  mesh.GetTrajectoryFrame(frame);
+  trajectory.Append(frame);
+}
+
+/*! Close the trajectory of the previous run, if any; the next frame
+  starts a new one, or, if the mesh was read from a checkpoint,
+  continues the trajectory of the run that wrote the checkpoint.
+*/
+void MainBase::RestartTrajectory(bool from_checkpoint)
+{
+  trajectory.Close();
+  trajectory_time = -1.;
+  trajectory_continue = from_checkpoint;
+}
+
+/*! Write a checkpoint of the simulation, from which it can be
+  continued exactly (see Mesh::CheckpointSave). Checkpoints are
+  written directly: they are binary copies of the mesh, so capturing
+  them in memory first would take as long as writing them.
+*/
+void MainBase::SaveCheckpoint(const char *fname)
+{
+  mesh.CheckpointSave(fname, XMLSettingsTree());
+}
+
 void MainBase::CutSAM()
 {
   mesh.CutAwaySAM();
@@ -35,6 +35,8 @@
 #include <QPrinter>
 #include "mesh.h"
 #include "warning.h"
+#include "snapshotwriter.h"
+#include "trajectory.h"
 
 using namespace std;
 
@@ -42,7 +44,7 @@ using namespace std;
 class MainBase  {
 
  public:
- MainBase(QGraphicsScene &c, Mesh &m) : mesh(m), canvas(c) {
+ MainBase(QGraphicsScene &c, Mesh &m) : mesh(m), canvas(c), trajectory_time(-1.), trajectory_continue(false), checkpoint_time(-1.) {
 
     // Standard options for batch version
     showcentersp =  false;
@@ -97,6 +99,20 @@ class MainBase  {
   virtual double getFluxArrowsize(void) { return 10.;}
 
   int Save(const char *fname, const char *format, int sizex=640, int sizey=480);
+  //! As Save, for bitmaps, but the image is written in the background
+  void SaveInBackground(const char *fname, int sizex=640, int sizey=480);
+  //! As Mesh::XMLSave, but the file is written in the background
+  void XMLSaveInBackground(const char *fname);
+  //! Wait until all snapshots saved in the background have been written
+  void FlushSnapshots(void) { snapshots.Flush(); }
+  //! Append the mesh to the trajectory in the data directory
+  void AppendTrajectoryFrame(void);
+  //! Start a new run, which continues the trajectory if it is restarted from a checkpoint
+  void RestartTrajectory(bool from_checkpoint);
+  //! Write the index of the trajectory, and close it
+  void CloseTrajectory(void) { trajectory.Close(); }
+  //! As Mesh::CheckpointSave, with the current settings
+  void SaveCheckpoint(const char *fname);
   void CutSAM(void);
 
   void Plot(int resize_stride=10);
@@ -111,6 +127,12 @@ class MainBase  {
 
  protected:
   QGraphicsScene &canvas;
+  SnapshotWriter snapshots;
+  TrajectoryWriter trajectory;
+  double trajectory_time; // of the last frame appended to the trajectory
+  bool trajectory_continue; // append to the existing trajectory
+  double checkpoint_time; // of the last checkpoint written by Plot
+  QImage Render(int sizex, int sizey);
   virtual xmlNode *XMLSettingsTree(void);
   virtual xmlNode *XMLViewportTree(QTransform &transform) const;
 
@@ -26,6 +26,7 @@
 #include <cstdlib>
  //#include <cerrno>
 #include <cstring>
+#include <cfloat>
 #include <numeric>
 #include <functional>
 #include <fstream>
@@ -42,6 +43,8 @@
 #include "nodeitem.h"
 #include "simplugin.h"
 #include "cell.h"
+#include "moments.h"
+#include "nodestore.h"
 
 #include <QDebug>
 #include <set>
@@ -459,6 +462,7 @@ void Mesh::Clear(void) {
 
   node_sets.clear();
   time = 0;
+  stiff_step = 0.;
 
   // clear cells
 
@@ -475,13 +479,28 @@ void Mesh::Clear(void) {
   }
 
   // Clear walls
-  for (list<Wall*>::iterator i = walls.begin(); i != walls.end(); i++) {
+  for (SlotMap<Wall>::iterator i = walls.begin(); i != walls.end(); i++) {
     delete* i;
   }
 
   walls.clear();
   WallBase::nwalls = 0;
   //tmp_walls->clear();
+  state.clear();
+  ode_walls.clear();
+  ode_wall_cells.clear();
+  wall_colors.clear();
+  InvalidateEdgeGrid();
+
+  // All nodes, cells and walls are gone now: hand the memory of the
+  // object pools back in bulk. Pools with blocks that are still in use
+  // are kept, so that whatever still points into them stays valid.
+  size_t in_use = object_pools.BlocksInUse() + wall_payload_pools.BlocksInUse();
+  object_pools.Release();
+  wall_payload_pools.Release();
+  if (in_use) {
+    MyWarning::unique_warning("Mesh::Clear: %d pooled objects or arrays were not deleted with the mesh", (int)in_use);
+  }
 
   shuffled_cells.clear();
   shuffled_nodes.clear();
@@ -493,423 +512,875 @@ void Mesh::Clear(void) {
 #endif
 }
 
+/*! Select the energy terms of the node displacement once per sweep,
+  instead of for every proposal.
+
+  For ":Anisotropic2:" models the strength of each wall whose end points
+  are joined by a single edge is looked up per proposal; collect these
+  here, keyed on the cell and the (ordered) node indices of the edge.
+  The cells' node rings for the self-intersection test are rebuilt here
+  as well. If moves that make walls cross are to be rejected, the grid
+  of wall segments is built here too; the sweeps keep it up to date, so
+  it is only rebuilt after the segments have changed otherwise (see
+  InvalidateEdgeGrid).
+*/
+void Mesh::SetDisplacementEnergy(void) {
+
+  mc_anisotropic2 = strstr(par.model_choice, ":Anisotropic2:") != 0;
+  mc_bending = par.bend_lambda != 0.;
+  mc_check_intersections = par.mc_check_intersections;
+
+  for (vector<Cell*>::iterator c = cells.begin(); c != cells.end(); c++) {
+    (*c)->BuildNodeRing();
+  }
+  if (boundary_polygon) boundary_polygon->BuildNodeRing();
+
+  if (mc_check_intersections) {
+    if (edge_grid.EmptyP()) {
+      BuildEdgeGrid();
+    }
+  }
+  else if (!edge_grid.EmptyP()) {
+    // the parallel sweep does not maintain the grid
+    InvalidateEdgeGrid();
+  }
+
+  edge_wall_strength.clear();
+  if (!mc_anisotropic2) return;
+
+  vector<Cell*> owners(cells);
+  if (boundary_polygon) owners.push_back(boundary_polygon);
+
+  for (vector<Cell*>::const_iterator c = owners.begin(); c != owners.end(); c++) {
+    for (CellWalls::const_iterator w = (*c)->walls.begin(); w != (*c)->walls.end(); w++) {
+      int n1 = (*w)->N1()->Index(), n2 = (*w)->N2()->Index();
+      EdgeKey key(*c, QPair<int, int>(min(n1, n2), max(n1, n2)));
+      QHash<EdgeKey, double>::iterator strength = edge_wall_strength.find(key);
+      if (strength == edge_wall_strength.end()) {
+        edge_wall_strength.insert(key, (*w)->GetWallStrength());
+      }
+      else {
+        strength.value() *= (*w)->GetWallStrength();
+      }
+    }
+  }
+}
+
+/*! Collect the unique edges of the cells and the boundary polygon in
+  edge_grid. Most edges are shared by two rings; an edge is kept the
+  first time it is met, which is recorded at its lower node. A node has
+  only a few edges, so this takes linear time.
+*/
+void Mesh::BuildEdgeGrid(void) {
+
+  vector<Cell*> owners(cells);
+  if (boundary_polygon) owners.push_back(boundary_polygon);
+
+  // per node index, the higher node indices it has an edge with
+  vector< vector<int> > seen(nodes.size());
+  vector<Edge> edges;
+
+  for (vector<Cell*>::const_iterator c = owners.begin(); c != owners.end(); c++) {
+    const vector<Node*> &ring = (*c)->node_ring;
+    for (int k = 0; k < (int)ring.size(); k++) {
+      Node *n1 = ring[k], *n2 = ring[k + 1 < (int)ring.size() ? k + 1 : 0];
+      int lo = min(n1->Index(), n2->Index()), hi = max(n1->Index(), n2->Index());
+      vector<int> &higher = seen[lo];
+      if (find(higher.begin(), higher.end(), hi) == higher.end()) {
+        higher.push_back(hi);
+        edges.push_back(Edge(n1, n2));
+      }
+    }
+  }
+
+  edge_grid.Build(edges, nodes.size());
+}
+
+//! Product of the strengths of the walls of "c" that consist of the single edge (n1, n2); 1 if there are none.
+inline double Mesh::EdgeWallStrength(CellBase* c, Node* n1, Node* n2) const {
+
+  int i1 = n1->Index(), i2 = n2->Index();
+  return edge_wall_strength.value(EdgeKey(c, QPair<int, int>(min(i1, i2), max(i1, i2))), 1.);
+}
+
 double Mesh::DisplaceNodes(void) {
 
-  MyUrand r(shuffled_nodes.size());
-  random_shuffle(shuffled_nodes.begin(), shuffled_nodes.end(), r);
+  // the edge grid is updated after each accepted move, so checking
+  // intersections with it requires the serial sweep
+  if (par.mc_threads > 0 && !par.mc_check_intersections) {
+    return DisplaceNodesParallel(par.mc_threads);
+  }
+
+  SetDisplacementEnergy();
 
   double sum_dh = 0;
 
-  list<DeltaIntgrl> delta_intgrl_list;
+  vector<Edge> insertions;
+  vector<DeltaIntgrl> delta_intgrl_list;
 
   for_each(node_sets.begin(), node_sets.end(), mem_fun(&NodeSet::ResetDone));
 
-  for (vector<Node*>::const_iterator i = shuffled_nodes.begin(); i != shuffled_nodes.end(); i++) {
+  if (SelectedRandomGenerator() == PhiloxGenerator) {
+    // the shuffle and up to three numbers per move, drawn in one batch
+    PhiloxBuffer rng(GlobalPhiloxStream(), 4 * shuffled_nodes.size());
+    random_shuffle(shuffled_nodes.begin(), shuffled_nodes.end(), rng);
+    for (vector<Node*>::const_iterator i = shuffled_nodes.begin(); i != shuffled_nodes.end(); i++) {
+      DisplaceNode(**i, rng, insertions, delta_intgrl_list, sum_dh);
+    }
+  } else {
+    MyUrand r(shuffled_nodes.size());
+    random_shuffle(shuffled_nodes.begin(), shuffled_nodes.end(), r);
 
-    //int n=shuffled_nodes[*i];
-    Node& node(**i);
+    GlobalRandom rng;
+    for (vector<Node*>::const_iterator i = shuffled_nodes.begin(); i != shuffled_nodes.end(); i++) {
+      DisplaceNode(**i, rng, insertions, delta_intgrl_list, sum_dh);
+    }
+  }
 
-    // Do not allow displacement if fixed
-    //if (node.fixed) continue;
+  for (vector<Edge>::iterator e = insertions.begin(); e != insertions.end(); e++) {
+    node_insertion_queue.push(*e);
+  }
 
-    if (node.DeadP()) continue;
+  return sum_dh;
+}
+
+// The nodes with their current positions, for EdgeGrid::MoveNodes
+static void SavePositions(const list<Node*>& nodes, vector< pair<const Node *, Vector> >& positions) {
+
+  positions.clear();
+  for (list<Node*>::const_iterator n = nodes.begin(); n != nodes.end(); n++) {
+    positions.push_back(pair<const Node *, Vector>(*n, **n));
+  }
+}
+
+/*! Attempt a single Monte Carlo displacement of "node", with the
+  energy terms selected by SetDisplacementEnergy.
 
-    // Attempt to move this cell in a random direction
+  Random numbers are drawn from "rng", so that the serial sweep can use
+  the global generator and the parallel sweep a stream per thread. Edges
+  that exceed the yielding threshold are appended to "insertions"
+  rather than pushed onto node_insertion_queue directly, and the energy
+  change of accepted moves is added to "sum_dh".
+*/
+template<class RNG> void Mesh::DisplaceNode(Node& node, RNG& rng, vector<Edge>& insertions, vector<DeltaIntgrl>& delta_intgrl_list, double& sum_dh) {
+
+  if (mc_anisotropic2) {
+    if (mc_bending)
+      DisplaceNode<true, true>(node, rng, insertions, delta_intgrl_list, sum_dh);
+    else
+      DisplaceNode<true, false>(node, rng, insertions, delta_intgrl_list, sum_dh);
+  }
+  else {
+    if (mc_bending)
+      DisplaceNode<false, true>(node, rng, insertions, delta_intgrl_list, sum_dh);
+    else
+      DisplaceNode<false, false>(node, rng, insertions, delta_intgrl_list, sum_dh);
+  }
+}
+
+template<bool Anisotropic2, bool Bending, class RNG> void Mesh::DisplaceNode(Node& node, RNG& rng, vector<Edge>& insertions, vector<DeltaIntgrl>& delta_intgrl_list, double& sum_dh) {
+
+  delta_intgrl_list.clear();
+
+  // Do not allow displacement if fixed
+  //if (node.fixed) continue;
+
+  if (node.DeadP()) return;
+
+  // Attempt to move this cell in a random direction
 //    double rx=par.mc_stepsize*(RANDOM()-0.5); // was 100.
 //    double ry=par.mc_stepsize*(RANDOM()-0.5);
-    double rx = par.mc_stepsize * (RANDOM() - 0.5) * 0.000001; //WORTEL
-    double ry = par.mc_stepsize * (RANDOM() - 0.5) * 1.;	   //WORTEL
-
-    // Uniform with a circle of radius par.mc_stepsize
-    /* double r = RANDOM() * par.mc_stepsize;
-       double th = RANDOM()*2*Pi;
+  double rx = par.mc_stepsize * (rng.Uniform() - 0.5) * 0.000001; //WORTEL
+  double ry = par.mc_stepsize * (rng.Uniform() - 0.5) * 1.;	   //WORTEL
 
-       double rx = r * cos(th);
-       double ry = r * sin(th);
-    */
-    Vector new_p(node.x + rx, node.y + ry, 0);
-    Vector old_p(node.x, node.y, 0);
+  // Uniform with a circle of radius par.mc_stepsize
+  /* double r = RANDOM() * par.mc_stepsize;
+     double th = RANDOM()*2*Pi;
 
-    /* if (node.boundary  && boundary_polygon->MoveSelfIntersectsP(n,  new_p )) {
-    // reject if move of boundary results in self intersection
-    continue;
-    }*/
+     double rx = r * cos(th);
+     double ry = r * sin(th);
+  */
+  Vector new_p(node.x + rx, node.y + ry, 0);
+  Vector old_p(node.x, node.y, 0);
 
+  if (mc_check_intersections && !node.node_set && edge_grid.MoveIntersectsP(&node, new_p)) {
+    // reject if the move makes a wall cross another wall or the boundary
+    return;
+  }
 
-    if (node.node_set) {
-      // move each node set only once
-      if (!node.node_set->DoneP())
-        node.node_set->AttemptMove(rx, ry);
 
+  if (node.node_set) {
+    // move each node set only once
+    if (!node.node_set->DoneP()) {
+      vector< pair<const Node *, Vector> > old_positions;
+      if (mc_check_intersections) SavePositions(*node.node_set, old_positions);
+      node.node_set->AttemptMove(rx, ry, rng);
+      if (mc_check_intersections) edge_grid.MoveNodes(old_positions);
     }
-    else {
 
-      // for all cells to which this node belongs:
-      //   calculate energy difference
+  }
+  else {
 
-      double area_dh = 0.;
-      double length_dh = 0.;
-      double bending_dh = 0.;
-      double cell_length_dh = 0.;
-      double alignment_dh = 0.;
+    // for all cells to which this node belongs:
+    //   calculate energy difference
 
-      double old_l1 = 0., old_l2 = 0., new_l1 = 0., new_l2 = 0.;
+    double area_dh = 0.;
+    double length_dh = 0.;
+    double bending_dh = 0.;
+    double cell_length_dh = 0.;
+    double alignment_dh = 0.;
 
-      double sum_stiff = 0.;
-      double dh = 0.;
+    double old_l1 = 0., old_l2 = 0., new_l1 = 0., new_l2 = 0.;
 
-      for (list<Neighbor>::const_iterator cit = node.owners.begin(); cit != node.owners.end(); cit++) {
+    double sum_stiff = 0.;
+    double dh = 0.;
 
+    for (NodeOwners::const_iterator cit = node.owners.begin(); cit != node.owners.end(); cit++) {
 
-        Cell& c = *((Cell*)(cit->cell));
 
-        if (c.MoveSelfIntersectsP(&node, new_p)) {
+      Cell& c = *((Cell*)(cit->cell));
 
-          // reject if move results in self intersection
-          //
-          // I know: using goto's is bad practice... except when jumping out
-          // of deeply nested loops :-)
-          //cerr << "Rejecting due to self-intersection\n";
-          goto next_node;
-        }
+      if (c.MoveSelfIntersectsP(*cit, &node, new_p)) {
 
-        // summing stiffnesses of cells. Move has to overcome this minimum required energy.
-        sum_stiff += c.stiffness;
-        // area - (area after displacement): see notes for derivation
+        // reject if move results in self intersection
+        //cerr << "Rejecting due to self-intersection\n";
+        return;
+      }
+
+      // summing stiffnesses of cells. Move has to overcome this minimum required energy.
+      sum_stiff += c.stiffness;
+      // area - (area after displacement): see notes for derivation
 
-        Vector i_min_1 = *(cit->nb1);
-        //Vector i_plus_1 = m->getNode(cit->nb2);
-        Vector i_plus_1 = *(cit->nb2);
+      Vector i_min_1 = *(cit->nb1);
+      //Vector i_plus_1 = m->getNode(cit->nb2);
+      Vector i_plus_1 = *(cit->nb2);
 
 
-        // We must double the weights for the perimeter (otherwise they start bulging...)
-        double w1, w2;
-        if (node.boundary && cit->nb1->boundary)
+      // We must double the weights for the perimeter (otherwise they start bulging...)
+      double w1, w2;
+      if (node.boundary && cit->nb1->boundary)
 #ifdef FLEMING
-          w1 = par.rel_perimeter_stiffness;
+        w1 = par.rel_perimeter_stiffness;
 #else
-          w1 = 2;
+        w1 = 2;
 #endif
-        else
-          w1 = 1;
+      else
+        w1 = 1;
 
-        if (node.boundary && cit->nb2->boundary)
+      if (node.boundary && cit->nb2->boundary)
 #ifdef FLEMING
-          w2 = par.rel_perimeter_stiffness;
+        w2 = par.rel_perimeter_stiffness;
 #else
-          w2 = 2;
+        w2 = 2;
 #endif
-        else
-          w2 = 1;
+      else
+        w2 = 1;
+
+      if (Anisotropic2) //second, improved, version of anisotropic growth
+      {
+        w1 *= EdgeWallStrength(cit->cell, cit->nb1, &node);
+        w2 *= EdgeWallStrength(cit->cell, cit->nb2, &node);
+      }
 
-        //WORTEL
-        string const model_choice = par.model_choice;
-        bool const anisotropic2 = (string(par.model_choice).find(":Anisotropic2:") != string::npos);
+      //if (cit->cell>=0) {
+      if (!cit->cell->BoundaryPolP()) {
+        double delta_A = 0.5 * ((new_p.x - old_p.x) * (i_min_1.y - i_plus_1.y) +
+          (new_p.y - old_p.y) * (i_plus_1.x - i_min_1.x));
 
-        if (anisotropic2) //second, improved, version of anisotropic growth
+        if (Anisotropic2) //second, improved, version of anisotropic growth
         {
-          QList<WallBase*> walls = cit->cell->getWalls();
-          for (QList<WallBase*>::const_iterator it = walls.begin(); it != walls.end(); it++)
-          {
-            if ((((*it)->N1()->Index() == cit->nb1->Index()) && ((*it)->N2()->Index() == node.Index())) ||
-              (((*it)->N2()->Index() == cit->nb1->Index()) && ((*it)->N1()->Index() == node.Index())))
-            {
-              w1 *= (*it)->GetWallStrength();
-            }
-            else if ((((*it)->N1()->Index() == cit->nb2->Index()) && ((*it)->N2()->Index() == node.Index())) ||
-              (((*it)->N2()->Index() == cit->nb2->Index()) && ((*it)->N1()->Index() == node.Index())))
-            {
-              w2 *= (*it)->GetWallStrength();
-            }
-          }
+          area_dh += -1000 * (DSQR(c.target_area / c.area - 1) - DSQR(c.target_area / (c.area - delta_A) - 1)); //WORTEL
+        }
+        else
+        {
+          area_dh += delta_A * (2 * c.target_area - 2 * c.area + delta_A);
         }
 
-        //if (cit->cell>=0) {
-        if (!cit->cell->BoundaryPolP()) {
-          double delta_A = 0.5 * ((new_p.x - old_p.x) * (i_min_1.y - i_plus_1.y) +
-            (new_p.y - old_p.y) * (i_plus_1.x - i_min_1.x));
 
-          if (anisotropic2) //second, improved, version of anisotropic growth
-          {
-            area_dh += -1000 * (DSQR(c.target_area / c.area - 1) - DSQR(c.target_area / (c.area - delta_A) - 1)); //WORTEL
-          }
-          else
-          {
-            area_dh += delta_A * (2 * c.target_area - 2 * c.area + delta_A);
-          }
+        // cell length constraint
+        // expensive and not always needed
+        // so we check the value of lambda_celllength
+
+        if (/* par.lambda_celllength */  cit->cell->lambda_celllength) {
+
+          double delta_ix =
+            (i_min_1.x + new_p.x)
+            * (new_p.x * i_min_1.y - i_min_1.x * new_p.y) +
+            (new_p.x + i_plus_1.x)
+            * (i_plus_1.x * new_p.y - new_p.x * i_plus_1.y) -
+
+            (i_min_1.x + old_p.x)
+            * (old_p.x * i_min_1.y - i_min_1.x * old_p.y) -
+            (old_p.x + i_plus_1.x)
+            * (i_plus_1.x * old_p.y - old_p.x * i_plus_1.y);
 
 
-          // cell length constraint
-          // expensive and not always needed
-          // so we check the value of lambda_celllength
-
-          if (/* par.lambda_celllength */  cit->cell->lambda_celllength) {
-
-            double delta_ix =
-              (i_min_1.x + new_p.x)
-              * (new_p.x * i_min_1.y - i_min_1.x * new_p.y) +
-              (new_p.x + i_plus_1.x)
-              * (i_plus_1.x * new_p.y - new_p.x * i_plus_1.y) -
-
-              (i_min_1.x + old_p.x)
-              * (old_p.x * i_min_1.y - i_min_1.x * old_p.y) -
-              (old_p.x + i_plus_1.x)
-              * (i_plus_1.x * old_p.y - old_p.x * i_plus_1.y);
+          double delta_iy =
+            (i_min_1.y + new_p.y)
+            * (new_p.x * i_min_1.y - i_min_1.x * new_p.y) +
+            (new_p.y + i_plus_1.y)
+            * (i_plus_1.x * new_p.y - new_p.x * i_plus_1.y) -
 
+            (i_min_1.y + old_p.y)
+            * (old_p.x * i_min_1.y - i_min_1.x * old_p.y) -
+            (old_p.y + i_plus_1.y)
+            * (i_plus_1.x * old_p.y - old_p.x * i_plus_1.y);
 
-            double delta_iy =
-              (i_min_1.y + new_p.y)
-              * (new_p.x * i_min_1.y - i_min_1.x * new_p.y) +
-              (new_p.y + i_plus_1.y)
-              * (i_plus_1.x * new_p.y - new_p.x * i_plus_1.y) -
 
-              (i_min_1.y + old_p.y)
-              * (old_p.x * i_min_1.y - i_min_1.x * old_p.y) -
-              (old_p.y + i_plus_1.y)
-              * (i_plus_1.x * old_p.y - old_p.x * i_plus_1.y);
+          double delta_ixx =
+            (new_p.x * new_p.x +
+              i_min_1.x * new_p.x +
+              i_min_1.x * i_min_1.x) *
+              (new_p.x * i_min_1.y - i_min_1.x * new_p.y) +
 
+            (i_plus_1.x * i_plus_1.x +
+              new_p.x * i_plus_1.x +
+              new_p.x * new_p.x) *
+              (i_plus_1.x * new_p.y - new_p.x * i_plus_1.y) -
 
-            double delta_ixx =
-              (new_p.x * new_p.x +
-                i_min_1.x * new_p.x +
-                i_min_1.x * i_min_1.x) *
-                (new_p.x * i_min_1.y - i_min_1.x * new_p.y) +
+            (old_p.x * old_p.x +
+              i_min_1.x * old_p.x +
+              i_min_1.x * i_min_1.x) *
+              (old_p.x * i_min_1.y - i_min_1.x * old_p.y) -
 
-              (i_plus_1.x * i_plus_1.x +
-                new_p.x * i_plus_1.x +
-                new_p.x * new_p.x) *
-                (i_plus_1.x * new_p.y - new_p.x * i_plus_1.y) -
+            (i_plus_1.x * i_plus_1.x +
+              old_p.x * i_plus_1.x +
+              old_p.x * old_p.x) *
+              (i_plus_1.x * old_p.y - old_p.x * i_plus_1.y);
 
-              (old_p.x * old_p.x +
-                i_min_1.x * old_p.x +
-                i_min_1.x * i_min_1.x) *
-                (old_p.x * i_min_1.y - i_min_1.x * old_p.y) -
 
-              (i_plus_1.x * i_plus_1.x +
-                old_p.x * i_plus_1.x +
-                old_p.x * old_p.x) *
-                (i_plus_1.x * old_p.y - old_p.x * i_plus_1.y);
+          double delta_ixy =
+            (i_min_1.x * new_p.y -
+              new_p.x * i_min_1.y) *
+              (new_p.x * (2 * new_p.y + i_min_1.y) +
+                i_min_1.x * (new_p.y + 2 * i_min_1.y)) +
 
+                (new_p.x * i_plus_1.y -
+                  i_plus_1.x * new_p.y) *
+                  (i_plus_1.x * (2 * i_plus_1.y + new_p.y) +
+                    new_p.x * (i_plus_1.y + 2 * new_p.y)) -
 
-            double delta_ixy =
-              (i_min_1.x * new_p.y -
-                new_p.x * i_min_1.y) *
-                (new_p.x * (2 * new_p.y + i_min_1.y) +
-                  i_min_1.x * (new_p.y + 2 * i_min_1.y)) +
+                    (i_min_1.x * old_p.y -
+                      old_p.x * i_min_1.y) *
+                      (old_p.x * (2 * old_p.y + i_min_1.y) +
+                        i_min_1.x * (old_p.y + 2 * i_min_1.y)) -
 
-                  (new_p.x * i_plus_1.y -
-                    i_plus_1.x * new_p.y) *
-                    (i_plus_1.x * (2 * i_plus_1.y + new_p.y) +
-                      new_p.x * (i_plus_1.y + 2 * new_p.y)) -
+                        (old_p.x * i_plus_1.y -
+                          i_plus_1.x * old_p.y) *
+                          (i_plus_1.x * (2 * i_plus_1.y + old_p.y) +
+                            old_p.x * (i_plus_1.y + 2 * old_p.y));
 
-                      (i_min_1.x * old_p.y -
-                        old_p.x * i_min_1.y) *
-                        (old_p.x * (2 * old_p.y + i_min_1.y) +
-                          i_min_1.x * (old_p.y + 2 * i_min_1.y)) -
 
-                          (old_p.x * i_plus_1.y -
-                            i_plus_1.x * old_p.y) *
-                            (i_plus_1.x * (2 * i_plus_1.y + old_p.y) +
-                              old_p.x * (i_plus_1.y + 2 * old_p.y));
+          double delta_iyy =
+            (new_p.x * i_min_1.y -
+              i_min_1.x * new_p.y) *
+              (new_p.y * new_p.y +
+                i_min_1.y * new_p.y +
+                i_min_1.y * i_min_1.y) +
 
+                (i_plus_1.x * new_p.y -
+                  new_p.x * i_plus_1.y) *
+                  (i_plus_1.y * i_plus_1.y +
+                    new_p.y * i_plus_1.y +
+                    new_p.y * new_p.y) -
 
-            double delta_iyy =
-              (new_p.x * i_min_1.y -
-                i_min_1.x * new_p.y) *
-                (new_p.y * new_p.y +
-                  i_min_1.y * new_p.y +
-                  i_min_1.y * i_min_1.y) +
+                    (old_p.x * i_min_1.y -
+                      i_min_1.x * old_p.y) *
+                      (old_p.y * old_p.y +
+                        i_min_1.y * old_p.y +
+                        i_min_1.y * i_min_1.y) -
 
-                  (i_plus_1.x * new_p.y -
-                    new_p.x * i_plus_1.y) *
-                    (i_plus_1.y * i_plus_1.y +
-                      new_p.y * i_plus_1.y +
-                      new_p.y * new_p.y) -
+                        (i_plus_1.x * old_p.y -
+                          old_p.x * i_plus_1.y) *
+                          (i_plus_1.y * i_plus_1.y +
+                            old_p.y * i_plus_1.y +
+                            old_p.y * old_p.y);
 
-                      (old_p.x * i_min_1.y -
-                        i_min_1.x * old_p.y) *
-                        (old_p.y * old_p.y +
-                          i_min_1.y * old_p.y +
-                          i_min_1.y * i_min_1.y) -
+          delta_intgrl_list.push_back(DeltaIntgrl(delta_A, delta_ix, delta_iy, delta_ixx, delta_ixy, delta_iyy));
 
-                          (i_plus_1.x * old_p.y -
-                            old_p.x * i_plus_1.y) *
-                            (i_plus_1.y * i_plus_1.y +
-                              old_p.y * i_plus_1.y +
-                              old_p.y * old_p.y);
+          Vector old_axis;
+          double old_celllength = c.Length(&old_axis);
+          old_axis = old_axis.Normalised().Perp2D();
 
-            delta_intgrl_list.push_back(DeltaIntgrl(delta_A, delta_ix, delta_iy, delta_ixx, delta_ixy, delta_iyy));
+          // calculate length after proposed update
+          double intrx = (c.intgrl_x - delta_ix) / 6.;
+          double intry = (c.intgrl_y - delta_iy) / 6.;
+          double ixx = ((c.intgrl_xx - delta_ixx) / 12.) - (intrx * intrx) / (c.area - delta_A);
+          double ixy = ((c.intgrl_xy - delta_ixy) / 24.) + (intrx * intry) / (c.area - delta_A);
+          double iyy = ((c.intgrl_yy - delta_iyy) / 12.) - (intry * intry) / (c.area - delta_A);
 
-            Vector old_axis;
-            double old_celllength = c.Length(&old_axis);
-            old_axis = old_axis.Normalised().Perp2D();
+          double rhs1 = (ixx + iyy) / 2., rhs2 = sqrt((ixx - iyy) * (ixx - iyy) + 4 * ixy * ixy) / 2.;
 
-            // calculate length after proposed update
-            double intrx = (c.intgrl_x - delta_ix) / 6.;
-            double intry = (c.intgrl_y - delta_iy) / 6.;
-            double ixx = ((c.intgrl_xx - delta_ixx) / 12.) - (intrx * intrx) / (c.area - delta_A);
-            double ixy = ((c.intgrl_xy - delta_ixy) / 24.) + (intrx * intry) / (c.area - delta_A);
-            double iyy = ((c.intgrl_yy - delta_iyy) / 12.) - (intry * intry) / (c.area - delta_A);
+          double lambda_b = rhs1 + rhs2;
 
-            double rhs1 = (ixx + iyy) / 2., rhs2 = sqrt((ixx - iyy) * (ixx - iyy) + 4 * ixy * ixy) / 2.;
 
-            double lambda_b = rhs1 + rhs2;
+          double new_celllength = 4 * sqrt(lambda_b / (c.area - delta_A));
+          //cerr << "new_celllength = "  << new_celllength << endl;
+          //cerr << "target_length = "  << c.target_length << endl;
 
+          cell_length_dh += c.lambda_celllength * (DSQR(c.target_length - new_celllength) - DSQR(c.target_length - old_celllength));
 
-            double new_celllength = 4 * sqrt(lambda_b / (c.area - delta_A));
-            //cerr << "new_celllength = "  << new_celllength << endl;
-            //cerr << "target_length = "  << c.target_length << endl;
+          Vector norm_long_axis(lambda_b - ixx, ixy, 0);
+          norm_long_axis.Normalise();
 
-            cell_length_dh += c.lambda_celllength * (DSQR(c.target_length - new_celllength) - DSQR(c.target_length - old_celllength));
+          double alignment_before = InnerProduct(old_axis, c.cellvec);
+          double alignment_after = InnerProduct(norm_long_axis, c.cellvec);
 
-            Vector norm_long_axis(lambda_b - ixx, ixy, 0);
-            norm_long_axis.Normalise();
+          /* cerr << "Delta alignment = " << alignment_before - alignment_after << endl;
+             cerr << "Old alignment is " << alignment_before << ", new alignment is " << alignment_after << endl;
+             cerr << "Old axis is " << old_axis << ", new axis is " << norm_long_axis << endl;
+          */
+          alignment_dh += alignment_before - alignment_after;
 
-            double alignment_before = InnerProduct(old_axis, c.cellvec);
-            double alignment_after = InnerProduct(norm_long_axis, c.cellvec);
+          /* cerr << "alignment_dh  = " << alignment_dh << endl;
+             cerr << "cellvec = " << c.cellvec << endl;*/
 
-            /* cerr << "Delta alignment = " << alignment_before - alignment_after << endl;
-               cerr << "Old alignment is " << alignment_before << ", new alignment is " << alignment_after << endl;
-               cerr << "Old axis is " << old_axis << ", new axis is " << norm_long_axis << endl;
-            */
-            alignment_dh += alignment_before - alignment_after;
+        }
+        else {
+          // if we have no length constraint, still need to update area
+          delta_intgrl_list.push_back(DeltaIntgrl(delta_A, 0, 0, 0, 0, 0));
 
-            /* cerr << "alignment_dh  = " << alignment_dh << endl;
-               cerr << "cellvec = " << c.cellvec << endl;*/
+        }
 
-          }
-          else {
-            // if we have no length constraint, still need to update area
-            delta_intgrl_list.push_back(DeltaIntgrl(delta_A, 0, 0, 0, 0, 0));
+        old_l1 = (old_p - i_min_1).Norm();
+        old_l2 = (old_p - i_plus_1).Norm();
+        new_l1 = (new_p - i_min_1).Norm();
+        new_l2 = (new_p - i_plus_1).Norm();
 
+
+
+
+        // Insertion of nodes (cell wall yielding)
+        if (!node.fixed) {
+          if (old_l1 > par.yielding_threshold* Node::target_length && !cit->nb1->fixed) {
+            insertions.push_back(Edge(cit->nb1, &node));
+          }
+          if (old_l2 > par.yielding_threshold* Node::target_length && !cit->nb2->fixed) {
+            insertions.push_back(Edge(&node, cit->nb2));
           }
 
-          old_l1 = (old_p - i_min_1).Norm();
-          old_l2 = (old_p - i_plus_1).Norm();
-          new_l1 = (new_p - i_min_1).Norm();
-          new_l2 = (new_p - i_plus_1).Norm();
+        }
 
 
 
+        length_dh += 2 * Node::target_length * (w1 * (old_l1 - new_l1) +
+          w2 * (old_l2 - new_l2)) +
+          w1 * (DSQR(new_l1)
+            - DSQR(old_l1))
+          + w2 * (DSQR(new_l2)
+            - DSQR(old_l2));
 
-          static int count = 0;
-          // Insertion of nodes (cell wall yielding)
-          if (!node.fixed) {
-            if (old_l1 > par.yielding_threshold* Node::target_length && !cit->nb1->fixed) {
-              node_insertion_queue.push(Edge(cit->nb1, &node));
-            }
-            if (old_l2 > par.yielding_threshold* Node::target_length && !cit->nb2->fixed) {
-              node_insertion_queue.push(Edge(&node, cit->nb2));
-            }
-            count++;
 
-          }
 
 
 
-          length_dh += 2 * Node::target_length * (w1 * (old_l1 - new_l1) +
-            w2 * (old_l2 - new_l2)) +
-            w1 * (DSQR(new_l1)
-              - DSQR(old_l1))
-            + w2 * (DSQR(new_l2)
-              - DSQR(old_l2));
+      }
+
+      // bending energy also holds for outer boundary
+      // first implementation. Can probably be done more efficiently
+      // calculate circumcenter radius (gives local curvature)
+      // the ideal bending state is flat... (K=0)
+      if (Bending) {
+        // strong bending energy to resist "cleaving" by division planes
+        double r1, r2, xc, yc;
+        CircumCircle(i_min_1.x, i_min_1.y, old_p.x, old_p.y, i_plus_1.x, i_plus_1.y,
+          &xc, &yc, &r1);
+        CircumCircle(i_min_1.x, i_min_1.y, new_p.x, new_p.y, i_plus_1.x, i_plus_1.y,
+          &xc, &yc, &r2);
+
+        if (r1 < 0 || r2 < 0) {
+          MyWarning::warning("r1 = %f, r2 = %f", r1, r2);
+        }
+        bending_dh += DSQR(1 / r2 - 1 / r1);
+
+      }
+
 
+    }
 
 
 
 
+    dh = area_dh + cell_length_dh +
+      par.lambda_length * length_dh + par.bend_lambda * bending_dh + par.alignment_lambda * alignment_dh;
+
+    //(length_constraint_after - length_constraint_before);
+
+    if (node.fixed) {
+
+      // search the fixed cell to which this node belongs
+      // and displace these cells as a whole
+      // WARNING: undefined things will happen for connected fixed cells...
+      for (NodeOwners::iterator c = node.owners.begin(); c != node.owners.end(); c++) {
+        if (!c->cell->BoundaryPolP() && c->cell->FixedP()) {
+          vector< pair<const Node *, Vector> > old_positions;
+          if (mc_check_intersections) SavePositions(c->cell->nodes, old_positions);
+          sum_dh += c->cell->Displace(rx, ry, 0, rng);
+          if (mc_check_intersections) edge_grid.MoveNodes(old_positions);
         }
+      }
+    }
+    else {
 
-        // bending energy also holds for outer boundary
-        // first implementation. Can probably be done more efficiently
-        // calculate circumcenter radius (gives local curvature)
-        // the ideal bending state is flat... (K=0)
-        {
-          // strong bending energy to resist "cleaving" by division planes
-          double r1, r2, xc, yc;
-          CircumCircle(i_min_1.x, i_min_1.y, old_p.x, old_p.y, i_plus_1.x, i_plus_1.y,
-            &xc, &yc, &r1);
-          CircumCircle(i_min_1.x, i_min_1.y, new_p.x, new_p.y, i_plus_1.x, i_plus_1.y,
-            &xc, &yc, &r2);
-
-          if (r1 < 0 || r2 < 0) {
-            MyWarning::warning("r1 = %f, r2 = %f", r1, r2);
+
+      if (dh < -sum_stiff || rng.Uniform() < exp((-dh - sum_stiff) / par.T)) {
+
+        // update areas of cells
+        vector<DeltaIntgrl>::const_iterator di_it = delta_intgrl_list.begin();
+        for (NodeOwners::iterator cit = node.owners.begin(); cit != node.owners.end(); (cit++)) {
+          if (!cit->cell->BoundaryPolP()) {
+            cit->cell->area -= di_it->area;
+            if (par.lambda_celllength) {
+              cit->cell->intgrl_x -= di_it->ix;
+              cit->cell->intgrl_y -= di_it->iy;
+              cit->cell->intgrl_xx -= di_it->ixx;
+              cit->cell->intgrl_xy -= di_it->ixy;
+              cit->cell->intgrl_yy -= di_it->iyy;
+            }
+            di_it++;
           }
-          bending_dh += DSQR(1 / r2 - 1 / r1);
+        }
+
+        double old_nodex, old_nodey;
+
+        old_nodex = node.x;
+        old_nodey = node.y;
+
+        node.x = new_p.x;
+        node.y = new_p.y;
 
+        if (mc_check_intersections) {
+          edge_grid.MoveNode(&node, old_p);
         }
 
+        for (NodeOwners::iterator cit = node.owners.begin();
+          cit != node.owners.end();
+          (cit++)) {
 
+          /*   if (cit->cell >= 0 && cells[cit->cell].SelfIntersect()) {
+         node.x = old_nodex;
+         node.y = old_nodey;
+         goto next_node;
+         }*/
+        }
+        sum_dh += dh;
       }
+    }
+  }
+}
 
+/*! Greedy coloring of "nitems" items by the cells they touch: item k
+  gets the lowest color that none of its cells has given out yet, so
+  no two items of one color share a cell. "cells_of(k, cells)" appends
+  the indices of the cells of item k to "cells", which is otherwise
+  empty. Each item touches at most "max_cells" cells, and a cell holds
+  at most "max_items" items. The items are colored in index order and
+  stay in that order within their colors.
+*/
+template<class CellsOf>
+static void GreedyCellColoring(int nitems, int ncells, size_t max_cells, size_t max_items,
+  CellsOf cells_of, vector< vector<int> >& colors) {
 
+  colors.clear();
 
+  // an item conflicts with at most all other items of its cells,
+  // which bounds the number of colors we need
+  const int bits = 8 * sizeof(unsigned int);
+  const int nwords = (max_cells * max_items) / bits + 1;
 
-      dh = area_dh + cell_length_dh +
-        par.lambda_length * length_dh + par.bend_lambda * bending_dh + par.alignment_lambda * alignment_dh;
+  // used_colors holds a bitset of colors per cell
+  vector<unsigned int> used_colors(ncells * nwords, 0);
+  vector<unsigned int> forbidden(nwords);
+  vector<int> item_cells;
+  item_cells.reserve(max_cells);
 
-      //(length_constraint_after - length_constraint_before);
+  for (int k = 0; k < nitems; k++) {
 
-      if (node.fixed) {
+    item_cells.clear();
+    cells_of(k, item_cells);
 
-        // search the fixed cell to which this node belongs
-        // and displace these cells as a whole
-        // WARNING: undefined things will happen for connected fixed cells...
-        for (list<Neighbor>::iterator c = node.owners.begin(); c != node.owners.end(); c++) {
-          if (!c->cell->BoundaryPolP() && c->cell->FixedP()) {
-            sum_dh += c->cell->Displace(rx, ry, 0);
-          }
-        }
+    fill(forbidden.begin(), forbidden.end(), 0);
+    for (vector<int>::const_iterator c = item_cells.begin(); c != item_cells.end(); c++) {
+      for (int w = 0; w < nwords; w++) {
+        forbidden[w] |= used_colors[*c * nwords + w];
       }
-      else {
+    }
 
+    int color = 0;
+    for (int w = 0; w < nwords; w++) {
+      if (~forbidden[w]) {
+        int b = 0;
+        while (forbidden[w] & (1u << b)) b++;
+        color = w * bits + b;
+        break;
+      }
+    }
 
-        if (dh < -sum_stiff || RANDOM() < exp((-dh - sum_stiff) / par.T)) {
-
-          // update areas of cells
-          list<DeltaIntgrl>::const_iterator di_it = delta_intgrl_list.begin();
-          for (list<Neighbor>::iterator cit = node.owners.begin(); cit != node.owners.end(); (cit++)) {
-            if (!cit->cell->BoundaryPolP()) {
-              cit->cell->area -= di_it->area;
-              if (par.lambda_celllength) {
-                cit->cell->intgrl_x -= di_it->ix;
-                cit->cell->intgrl_y -= di_it->iy;
-                cit->cell->intgrl_xx -= di_it->ixx;
-                cit->cell->intgrl_xy -= di_it->ixy;
-                cit->cell->intgrl_yy -= di_it->iyy;
-              }
-              di_it++;
-            }
-          }
+    for (vector<int>::const_iterator c = item_cells.begin(); c != item_cells.end(); c++) {
+      used_colors[*c * nwords + color / bits] |= (1u << (color % bits));
+    }
 
-          double old_nodex, old_nodey;
+    if ((int)colors.size() <= color) {
+      colors.resize(color + 1);
+    }
+    colors[color].push_back(k);
+  }
+}
 
-          old_nodex = node.x;
-          old_nodey = node.y;
+// The cells of item k are cells[start[k]] .. cells[start[k+1]-1]
+class ItemCells {
+public:
+  ItemCells(const vector<int> &start_, const vector<int> &cells_) : start(start_), cells(cells_) {}
+  void operator()(int k, vector<int> &item_cells) const {
+    item_cells.insert(item_cells.end(), cells.begin() + start[k], cells.begin() + start[k + 1]);
+  }
+private:
+  const vector<int> &start, &cells;
+};
 
-          node.x = new_p.x;
-          node.y = new_p.y;
+/*! Assign each movable node to a color, such that no two nodes with
+  the same color share an owning cell. Moves of nodes within one color
+  touch disjoint cells and can be evaluated concurrently.
 
-          for (list<Neighbor>::iterator cit = node.owners.begin();
-            cit != node.owners.end();
-            (cit++)) {
+  Nodes that move more than their own cell walls (node sets, fixed
+  nodes which displace whole cells) and nodes on the boundary polygon,
+  which all nodes on the boundary share, are collected in serial_nodes
+  instead.
 
-            /*   if (cit->cell >= 0 && cells[cit->cell].SelfIntersect()) {
-           node.x = old_nodex;
-           node.y = old_nodey;
-           goto next_node;
-           }*/
-          }
-          sum_dh += dh;
-        }
+  The coloring is greedy, in node index order, so it is deterministic
+  for a given mesh.
+*/
+void Mesh::ColorNodes(void) {
+
+  node_colors.clear();
+  serial_nodes.clear();
+
+  size_t max_cell_size = 0, max_owners = 0;
+  for (vector<Cell*>::const_iterator c = cells.begin(); c != cells.end(); c++) {
+    max_cell_size = max(max_cell_size, (*c)->nodes.size());
+  }
+  for (vector<Node*>::const_iterator n = nodes.begin(); n != nodes.end(); n++) {
+    max_owners = max(max_owners, (*n)->owners.size());
+  }
+
+  // the nodes to color, and their owning cells
+  vector<Node *> movable;
+  vector<int> owner_start(1, 0), owner_cells;
+  for (vector<Node*>::const_iterator n = nodes.begin(); n != nodes.end(); n++) {
+
+    Node& node(**n);
+
+    if (node.DeadP()) continue;
+
+    bool serial = node.node_set || node.fixed;
+    for (NodeOwners::const_iterator cit = node.owners.begin(); !serial && cit != node.owners.end(); cit++) {
+      if (cit->cell->BoundaryPolP() || cit->cell->Index() < 0) {
+        serial = true;
       }
     }
-  next_node:
-    delta_intgrl_list.clear();//dA_list.clear();
+    if (serial) {
+      serial_nodes.push_back(&node);
+      continue;
+    }
 
+    movable.push_back(&node);
+    for (NodeOwners::const_iterator cit = node.owners.begin(); cit != node.owners.end(); cit++) {
+      owner_cells.push_back(cit->cell->Index());
+    }
+    owner_start.push_back(owner_cells.size());
   }
 
-  return sum_dh;
+  vector< vector<int> > colors;
+  GreedyCellColoring(movable.size(), cells.size(), max_owners, max_cell_size,
+    ItemCells(owner_start, owner_cells), colors);
+
+  node_colors.resize(colors.size());
+  for (size_t color = 0; color < colors.size(); color++) {
+    node_colors[color].reserve(colors[color].size());
+    for (vector<int>::const_iterator k = colors[color].begin(); k != colors[color].end(); k++) {
+      node_colors[color].push_back(movable[*k]);
+    }
+  }
+}
+
+void Mesh::DoCellHouseKeeping(void) {
+
+  if (par.housekeeping_threads > 0) {
+    DoCellHouseKeepingParallel(par.housekeeping_threads);
+    return;
+  }
+
+  DoCellHouseKeepingSerial();
+}
+
+void Mesh::DoCellHouseKeepingSerial(void) {
+
+  vector<Cell*> current_cells = cells;
+  for (vector<Cell*>::iterator i = current_cells.begin();
+    i != current_cells.end();
+    i++) {
+    plugin->CellHouseKeeping(*i);
+
+    // Call functions of Cell that cannot be called from CellBase, including Division
+    if ((*i)->flag_for_divide) {
+      DivideFlaggedCell(**i);
+    }
+  }
+}
+
+/*! Two-phase version of DoCellHouseKeeping, used if
+  par.housekeeping_threads > 0 and the plugin allows it (see
+  SimPluginInterface::ParallelHouseKeeping).
+
+  First the plugin's CellHouseKeeping runs for all cells in parallel.
+  RANDOM() then draws from a stream per cell, keyed by the cell's
+  index and a seed that is drawn from the global generator once per
+  call, so the numbers do not depend on the number of threads. The
+  plugin's own RANDOM() draws from these streams too: the host hands
+  them over when the plugin is installed (see
+  SimPluginInterface::SetLocalRandomStreams). CellBase::Divide and
+  DivideOverAxis only flag the cell, so while the plugin runs, all
+  cells see the mesh as it was at the start of the step.
+
+  Then the flagged cells are divided serially, in the order of their
+  index, which is the order the serial version uses; the daughters are
+  appended to "cells" and are not visited again.
+*/
+void Mesh::DoCellHouseKeepingParallel(int nthreads) {
+
+  if (!plugin->ParallelHouseKeeping()) {
+    MyWarning::unique_warning("Plugin %s does not allow parallel housekeeping; housekeeping_threads is ignored.",
+      plugin->ModelID().toStdString().c_str());
+    DoCellHouseKeepingSerial();
+    return;
+  }
+
+  int ncells = cells.size();
+  const long seed = RandomNumber(MBIG);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 16)
+#endif
+  for (int i = 0; i < ncells; i++) {
+    PhiloxStream stream(seed, i);
+    LocalRandomStream local(stream);
+    plugin->CellHouseKeeping(cells[i]);
+  }
+
+  for (int i = 0; i < ncells; i++) {
+    if (cells[i]->flag_for_divide) {
+      DivideFlaggedCell(*cells[i]);
+    }
+  }
+}
+
+// Divide a cell that was flagged for division by CellBase::Divide or
+// CellBase::DivideOverAxis
+void Mesh::DivideFlaggedCell(Cell& c) {
+
+  if (c.division_axis) {
+    c.DivideOverAxis(*c.division_axis);
+    delete c.division_axis;
+    c.division_axis = 0;
+  }
+  else {
+    c.Divide();
+  }
+  c.flag_for_divide = false;
+  InvalidateEdgeGrid();
+}
+
+/*! Multi-threaded version of DisplaceNodes.
+
+  The nodes are colored (see ColorNodes) and the colors, together with
+  the batch of nodes that must be moved serially, are visited in random
+  order. Within a color the nodes are shuffled and split into "nthreads"
+  contiguous chunks; chunk t draws from Philox stream t, keyed with a
+  seed drawn from the global generator at the start of every sweep, in
+  batches of three numbers per node (see PhiloxBuffer). Since
+  moves within a color do not interact, each color is equivalent to a
+  serial sweep over its nodes, so detailed balance is kept. The result
+  depends on the random seed and on "nthreads", but not on the number
+  of threads OpenMP actually runs, nor on whether OpenMP is available.
+*/
+double Mesh::DisplaceNodesParallel(int nthreads) {
+
+  SetDisplacementEnergy();
+  ColorNodes();
+
+  int ncolors = node_colors.size();
+
+  // the serial batch is visited as "color" ncolors
+  vector<int> color_order(ncolors + 1);
+  for (int c = 0; c <= ncolors; c++) {
+    color_order[c] = c;
+  }
+  MyUrand r(color_order.size());
+  random_shuffle(color_order.begin(), color_order.end(), r);
+
+  long sweep_seed = RandomNumber(MSEED - 1);
+  vector<PhiloxStream> streams(nthreads);
+  for (int t = 0; t < nthreads; t++) {
+    streams[t].Seed(sweep_seed, t);
+  }
+
+  vector< vector<Edge> > insertions(nthreads);
+  vector< vector<DeltaIntgrl> > delta_intgrl_lists(nthreads);
+  vector<double> sum_dh(nthreads, 0.);
+
+  double serial_sum_dh = 0.;
+
+  for_each(node_sets.begin(), node_sets.end(), mem_fun(&NodeSet::ResetDone));
+
+  for (vector<int>::const_iterator c = color_order.begin(); c != color_order.end(); c++) {
+
+    vector<Node*>& color = *c < ncolors ? node_colors[*c] : serial_nodes;
+
+    MyUrand rc(color.size());
+    random_shuffle(color.begin(), color.end(), rc);
+
+    if (*c == ncolors) {
+      GlobalRandom rng;
+      vector<Edge> serial_insertions;
+      vector<DeltaIntgrl> delta_intgrl_list;
+      for (vector<Node*>::const_iterator i = color.begin(); i != color.end(); i++) {
+        DisplaceNode(**i, rng, serial_insertions, delta_intgrl_list, serial_sum_dh);
+      }
+      for (vector<Edge>::iterator e = serial_insertions.begin(); e != serial_insertions.end(); e++) {
+        node_insertion_queue.push(*e);
+      }
+      continue;
+    }
+
+    int n = color.size();
+    int chunk = (n + nthreads - 1) / nthreads;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+#endif
+    for (int t = 0; t < nthreads; t++) {
+      int last = min(n, (t + 1) * chunk);
+      if (last <= t * chunk) continue;
+      PhiloxBuffer rng(streams[t], 3 * (last - t * chunk));
+      for (int i = t * chunk; i < last; i++) {
+        DisplaceNode(*color[i], rng, insertions[t], delta_intgrl_lists[t], sum_dh[t]);
+      }
+    }
+
+    // queue candidate edges in thread order, to stay deterministic
+    for (int t = 0; t < nthreads; t++) {
+      for (vector<Edge>::iterator e = insertions[t].begin(); e != insertions[t].end(); e++) {
+        node_insertion_queue.push(*e);
+      }
+      insertions[t].clear();
+    }
+  }
+
+  double total_dh = serial_sum_dh;
+  for (int t = 0; t < nthreads; t++) {
+    total_dh += sum_dh[t];
+  }
+  return total_dh;
 }
 
 
@@ -958,7 +1429,7 @@ void Mesh::InsertNode(Edge& e) {
   }*/
 
 
-  list<Neighbor> owners;
+  SmallVector<Neighbor, 8> owners;
 
   // push all cells owning the two nodes of the divided edges
   // onto a list
@@ -973,7 +1444,7 @@ void Mesh::InsertNode(Edge& e) {
   //cerr << endl;
 
   // sort the nodes
-  owners.sort(mem_fun_ref(&Neighbor::Cmp));
+  stable_sort(owners.begin(), owners.end(), mem_fun_ref(&Neighbor::Cmp));
 
   //  extern ofstream debug_stream;
 
@@ -982,7 +1453,7 @@ void Mesh::InsertNode(Edge& e) {
   //  debug_stream << endl;
 
   // the duplicates in this list indicate cells owning this edge  
-  list<Neighbor>::iterator c = owners.begin();
+  SmallVector<Neighbor, 8>::iterator c = owners.begin();
   while (c != owners.end()) {
     c = adjacent_find(c, owners.end(), neighbor_cell_eq);
 
@@ -1023,7 +1494,7 @@ void Mesh::InsertNode(Edge& e) {
 
 
       // - find cell c among owners of Node e.first
-      list<Neighbor>::iterator cpos =
+      NodeOwners::iterator cpos =
         find_if(e.first->owners.begin(),
           e.first->owners.end(),
           bind2nd(mem_fun_ref(&Neighbor::CellEquals), c->cell->Index()));
@@ -1138,27 +1609,53 @@ double Mesh::SumChemical(int ch) {
 
 
 
-void Mesh::CleanUpCellNodeLists(void) {
+/*! Remove the dead elements from "v", keeping the order of the others,
+  and renumber the remaining ones: each index drops by the number of
+  dead elements with a lower index. Runs in linear time, using a map
+  from old to new indices. Returns the number of elements removed.
+*/
+template<class T> int Mesh::CompactDead(vector<T*>& v) {
 
-  typedef vector <vector<Cell*>::iterator> CellItVect;
+  int max_index = -1;
+  for (typename vector<T*>::const_iterator i = v.begin(); i != v.end(); i++) {
+    max_index = max(max_index, (*i)->index);
+  }
 
-  CellItVect cellstoberemoved;
-  vector<int> cellind;
+  // new_index[k] is the new index of the element with index k
+  vector<int> new_index(max_index + 2, 0);
+  for (typename vector<T*>::const_iterator i = v.begin(); i != v.end(); i++) {
+    if ((*i)->DeadP() && (*i)->index >= 0) {
+      new_index[(*i)->index + 1]++;
+    }
+  }
+  for (int k = 0; k <= max_index; k++) {
+    new_index[k + 1] += new_index[k];
+  }
+  for (int k = 0; k <= max_index; k++) {
+    new_index[k] = k - new_index[k];
+  }
+
+  typename vector<T*>::iterator live = v.begin();
+  for (typename vector<T*>::iterator i = v.begin(); i != v.end(); i++) {
+    if ((*i)->DeadP()) continue;
+    if ((*i)->index >= 0) {
+      (*i)->index = new_index[(*i)->index];
+    }
+    *live++ = *i;
+  }
+  int removed = v.end() - live;
+  v.erase(live, v.end());
+  return removed;
+}
+
+void Mesh::CleanUpCellNodeLists(void) {
 
   // Start of by removing all stale walls.
   //DeleteLooseWalls();
-  // collect all dead cells that need to be removed from the simulation
   for (vector<Cell*>::iterator i = cells.begin(); i != cells.end(); i++) {
-    if ((*i)->DeadP()) {
-      // collect the iterators
-      cellstoberemoved.push_back(i);
-
-      // collect the indices
-      cellind.push_back((*i)->index);
-    }
-    else {
+    if (!(*i)->DeadP()) {
       // Remove pointers to dead Walls
-      for (list<Wall*>::iterator w = (*i)->walls.begin(); w != (*i)->walls.end(); w++) {
+      for (CellWalls::iterator w = (*i)->walls.begin(); w != (*i)->walls.end(); w++) {
         if ((*w)->DeadP()) {
           (*w) = 0;
         }
@@ -1168,7 +1665,7 @@ void Mesh::CleanUpCellNodeLists(void) {
   }
 
   // Remove pointers to dead Walls from BoundaryPolygon
-  for (list<Wall*>::iterator w = boundary_polygon->walls.begin(); w != boundary_polygon->walls.end(); w++) {
+  for (CellWalls::iterator w = boundary_polygon->walls.begin(); w != boundary_polygon->walls.end(); w++) {
     if ((*w)->DeadP()) {
       (*w) = 0;
     }
@@ -1176,63 +1673,33 @@ void Mesh::CleanUpCellNodeLists(void) {
   boundary_polygon->walls.remove(0);
 
 
-  // Renumber cells; this is most efficient if the list of dead cell indices is sorted
-  sort(cellind.begin(), cellind.end());
-
-
-  // Reindexing of Cells
-  for (vector<int>::reverse_iterator j = cellind.rbegin(); j != cellind.rend(); j++) {
-    for (vector<Cell*>::reverse_iterator i = cells.rbegin(); i != cells.rend(); i++) {
-      if (*j < (*i)->index) (*i)->index--;
+  // Remove the dead cells and nodes, and renumber the others. The
+  // dead cells take their chemicals with them out of the state vector
+  vector<Cell*> dead_cells;
+  for (vector<Cell*>::iterator i = cells.begin(); i != cells.end(); i++) {
+    if ((*i)->DeadP()) {
+      (*i)->DetachChem();
+      dead_cells.push_back(*i);
     }
   }
-
-
-  // Actual deleting of Cells
-  // We must delete in reverse order, otherwise the iterators become redefined
-  for (CellItVect::reverse_iterator i = cellstoberemoved.rbegin(); i != cellstoberemoved.rend(); i++) {
-    Cell::NCells()--;
-    cells.erase(*i);
-  }
-
-
-  // same for nodes
-  typedef vector <vector<Node*>::iterator> NodeItVect;
-
-  NodeItVect nodestoberemoved;
-  vector<int> nodeindlist;
-
-  // collect iterators and indices of dead nodes
+  vector<Node*> dead_nodes;
   for (vector<Node*>::iterator i = nodes.begin(); i != nodes.end(); i++) {
     if ((*i)->DeadP()) {
-      nodestoberemoved.push_back(i);
-      nodeindlist.push_back((*i)->index);
+      dead_nodes.push_back(*i);
     }
   }
 
-  // sort the list of dead nodes for renumbering
-  sort(nodeindlist.begin(), nodeindlist.end());
-
-
-  // Reindicing of Nodes
-  for (vector<int>::reverse_iterator j = nodeindlist.rbegin(); j != nodeindlist.rend(); j++) {
-    for (vector<Node*>::reverse_iterator i = nodes.rbegin(); i != nodes.rend(); i++) {
-      if (*j < (*i)->index) {
-        (*i)->index--;
-      }
-    }
+  // The dead nodes are deleted below, so they must leave the node sets
+  // and the boundary polygon as well
+  for (vector<NodeSet*>::iterator s = node_sets.begin(); s != node_sets.end(); s++) {
+    (*s)->remove_if(mem_fun(&Node::DeadP));
   }
+  boundary_polygon->nodes.remove_if(mem_fun(&Node::DeadP));
 
-  // Actual deleting of nodes
-  // We must delete in reverse order, otherwise the iterators become redefined
-  for (NodeItVect::reverse_iterator i = nodestoberemoved.rbegin(); i != nodestoberemoved.rend(); i++) {
-    Node::nnodes--;
-    nodes.erase(*i);
-  }
+  Cell::NCells() -= CompactDead(cells);
+  Node::nnodes -= CompactDead(nodes);
 
-
-
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
     if ((*w)->DeadP()) {
       Wall::nwalls--;
       delete* w;
@@ -1261,6 +1728,16 @@ void Mesh::CleanUpCellNodeLists(void) {
 
   shuffled_cells.clear();
   shuffled_cells = cells;
+  InvalidateEdgeGrid();
+
+  // Nothing refers to the dead cells and nodes anymore, so they can go;
+  // otherwise Mesh::Clear would find their pools still in use
+  for (vector<Cell*>::iterator i = dead_cells.begin(); i != dead_cells.end(); i++) {
+    delete* i;
+  }
+  for (vector<Node*>::iterator i = dead_nodes.begin(); i != dead_nodes.end(); i++) {
+    delete* i;
+  }
 }
 
 void Mesh::CutAwayBelowLine(Vector startpoint, Vector endpoint) {
@@ -1306,7 +1783,7 @@ void Mesh::CutAwaySAM(void) {
 
 void Mesh::TestIllegalWalls(void) {
 
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
     if ((*w)->IllegalP()) {
 #ifdef QDEBUG
       cerr << "Wall " << **w << " is illegal." << endl;
@@ -1317,6 +1794,34 @@ void Mesh::TestIllegalWalls(void) {
 
 
 
+/*! Test all cells for self-intersection (see Cell::SelfIntersect), in
+  parallel if OpenMP is available, and return the number of cells that
+  intersect themselves.
+*/
+int Mesh::TestSelfIntersections(void) {
+
+  int n = cells.size();
+  vector<char> intersects(n, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for (int i = 0; i < n; i++) {
+    intersects[i] = cells[i]->SelfIntersect();
+  }
+
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    if (intersects[i]) {
+      count++;
+#ifdef QDEBUG
+      qDebug() << "Cell " << cells[i]->Index() << " intersects itself." << endl;
+#endif
+    }
+  }
+  return count;
+}
+
 class node_owners_eq : public unary_function<Node, bool> {
   int no;
 public:
@@ -1367,7 +1872,7 @@ void Mesh::RepairBoundaryPolygon(void) {
   // Step 2: Remove all references to the boundary polygon from the Mesh's current list of nodes
   foreach(Node * node, nodes) {
     node->Unmark(); // remove marks, we need them to determine if we have closed the circle
-    list<Neighbor>::iterator boundary_ref_pos;
+    NodeOwners::iterator boundary_ref_pos;
     if ((boundary_ref_pos = find_if(node->owners.begin(), node->owners.end(),
       bind2nd(mem_fun_ref(&Neighbor::CellEquals), -1))) != node->owners.end()) {
       // i.e. if one of the node's owners is the boundary polygon 
@@ -1422,13 +1927,14 @@ void Mesh::RepairBoundaryPolygon(void) {
   }
 
   boundary_polygon->ConstructConnections();
-  for (list<Wall*>::iterator w = boundary_polygon->walls.begin(); w != boundary_polygon->walls.end(); w++) {
+  for (CellWalls::iterator w = boundary_polygon->walls.begin(); w != boundary_polygon->walls.end(); w++) {
     if ((*w)->DeadP()) {
       (*w) = 0;
     }
   }
   boundary_polygon->walls.remove(0);
   boundary_polygon->ConstructNeighborList();
+  InvalidateEdgeGrid();
 
 #ifdef QDEBUG
   qDebug() << "Repaired Boundary Polygon node indices: ";
@@ -1469,7 +1975,7 @@ Node* Mesh::findNextBoundaryNode(Node* boundary_node) {
   vector<int> intersection; // set intersection result
 
   // The next boundary node is that which has only one owner in common with the current boundary node
-  for (list<Neighbor>::iterator it = boundary_node->owners.begin(); it != boundary_node->owners.end(); ++it) {
+  for (NodeOwners::iterator it = boundary_node->owners.begin(); it != boundary_node->owners.end(); ++it) {
     if (it->cell->Index() != -1) boundary_node_owners.insert(it->cell->Index()); // Save each of the current boundary node's owners' Ids - except the boundary polygon 
     set<int>* owners = new set<int>; // create a set to hold a 2nd neighbor's owners' Ids
     nodeOwners.push_back(owners);
@@ -1526,7 +2032,7 @@ Node* Mesh::findNextBoundaryNode(Node* boundary_node) {
 
 
 void Mesh::CleanUpWalls(void) {
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
     if ((*w)->DeadP()) {
       delete* w;
       (*w) = 0;
@@ -1546,6 +2052,51 @@ void Mesh::Rotate(double angle, Vector center) {
   for (vector<Node*>::iterator n = nodes.begin(); n != nodes.end(); n++) {
     (*n)->setPos(rotmat * (*(*n) - center) + center);
   }
+  InvalidateEdgeGrid();
+}
+
+/*! Recompute the areas and moments of all cells (and the boundary
+  polygon) at once, as CellBase::SetIntegrals does for a single cell,
+  from a NodeStore of the mesh. Used after a mesh has been read or many
+  cells have changed shape.
+*/
+void Mesh::SetCellIntegrals(void) {
+
+  NodeStore store;
+  store.Build(nodes, cells, boundary_polygon);
+  const int n = store.NCells() + 1;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    vector<double> x, y;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+    for (int c = 0; c < n; c++) {
+      CellBase *cell = c < (int)cells.size() ? (CellBase *)cells[c] : (CellBase *)boundary_polygon;
+      if (!cell) continue;
+
+      int first = store.ring_start[c], nnodes = store.ring_start[c + 1] - first;
+      x.resize(nnodes + 1);
+      y.resize(nnodes + 1);
+      for (int k = 0; k < nnodes; k++) {
+        x[k] = store.x[store.ring[first + k]];
+        y[k] = store.y[store.ring[first + k]];
+      }
+      x[nnodes] = nnodes ? x[0] : 0.;
+      y[nnodes] = nnodes ? y[0] : 0.;
+
+      PolygonMoments m;
+      CalcPolygonMoments(&x[0], &y[0], nnodes, m);
+
+      cell->intgrl_xx = m.xx; cell->intgrl_xy = m.xy; cell->intgrl_yy = m.yy;
+      cell->intgrl_x = m.x; cell->intgrl_y = m.y;
+      cell->area = fabs(m.area) / 2.0;
+    }
+  }
 }
 
 
@@ -1555,10 +2106,14 @@ void Mesh::PrintWallList(void) {
 }
 
 #include <QString>
+#include <QTime>
 //#include "forwardeuler.h"
 #include "rungekutta.h"
+#include "rosenbrock.h"
 
-class SolveMesh : public RungeKutta {
+// Couples an ODE integrator (RungeKutta, Rosenbrock) to the mesh
+template<class Integrator>
+class SolveMesh : public Integrator {
 
 private:
   SolveMesh(void);
@@ -1568,30 +2123,31 @@ public:
 
     m = m_;
 
-    kmax = 0;
-    kount = 0;
-    xp = 0; yp = 0; dxsav = 0;
-
-
   }
 
 protected:
   virtual void derivs(double x, double* y, double* dydx) {
 
-    // set mesh with new values given by ODESolver
+    // point mesh at the new values given by ODESolver
     // (we must do this, because only mesh knows the connections
     // between the variables)
 
-    m->setValues(x, y);
+    m->PointStateAt(y);
+    m->EmitValues(x);
     m->Derivatives(dydx);
 
     //cerr << "Calculated derivatives at " << x << "\n";    
   }
 
+  // for the preconditioner of Rosenbrock
+  virtual bool jacobian(double x, double* y, SparseJacobian& J) {
+
+    m->Jacobian(y, J);
+    return true;
+  }
+
 private:
   Mesh* m;
-  int kmax, kount;
-  double* xp, ** yp, dxsav;
   bool monitor_window;
 };
 
@@ -1603,15 +2159,43 @@ void Mesh::ReactDiffuse(double delta_t) {
   for_each(walls.begin(), walls.end(),
     mem_fun(&Wall::SetLength));
 
-  static SolveMesh* solver = new SolveMesh(this);
+  static SolveMesh<RungeKutta>* solver = new SolveMesh<RungeKutta>(this);
+  static SolveMesh<Rosenbrock>* stiff_solver = new SolveMesh<Rosenbrock>(this);
+
+  bool stiff = false;
+  if (par.ode_solver && !strcmp(par.ode_solver, "rosenbrock")) {
+    stiff = true;
+  } else if (par.ode_solver && strcmp(par.ode_solver, "rungekutta")) {
+    MyWarning::unique_warning("Unknown ode_solver \"%s\", using rungekutta. Choose rungekutta or rosenbrock.", par.ode_solver);
+  }
 
   int nok, nbad, nvar;
   double* ystart = getValues(&nvar);
 
-  solver->odeint(ystart, nvar, getTime(), getTime() + delta_t,
-    par.ode_accuracy, par.dt, 1e-10, &nok, &nbad);
+  QTime timer;
+  timer.start();
+
+  if (stiff) {
+    // the solver lives on across Clear and loading; the step size is kept with the mesh
+    stiff_solver->SetLastStepSize(stiff_step);
+    stiff_solver->odeint(ystart, nvar, getTime(), getTime() + delta_t,
+      par.ode_accuracy, par.dt, 1e-10, &nok, &nbad);
+    stiff_step = stiff_solver->LastStepSize();
+  } else {
+    solver->odeint(ystart, nvar, getTime(), getTime() + delta_t,
+      par.ode_accuracy, par.dt, 1e-10, &nok, &nbad);
+  }
+
+  ODEStats& stats = stiff ? stiff_solver->Stats() : solver->Stats();
+  stats.wall_time += timer.elapsed() / 1000.;
+  if (par.ode_stats) {
+    cerr << (stiff ? "rosenbrock" : "rungekutta") << " at t = " << getTime() + delta_t
+         << " (" << nvar << " variables): " << stats << endl;
+  }
 
   setTime(getTime() + delta_t);
+  // the solver has integrated the state in place, so this only points
+  // the cells and walls back at it
   setValues(getTime(), ystart);
 }
 
@@ -1632,7 +2216,7 @@ Vector Mesh::FirstConcMoment(int chem) {
 */
 void Mesh::DeleteLooseWalls(void) {
 
-  list<Wall*>::iterator w = walls.begin();
+  SlotMap<Wall>::iterator w = walls.begin();
 
   while (w != walls.end()) {
 
@@ -1700,7 +2284,7 @@ void Mesh::CleanTransporters(const vector<double>& clean_transporters) {
 
 
   // clean transporters
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
     for (int i = 0; i < Cell::NChem(); i++) {
       (*w)->setTransporters1(i, clean_transporters[i]); (*w)->setNewTransporters1(i, clean_transporters[i]);
       (*w)->setTransporters2(i, clean_transporters[i]); (*w)->setNewTransporters2(i, clean_transporters[i]);
@@ -1723,7 +2307,7 @@ void Mesh::RandomizeChemicals(const vector<double>& max_chem, const vector<doubl
   }
 
   // randomize transporters
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
     for (int i = 0; i < Cell::NChem(); i++) {
       (*w)->setTransporters1(i, max_transporters[i] * RANDOM()); (*w)->setNewTransporters1(i, (*w)->Transporters1(i));
       (*w)->setTransporters2(i, max_transporters[i] * RANDOM()); (*w)->setNewTransporters2(i, (*w)->Transporters1(i));
@@ -1735,6 +2319,16 @@ void Mesh::RandomizeChemicals(const vector<double>& max_chem, const vector<doubl
 // we can pass to an ODESolver. 
 void Mesh::Derivatives(double* derivs) {
 
+  if (par.ode_threads > 0) {
+    DerivativesParallel(derivs, par.ode_threads);
+    return;
+  }
+
+  DerivativesSerial(derivs);
+}
+
+void Mesh::DerivativesSerial(double* derivs) {
+
   int nwalls = walls.size();
   int ncells = cells.size();
   int nchems = Cell::NChem();
@@ -1760,7 +2354,7 @@ void Mesh::Derivatives(double* derivs) {
     i += nchems;
   }
 
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
     // (*wr)(*w, &(derivs[i]), &(derivs[i+nchems]));
     plugin->WallDynamics(*w, &(derivs[i]), &(derivs[i + nchems]));
     // Transport function adds to derivatives of cell chemicals
@@ -1785,84 +2379,475 @@ void Mesh::Derivatives(double* derivs) {
   }
 }
 
-void Mesh::setValues(double x, double* y) {
+// The cells of a wall for GreedyCellColoring, without the boundary
+// polygon (see ColorWalls)
+class WallCells {
+public:
+  WallCells(const vector<int> &wall_cells_) : wall_cells(wall_cells_) {}
+  void operator()(int k, vector<int> &cells) const {
+    for (int side = 0; side < 2; side++) {
+      int c = wall_cells[2 * k + side];
+      if (c >= 0) cells.push_back(c);
+    }
+  }
+private:
+  const vector<int> &wall_cells;
+};
 
-  //int nwalls = walls.size();
-  //int ncells = cells.size();
+/*! Split the walls into batches ("colors") of walls that share no
+  cell, so that CelltoCellTransport can be called for all walls of a
+  batch concurrently. Walls at the boundary only claim their inner
+  cell, since the boundary polygon receives no derivatives.
+
+  The coloring is greedy, in the order of the walls in the state
+  vector, and the walls within a batch keep that order. It is only
+  redone when a wall was added, removed or moved to another cell since
+  the previous call.
+*/
+void Mesh::ColorWalls(void) {
+
+  bool changed = ode_walls.size() != walls.size();
+  ode_walls.resize(walls.size());
+  ode_wall_cells.resize(2 * walls.size());
+
+  int k = 0;
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++, k++) {
+    int c1 = (*w)->c1->Index(), c2 = (*w)->c2->Index();
+    if (ode_walls[k] != *w || ode_wall_cells[2 * k] != c1 || ode_wall_cells[2 * k + 1] != c2) {
+      ode_walls[k] = *w;
+      ode_wall_cells[2 * k] = c1;
+      ode_wall_cells[2 * k + 1] = c2;
+      changed = true;
+    }
+  }
+
+  if (!changed && !wall_colors.empty()) return;
+
+  size_t max_cell_size = 0;
+  for (vector<Cell*>::const_iterator c = cells.begin(); c != cells.end(); c++) {
+    max_cell_size = max(max_cell_size, (*c)->nodes.size());
+  }
+
+  GreedyCellColoring(ode_walls.size(), cells.size(), 2, max_cell_size,
+    WallCells(ode_wall_cells), wall_colors);
+}
+
+/*! Multi-threaded version of Derivatives, used if par.ode_threads > 0
+  and the plugin allows it (see SimPluginInterface::ParallelDynamics).
+
+  CellDynamics and WallDynamics only write the derivatives of their own
+  cell or wall, so they run data-parallel. CelltoCellTransport adds to
+  the derivatives of both cells of the wall; it runs one batch of walls
+  that share no cell at a time (see ColorWalls). Each cell therefore
+  receives its fluxes in a fixed order, and the result does not depend
+  on the number of threads. It may differ in the last bits from the
+  serial Derivatives, which visits the walls in list order.
+
+  The plugin's CellDynamics, WallDynamics and CelltoCellTransport must
+  be safe to call concurrently, i.e. must not write any shared state.
+*/
+void Mesh::DerivativesParallel(double* derivs, int nthreads) {
+
+  if (!plugin->ParallelDynamics()) {
+    MyWarning::unique_warning("Plugin %s does not allow parallel derivatives; ode_threads is ignored.",
+      plugin->ModelID().toStdString().c_str());
+    DerivativesSerial(derivs);
+    return;
+  }
+
+  ColorWalls();
+
+  int ncells = cells.size();
+  int nwalls = ode_walls.size();
   int nchems = Cell::NChem();
+  int neqs = 2 * nwalls * nchems + ncells * nchems;
+  int ncolors = wall_colors.size();
 
-  // two eqs per chemical for each walls, and one eq per chemical for each cell
-  // This is for generality. For a specific model you may optimize
-  // this by removing superfluous (empty) equations.
-  //int neqs = 2 * nwalls * nchems + ncells * nchems;
+  double* dwalls = derivs + ncells * nchems;
 
-  // Layout of derivatives: cells [ chem1 ... chem n]  walls [ [ w1(chem 1) ... w1(chem n) ] [ w2(chem 1) ... w2(chem n) ] ]
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int i = 0; i < neqs; i++) {
+      derivs[i] = 0.;
+    }
 
-  int i = 0;
-  static int emit_count = 0;
-  const int stride = 100;
-  for (vector<Cell*>::iterator c = cells.begin(); c != cells.end(); c++) {
-    for (int ch = 0; ch < nchems; ch++) {
-      (*c)->SetChemical(ch, y[i + ch]);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64) nowait
+#endif
+    for (int c = 0; c < ncells; c++) {
+      plugin->CellDynamics(cells[c], &(derivs[c * nchems]));
     }
-    if (!(emit_count % stride)) {
-      (*c)->EmitValues(x);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+    for (int w = 0; w < nwalls; w++) {
+      plugin->WallDynamics(ode_walls[w], &(dwalls[2 * w * nchems]), &(dwalls[(2 * w + 1) * nchems]));
     }
-    i += nchems;
+
+    // CellDynamics may overwrite the derivatives of its cell, so all
+    // cells must be done (barrier above) before the transport starts
+    for (int color = 0; color < ncolors; color++) {
+      const vector<int>& batch = wall_colors[color];
+      int n = batch.size();
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+      for (int i = 0; i < n; i++) {
+        int w = batch[i];
+        int c1 = ode_wall_cells[2 * w], c2 = ode_wall_cells[2 * w + 1];
+        // as in Derivatives, the boundary polygon's fluxes go nowhere
+        double dummy1, dummy2;
+        double* dchem_c1 = c1 < 0 ? &dummy1 : &(derivs[c1 * nchems]);
+        double* dchem_c2 = c2 < 0 ? &dummy2 : &(derivs[c2 * nchems]);
+        plugin->CelltoCellTransport(ode_walls[w], dchem_c1, dchem_c2);
+      }
+    }
+  }
+}
+
+/*! Compute the Jacobian of Derivatives at the values "y", which are
+  laid out as the state vector (see getValues), with rows and columns
+  in the same layout. The mesh is left pointing at "y" (see
+  PointStateAt).
+
+  The sparsity pattern follows from the topology: the derivatives of a
+  cell depend on its own chemicals, the chemicals of its neighbors and
+  the transporters of the walls between them; those of a wall depend on
+  its transporters and the chemicals of its two cells. The pattern is
+  set up again only if a wall connects other cells than before.
+
+  If the plugin supplies analytic blocks (SimPluginInterface::
+  CellJacobian and WallJacobian) they are assembled. Otherwise the
+  Jacobian is estimated by forward differences, perturbing all columns
+  of a color at once, which takes J.NColors() + 1 evaluations of
+  Derivatives; the number of colors depends on the largest number of
+  neighbors of a cell, not on the size of the mesh.
+*/
+void Mesh::Jacobian(double* y, SparseJacobian& J) {
+
+  int neqs = NEqs();
+  int ncells = cells.size();
+  int nchems = Cell::NChem();
+
+  vector<int> key;
+  key.reserve(2 * walls.size() + 2);
+  key.push_back(ncells);
+  key.push_back(nchems);
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++) {
+    key.push_back((*w)->c1->Index());
+    key.push_back((*w)->c2->Index());
+  }
+  if (J.NRows() != neqs || J.Key() != key) {
+    JacobianPattern(J, key);
   }
 
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
-    for (int ch = 0; ch < nchems; ch++) {
-      (*w)->setTransporters1(ch, y[i + ch]);
+  J.Zero();
+  if (neqs == 0) {
+    return;
+  }
+
+  PointStateAt(y);
+  if (AnalyticJacobian(J)) {
+    return;
+  }
+
+  vector<double> f0(neqs), f1(neqs), y_pert(y, y + neqs), delta(neqs);
+  Derivatives(&f0[0]);
+
+  // from here on the cells and walls read their values from y_pert
+  PointStateAt(&y_pert[0]);
+
+  for (int color = 0; color < J.NColors(); color++) {
+
+    for (int c = J.color_start[color]; c < J.color_start[color + 1]; c++) {
+      int j = J.color_cols[c];
+      y_pert[j] = y[j] + sqrt(DBL_EPSILON) * max(fabs(y[j]), 1.);
+      // the step that is actually taken, after rounding
+      delta[j] = y_pert[j] - y[j];
     }
-    i += nchems;
 
-    for (int ch = 0; ch < nchems; ch++) {
-      (*w)->setTransporters2(ch, y[i + ch]);
+    Derivatives(&f1[0]);
+
+    for (int c = J.color_start[color]; c < J.color_start[color + 1]; c++) {
+      int j = J.color_cols[c];
+      for (int e = J.col_start[j]; e < J.col_start[j + 1]; e++) {
+        int i = J.col_rows[e];
+        J.val[J.col_entry[e]] = (f1[i] - f0[i]) / delta[j];
+      }
+      y_pert[j] = y[j];
     }
-    i += nchems;
   }
-  emit_count++;
+
+  PointStateAt(y);
 }
 
-double* Mesh::getValues(int* neqs) {
+void Mesh::JacobianPattern(SparseJacobian& J, const vector<int>& key) {
 
-  int nwalls = walls.size();
   int ncells = cells.size();
   int nchems = Cell::NChem();
+  int neqs = NEqs();
+
+  // (row, column) pairs of the nonzero blocks; the walls' variables
+  // start after those of the cells
+  vector< pair<int, int> > entries;
+  for (int c = 0; c < ncells; c++) {
+    for (int a = 0; a < nchems; a++) {
+      for (int b = 0; b < nchems; b++) {
+        entries.push_back(make_pair(c * nchems + a, c * nchems + b));
+      }
+    }
+  }
 
-  // two eqs per chemical for each wall, and one eq per chemical for each cell
-  // This is for generality. For a specific model you may optimize
-  // this by removing superfluous (empty) equations.
-  (*neqs) = 2 * nwalls * nchems + ncells * nchems;
+  vector<int> vars;
+  int offset = ncells * nchems;
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++, offset += 2 * nchems) {
+    // the variables coupled by this wall: the chemicals of its cells
+    // (not of the boundary polygon) and its transporters
+    vars.clear();
+    int cw[2] = { (*w)->c1->Index(), (*w)->c2->Index() };
+    for (int side = 0; side < 2; side++) {
+      if (cw[side] < 0) continue;
+      for (int a = 0; a < nchems; a++) {
+        vars.push_back(cw[side] * nchems + a);
+      }
+    }
+    for (int a = 0; a < 2 * nchems; a++) {
+      vars.push_back(offset + a);
+    }
+    for (vector<int>::const_iterator i = vars.begin(); i != vars.end(); i++) {
+      for (vector<int>::const_iterator j = vars.begin(); j != vars.end(); j++) {
+        entries.push_back(make_pair(*i, *j));
+      }
+    }
+  }
 
-  // Layout of derivatives: cells [ chem1 ... chem n]  walls [ [ w1(chem 1) ... w1(chem n) ] [ w2(chem 1) ... w2(chem n) ] ]
+  J.SetPattern(neqs, entries, key);
+}
+
+/*! Assemble the Jacobian from the plugin's analytic cell and wall
+  blocks. Returns false, leaving J zero, if the plugin declines to
+  supply any of them.
+*/
+bool Mesh::AnalyticJacobian(SparseJacobian& J) {
+
+  int nchems = Cell::NChem();
+  int ncells = cells.size();
+
+  vector<double> block(16 * nchems * nchems);
+
+  for (int c = 0; c < ncells; c++) {
+    if (!plugin->CellJacobian(cells[c], &block[0])) {
+      J.Zero();
+      return false;
+    }
+    for (int a = 0; a < nchems; a++) {
+      for (int b = 0; b < nchems; b++) {
+        J.Add(c * nchems + a, c * nchems + b, block[a * nchems + b]);
+      }
+    }
+  }
+
+  // wall block rows and columns: [chemicals of c1, chemicals of c2,
+  // transporters1, transporters2], or -1 for the boundary polygon
+  int n = 4 * nchems;
+  vector<int> vars(n);
+  int offset = ncells * nchems;
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++, offset += 2 * nchems) {
+    if (!plugin->WallJacobian(*w, &block[0])) {
+      J.Zero();
+      return false;
+    }
+    int cw[2] = { (*w)->c1->Index(), (*w)->c2->Index() };
+    for (int a = 0; a < nchems; a++) {
+      vars[a] = cw[0] < 0 ? -1 : cw[0] * nchems + a;
+      vars[nchems + a] = cw[1] < 0 ? -1 : cw[1] * nchems + a;
+      vars[2 * nchems + a] = offset + a;
+      vars[3 * nchems + a] = offset + nchems + a;
+    }
+    for (int r = 0; r < n; r++) {
+      if (vars[r] < 0) continue;
+      for (int s = 0; s < n; s++) {
+        if (vars[s] < 0) continue;
+        J.Add(vars[r], vars[s], block[r * n + s]);
+      }
+    }
+  }
+  return true;
+}
+
+/*! Store the chemicals of the cells and the transporters of the walls
+  in the state vector, in the layout of Derivatives, and point the
+  cells' and walls' arrays at their slots. The ODE solver can then
+  integrate the state in place.
+
+  The state is only rebuilt if cells or walls have been added, removed
+  or reordered since the last call.
+*/
+void Mesh::BindState(void) {
+
+  const int nchems = Cell::NChem();
+  const int neqs = NEqs();
+
+  if (!neqs) {
+    state.clear();
+    return;
+  }
+
+  // is every cell and wall still pointing at its own slot?
+  bool bound = (int)state.size() == neqs;
+  int i = 0;
+  for (vector<Cell*>::const_iterator c = cells.begin(); bound && c != cells.end(); c++) {
+    bound = (*c)->chem == &state[i];
+    i += nchems;
+  }
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); bound && w != walls.end(); w++) {
+    bound = (*w)->transporters1 == &state[i] && (*w)->transporters2 == &state[i + nchems];
+    i += 2 * nchems;
+  }
+  if (bound) return;
+
+  // copy the current values (from the cells' and walls' own arrays, or
+  // the old state) into a new state
+  vector<double> new_state(neqs);
+  i = 0;
+  for (vector<Cell*>::const_iterator c = cells.begin(); c != cells.end(); c++) {
+    copy((*c)->chem, (*c)->chem + nchems, &new_state[i]);
+    i += nchems;
+  }
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++) {
+    copy((*w)->transporters1, (*w)->transporters1 + nchems, &new_state[i]);
+    copy((*w)->transporters2, (*w)->transporters2 + nchems, &new_state[i + nchems]);
+    i += 2 * nchems;
+  }
+
+  state.swap(new_state);
+  PointStateAt(&state[0]);
+}
+
+/*! Return true if the chemicals of every cell and the transporters of
+  every wall are either in the object's own arrays, or in its slot in
+  the state vector. They can only point anywhere else (into the arrays
+  of the ODE solver, see PointStateAt) while ReactDiffuse runs; code
+  that reads the values outside ReactDiffuse, e.g. to save them, may
+  assert this.
+*/
+bool Mesh::StateInPlaceP(void) const {
+
+  const int nchems = Cell::NChem();
+  const double *slot = state.empty() ? 0 : &state[0];
+  const double *end = slot + state.size();
+
+  for (vector<Cell*>::const_iterator c = cells.begin(); c != cells.end(); c++, slot += nchems) {
+    if ((*c)->chem != (*c)->own_chem && (slot >= end || (*c)->chem != slot)) return false;
+  }
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++, slot += 2 * nchems) {
+    bool own = (*w)->transporters1 == (*w)->own_transporters1 && (*w)->transporters2 == (*w)->own_transporters2;
+    if (!own && (slot >= end || (*w)->transporters1 != slot || (*w)->transporters2 != slot + nchems)) return false;
+  }
+  return true;
+}
 
-  static double* values = 0;
-  if (values != 0) { delete[] values; }
+/*! Point the chemicals of the cells and the transporters of the walls
+  at the values in "y", which is laid out as in Derivatives. This
+  changes no values, so it is cheaper than copying "y" in with
+  setValues; but "y" must remain valid until the mesh is pointed at
+  other values.
+
+  Only the cells and walls of the mesh are pointed at "y". A cell or
+  wall that leaves the mesh must first be detached from the state
+  (CellBase::DetachChem, WallBase::DetachTransporters), and shallow
+  copies of walls detach themselves; otherwise they would keep
+  pointing into a vector that is rebuilt without them. See also
+  StateInPlaceP.
+*/
+void Mesh::PointStateAt(double* y) {
 
-  values = new double[*neqs];
+  const int nchems = Cell::NChem();
 
   int i = 0;
   for (vector<Cell*>::iterator c = cells.begin(); c != cells.end(); c++) {
-    for (int ch = 0; ch < nchems; ch++) {
-      values[i + ch] = (*c)->Chemical(ch);
-    }
+    (*c)->chem = y + i;
     i += nchems;
   }
 
-  for (list<Wall*>::iterator w = walls.begin(); w != walls.end(); w++) {
-    for (int ch = 0; ch < nchems; ch++) {
-      values[i + ch] = (*w)->Transporters1(ch);
+  for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
+    (*w)->transporters1 = y + i;
+    (*w)->transporters2 = y + i + nchems;
+    i += 2 * nchems;
+  }
+}
+
+void Mesh::setValues(double x, double* y) {
+
+  //int nwalls = walls.size();
+  //int ncells = cells.size();
+  int nchems = Cell::NChem();
+
+  // Layout of derivatives: cells [ chem1 ... chem n]  walls [ [ w1(chem 1) ... w1(chem n) ] [ w2(chem 1) ... w2(chem n) ] ]
+
+  if (!state.empty() && y == &state[0]) {
+    // the values are already in place
+    PointStateAt(y);
+  }
+  else {
+    int i = 0;
+    for (vector<Cell*>::iterator c = cells.begin(); c != cells.end(); c++) {
+      for (int ch = 0; ch < nchems; ch++) {
+        (*c)->SetChemical(ch, y[i + ch]);
+      }
+      i += nchems;
     }
-    i += nchems;
 
-    for (int ch = 0; ch < nchems; ch++) {
-      values[i + ch] = (*w)->Transporters2(ch);
+    for (SlotMap<Wall>::iterator w = walls.begin(); w != walls.end(); w++) {
+      for (int ch = 0; ch < nchems; ch++) {
+        (*w)->setTransporters1(ch, y[i + ch]);
+      }
+      i += nchems;
+
+      for (int ch = 0; ch < nchems; ch++) {
+        (*w)->setTransporters2(ch, y[i + ch]);
+      }
+      i += nchems;
     }
-    i += nchems;
   }
-  return values;
+
+  EmitValues(x);
+}
+
+//! Let every 100th call pass the cells' values at time x to the monitors
+void Mesh::EmitValues(double x) {
+
+  static int emit_count = 0;
+  const int stride = 100;
+
+  if (!(emit_count % stride)) {
+    for (vector<Cell*>::iterator c = cells.begin(); c != cells.end(); c++) {
+      (*c)->EmitValues(x);
+    }
+  }
+  emit_count++;
+}
+
+/*! Return the state vector, which holds the chemicals of the cells and
+  the transporters of the walls, and which the cells and walls read
+  from and write to directly; see BindState. */
+double* Mesh::getValues(int* neqs) {
+
+  // two eqs per chemical for each wall, and one eq per chemical for each cell
+  // This is for generality. For a specific model you may optimize
+  // this by removing superfluous (empty) equations.
+  (*neqs) = NEqs();
+
+  // Layout of derivatives: cells [ chem1 ... chem n]  walls [ [ w1(chem 1) ... w1(chem n) ] [ w2(chem 1) ... w2(chem n) ] ]
+
+  BindState();
+  return state.empty() ? 0 : &state[0];
 }
 
 void Mesh::DrawNodes(QGraphicsScene* c) const {
@@ -1887,7 +2872,7 @@ double Mesh::CalcProtCellsWalls(int ch) const {
   double sum_prot = 0.;
 
   // At membranes
-  for (list<Wall*>::const_iterator w = walls.begin(); w != walls.end(); w++) {
+  for (SlotMap<Wall>::const_iterator w = walls.begin(); w != walls.end(); w++) {
     sum_prot += (*w)->Transporters1(ch);
     sum_prot += (*w)->Transporters2(ch);
   }
@@ -1985,7 +2970,7 @@ void Mesh::Clean(void) {
 #ifdef QDEBUG
   qDebug() << "Freeing walls" << endl;
 #endif
-  for (list<Wall*>::iterator i = walls.begin(); i != walls.end(); i++) {
+  for (SlotMap<Wall>::iterator i = walls.begin(); i != walls.end(); i++) {
     delete* i;
   }
   walls.clear();
@@ -1994,6 +2979,7 @@ void Mesh::Clean(void) {
   node_insertion_queue.clear();
   shuffled_nodes.clear();
   shuffled_cells.clear();
+  InvalidateEdgeGrid();
   time = 0.0;
 }
 
@@ -2126,7 +3112,7 @@ void Mesh::CSVExportWallData(QTextStream& csv_stream) const {
     csv_stream << ",\"Transporter B:" << c << "\"";
   }
   csv_stream << endl;
-  for (list<Wall*>::const_iterator i = walls.begin();
+  for (SlotMap<Wall>::const_iterator i = walls.begin();
     i != walls.end();
     i++) {
     csv_stream << (*i)->Index() << ","
@@ -38,30 +38,59 @@
 #include "cell.h"
 #include "node.h"
 #include "simplugin.h"
+#include "edgegrid.h"
+#include "sparsejacobian.h"
+#include "slotmap.h"
 #include <QVector>
 #include <QPair>
+#include <QHash>
+#include <QSet>
 #include <QDebug>
 #include <QTextStream>
 
 using namespace std;
-// new queue which rejects duplicate elements
+// Hash of an Edge that does not depend on the direction of the edge,
+// consistent with Edge::operator==
+inline uint qHash(const Edge &e) {
+  return less<Node *>()(e.first, e.second) ?
+    qHash(qMakePair(e.first, e.second)) : qHash(qMakePair(e.second, e.first));
+}
+
+// new queue which rejects duplicate elements; the elements currently
+// in the queue are kept in a hash set as well, so that "push" takes
+// constant time. Elements leave in the order they were pushed.
 template<class T, class C = deque<T> > class unique_queue : public queue<T,C> {
 
 public:
   typedef typename C::value_type value_type;
   // reimplements push: reject element if it exists already
   void push(const value_type &x) {
-    if (find (queue<T,C>::c.begin(),queue<T,C>::c.end(),x)==queue<T,C>::c.end()) {
+    if (!members.contains(x)) {
+      members.insert(x);
       queue<T,C>::c.push_back(x);
     }
   }
+  // reimplements pop: a popped element may be pushed again
+  void pop(void) {
+    members.remove(queue<T,C>::front());
+    queue<T,C>::pop();
+  }
   void clear(void) {
     queue<T,C>::c.clear();
+    members.clear();
   }
+
+private:
+  QSet<T> members;
 };
 
 template<class P> P& deref_ptr ( P *obj) { return *obj; }
 
+class DeltaIntgrl;
+class LeafMLReader;
+class LeafMLWriter;
+struct TrajectoryFrame;
+
 
 class Mesh {
 
@@ -81,15 +110,24 @@ public:
     nodes.reserve(500);
 
     time = 0.;
+    stiff_step = 0.;
     plugin = 0;
     boundary_polygon=0;
+    mc_anisotropic2 = false;
+    mc_bending = true;
+    mc_check_intersections = false;
 
+    // new nodes, cells and walls come from this mesh's pools
+    SelectPools(&object_pools, &wall_payload_pools);
   };
   ~Mesh(void) {
     if (boundary_polygon) {
       delete boundary_polygon;
       boundary_polygon=0;
     }
+    if (&ObjectPools() == &object_pools) {
+      SelectPools(0, 0);
+    }
   };
 
   void Clean(void);
@@ -135,7 +173,7 @@ public:
   }
 
   template<class Op> void LoopWalls(Op f) {
-    for (list <Wall *>::iterator i=walls.begin();
+    for (SlotMap<Wall>::iterator i=walls.begin();
          i!=walls.end();
          i++) {
       f(**i);
@@ -201,26 +239,8 @@ public:
     }
   }
 
-  void DoCellHouseKeeping(void) {
-    vector<Cell *> current_cells = cells;
-    for (vector<Cell *>::iterator i = current_cells.begin();
-         i != current_cells.end();
-         i ++) {
-      plugin->CellHouseKeeping(*i);
-
-      // Call functions of Cell that cannot be called from CellBase, including Division
-      if ((*i)->flag_for_divide) {
-        if ((*i)->division_axis) {
-          (*i)->DivideOverAxis(*(*i)->division_axis);
-          delete (*i)->division_axis;
-          (*i)->division_axis = 0;
-        } else {
-          (*i)->Divide();
-        }
-        (*i)->flag_for_divide=false;
-      }
-    }
-  }
+  void DoCellHouseKeeping(void);
+  void DoCellHouseKeepingParallel(int nthreads);
 
   // Apply "f" to cell i
   // i.e. this is an adapter which allows you to call a function
@@ -230,6 +250,7 @@ public:
   }
 
   double DisplaceNodes(void);
+  double DisplaceNodesParallel(int nthreads);
 
   void BoundingBox(Vector &LowerLeft, Vector &UpperRight);
   int NEqs(void) {     int nwalls = walls.size();
@@ -322,6 +343,11 @@ public:
   void setValues(double x, double *y);
   double *getValues(int *neqs);
   void Derivatives(double *derivs);
+  void DerivativesParallel(double *derivs, int nthreads);
+  // Jacobian of Derivatives at the values y
+  void Jacobian(double *y, SparseJacobian &J);
+  void PointStateAt(double *y);
+  void EmitValues(double x);
 #ifdef QTGRAPHICS
   inline void DrawBoundary(QGraphicsScene *c) {
     boundary_polygon->Draw(c);
@@ -332,7 +358,12 @@ public:
   double max_chem;
 
   void XMLSave(const char *docname, xmlNode *settings=0) const;
+  void XMLSave(xmlBufferPtr buffer, const char *docname, xmlNode *settings=0) const;
+  void CheckpointSave(const char *fname, xmlNode *settings=0) const;
+  void CheckpointRead(const char *fname, xmlNode **settings=0, bool geometry = true, bool pars = true, bool simtime = true);
+  void GetTrajectoryFrame(TrajectoryFrame &frame) const;
   void XMLRead(const char *docname, xmlNode **settings=0, bool geometry = true, bool pars = true, bool simtime = true);
+  void XMLReadTree(const char *docname, xmlNode **settings=0, bool geometry = true, bool pars = true, bool simtime = true);
   void XMLReadPars(const xmlNode * root_node);
   void XMLReadGeometry(const xmlNode *root_node);
   void XMLReadSimtime(const xmlNode *root_node);
@@ -350,8 +381,10 @@ public:
   void CutAwaySAM(void);
   void RepairBoundaryPolygon(void);
   void Rotate(double angle, Vector center);
+  void SetCellIntegrals(void);
   void PrintWallList( void );
   void TestIllegalWalls(void);
+  int TestSelfIntersections(void);
   Vector FirstConcMoment(int chem);
   inline Vector Centroid(void) {
     return boundary_polygon->Centroid();
@@ -399,25 +432,74 @@ private:
   // Data members
   vector<Cell *> cells;
   vector<Node *> nodes;
-  list<Wall *> walls; // we need to erase elements from this container frequently, hence a list.
+  SlotMap<Wall> walls; // we need to erase elements from this container frequently, hence a slot map
 public:
   vector<NodeSet *> node_sets;
 private:
   vector<Node *> shuffled_nodes;
   vector<Cell *> shuffled_cells;
   unique_queue<Edge> node_insertion_queue;
+  // independent sets of nodes for the parallel Monte Carlo sweep,
+  // and the nodes that must be moved serially (see ColorNodes)
+  vector< vector<Node *> > node_colors;
+  vector<Node *> serial_nodes;
+  // walls in the order of the state vector, the indices of their
+  // cells when they were colored, and batches of walls that share no
+  // cell (see ColorWalls)
+  vector<Wall *> ode_walls;
+  vector<int> ode_wall_cells;
+  vector< vector<int> > wall_colors;
+  // energy terms of the node displacement, see SetDisplacementEnergy
+  bool mc_anisotropic2, mc_bending, mc_check_intersections;
+  typedef QPair<CellBase *, QPair<int, int> > EdgeKey;
+  QHash<EdgeKey, double> edge_wall_strength;
+  // all cell wall segments, if mc_check_intersections
+  EdgeGrid edge_grid;
+  // cell chemicals and wall transporters, in the layout of Derivatives
+  vector<double> state;
+  void BindState(void);
+  bool StateInPlaceP(void) const;
   BoundaryPolygon *boundary_polygon;
   double time;
+  // the step size the Rosenbrock solver carries between calls of
+  // ReactDiffuse; it is part of the state of a run (see CheckpointSave)
+  double stiff_step;
   SimPluginInterface *plugin;
+  // the memory of the nodes, cells and walls, and of their chemicals
+  // and transporters; released by Clear
+  PoolSet object_pools, wall_payload_pools;
 
   // Private member functions
+  void XMLSave(LeafMLWriter &writer, const char *docname, xmlNode *settings) const;
+  void XMLStreamNodes(LeafMLReader &reader);
+  void XMLStreamCells(LeafMLReader &reader, vector<int> &wall_ind, vector< pair<Cell *, int> > &cell_wall_ind);
+  void XMLStreamWalls(LeafMLReader &reader, vector<Wall *> &tmp_walls);
+  void XMLStreamNodeSets(LeafMLReader &reader);
+  void XMLConnectGeometry(void);
   void AddNodeToCell(Cell *c, Node *n, Node *nb1 , Node *nb2);
   void AddNodeToCellAtIndex(Cell *c, Node *n, Node *nb1 , Node *nb2, list<Node *>::iterator ins_pos);
   void InsertNode(Edge &e);
+  void SetDisplacementEnergy(void);
+  void BuildEdgeGrid(void);
+  // the wall segments have changed other than by a sweep, so
+  // SetDisplacementEnergy must rebuild edge_grid
+  inline void InvalidateEdgeGrid(void) { edge_grid.Clear(); }
+  double EdgeWallStrength(CellBase *c, Node *n1, Node *n2) const;
+  template<class RNG> void DisplaceNode(Node &node, RNG &rng, vector<Edge> &insertions, vector<DeltaIntgrl> &delta_intgrl_list, double &sum_dh);
+  template<bool Anisotropic2, bool Bending, class RNG> void DisplaceNode(Node &node, RNG &rng, vector<Edge> &insertions, vector<DeltaIntgrl> &delta_intgrl_list, double &sum_dh);
+  void ColorNodes(void);
+  void ColorWalls(void);
+  void DoCellHouseKeepingSerial(void);
+  void DerivativesSerial(double *derivs);
+  void DivideFlaggedCell(Cell &c);
+  template<class T> int CompactDead(vector<T *> &v);
+  void JacobianPattern(SparseJacobian &J, const vector<int> &key);
+  bool AnalyticJacobian(SparseJacobian &J);
   inline Node *AddNode(Node *n) {
     nodes.push_back(n);
     shuffled_nodes.push_back(n);
     n->m=this;
+    InvalidateEdgeGrid();
     return n;
   }
 
@@ -21,6 +21,7 @@
 
 #include <string>
 #include "modelcatalogue.h"
+#include "random.h"
 #include <QVariant>
 
 static const std::string _module_id("$Id$");
@@ -152,6 +153,8 @@ void ModelCatalogue::InstallModel(SimPluginInterface* plugin) {
   // make sure both main and plugin use the same static datamembers (ncells, nchems...)
   mesh->Clean();
   plugin->SetCellsStaticDatamembers(CellBase::GetStaticDataMemberPointer());
+  // and the local random streams of parallel housekeeping
+  plugin->SetLocalRandomStreams(CurrentLocalRandomStream);
 
   mesh->SetSimPlugin(plugin);
 
@@ -0,0 +1,145 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <string>
+#include "moments.h"
+
+#if defined(SIMD_MOMENTS) && defined(__AVX__)
+#include <immintrin.h>
+#elif defined(SIMD_MOMENTS) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const std::string _module_id("$Id$");
+
+// Add the moments of edges first ... n - 1 to m, one edge at a time
+static inline void AddEdgeMoments(const double *x, const double *y, int first, int n, PolygonMoments &m)
+{
+  for (int i = first; i < n; i++) {
+
+    double xi = x[i], yi = y[i], xj = x[i + 1], yj = y[i + 1];
+    double cross = xi * yj - xj * yi;
+
+    m.area += xi * yj;
+    m.area -= xj * yi;
+    m.xx += (xi * xi + xj * xi + xj * xj) * cross;
+    m.xy += (xj * yi - xi * yj) * (xi * (2 * yi + yj) + xj * (yi + 2 * yj));
+    m.yy += cross * (yi * yi + yj * yi + yj * yj);
+    m.x += (xj + xi) * cross;
+    m.y += (yj + yi) * cross;
+  }
+}
+
+#if defined(SIMD_MOMENTS) && defined(__AVX__)
+
+static inline double HorizontalSum(__m256d v)
+{
+  double s[4];
+  _mm256_storeu_pd(s, v);
+  return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+void CalcPolygonMoments(const double *x, const double *y, int n, PolygonMoments &m)
+{
+  __m256d area = _mm256_setzero_pd(), mx = _mm256_setzero_pd(), my = _mm256_setzero_pd();
+  __m256d mxx = _mm256_setzero_pd(), mxy = _mm256_setzero_pd(), myy = _mm256_setzero_pd();
+  const __m256d two = _mm256_set1_pd(2.);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+
+    __m256d xi = _mm256_loadu_pd(x + i), xj = _mm256_loadu_pd(x + i + 1);
+    __m256d yi = _mm256_loadu_pd(y + i), yj = _mm256_loadu_pd(y + i + 1);
+    __m256d cross = _mm256_sub_pd(_mm256_mul_pd(xi, yj), _mm256_mul_pd(xj, yi));
+
+    __m256d qx = _mm256_add_pd(_mm256_mul_pd(xi, _mm256_add_pd(xi, xj)), _mm256_mul_pd(xj, xj));
+    __m256d qy = _mm256_add_pd(_mm256_mul_pd(yi, _mm256_add_pd(yi, yj)), _mm256_mul_pd(yj, yj));
+    __m256d pxy = _mm256_add_pd(_mm256_mul_pd(xi, _mm256_add_pd(_mm256_mul_pd(two, yi), yj)),
+                                _mm256_mul_pd(xj, _mm256_add_pd(yi, _mm256_mul_pd(two, yj))));
+
+    area = _mm256_add_pd(area, cross);
+    mx = _mm256_add_pd(mx, _mm256_mul_pd(_mm256_add_pd(xi, xj), cross));
+    my = _mm256_add_pd(my, _mm256_mul_pd(_mm256_add_pd(yi, yj), cross));
+    mxx = _mm256_add_pd(mxx, _mm256_mul_pd(qx, cross));
+    mxy = _mm256_sub_pd(mxy, _mm256_mul_pd(pxy, cross));
+    myy = _mm256_add_pd(myy, _mm256_mul_pd(qy, cross));
+  }
+
+  m.area = HorizontalSum(area);
+  m.x = HorizontalSum(mx); m.y = HorizontalSum(my);
+  m.xx = HorizontalSum(mxx); m.xy = HorizontalSum(mxy); m.yy = HorizontalSum(myy);
+
+  AddEdgeMoments(x, y, i, n, m);
+}
+
+#elif defined(SIMD_MOMENTS) && defined(__SSE2__)
+
+static inline double HorizontalSum(__m128d v)
+{
+  double s[2];
+  _mm_storeu_pd(s, v);
+  return s[0] + s[1];
+}
+
+void CalcPolygonMoments(const double *x, const double *y, int n, PolygonMoments &m)
+{
+  __m128d area = _mm_setzero_pd(), mx = _mm_setzero_pd(), my = _mm_setzero_pd();
+  __m128d mxx = _mm_setzero_pd(), mxy = _mm_setzero_pd(), myy = _mm_setzero_pd();
+  const __m128d two = _mm_set1_pd(2.);
+
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+
+    __m128d xi = _mm_loadu_pd(x + i), xj = _mm_loadu_pd(x + i + 1);
+    __m128d yi = _mm_loadu_pd(y + i), yj = _mm_loadu_pd(y + i + 1);
+    __m128d cross = _mm_sub_pd(_mm_mul_pd(xi, yj), _mm_mul_pd(xj, yi));
+
+    __m128d qx = _mm_add_pd(_mm_mul_pd(xi, _mm_add_pd(xi, xj)), _mm_mul_pd(xj, xj));
+    __m128d qy = _mm_add_pd(_mm_mul_pd(yi, _mm_add_pd(yi, yj)), _mm_mul_pd(yj, yj));
+    __m128d pxy = _mm_add_pd(_mm_mul_pd(xi, _mm_add_pd(_mm_mul_pd(two, yi), yj)),
+                             _mm_mul_pd(xj, _mm_add_pd(yi, _mm_mul_pd(two, yj))));
+
+    area = _mm_add_pd(area, cross);
+    mx = _mm_add_pd(mx, _mm_mul_pd(_mm_add_pd(xi, xj), cross));
+    my = _mm_add_pd(my, _mm_mul_pd(_mm_add_pd(yi, yj), cross));
+    mxx = _mm_add_pd(mxx, _mm_mul_pd(qx, cross));
+    mxy = _mm_sub_pd(mxy, _mm_mul_pd(pxy, cross));
+    myy = _mm_add_pd(myy, _mm_mul_pd(qy, cross));
+  }
+
+  m.area = HorizontalSum(area);
+  m.x = HorizontalSum(mx); m.y = HorizontalSum(my);
+  m.xx = HorizontalSum(mxx); m.xy = HorizontalSum(mxy); m.yy = HorizontalSum(myy);
+
+  AddEdgeMoments(x, y, i, n, m);
+}
+
+#else
+
+void CalcPolygonMoments(const double *x, const double *y, int n, PolygonMoments &m)
+{
+  m.area = m.x = m.y = m.xx = m.xy = m.yy = 0.;
+  AddEdgeMoments(x, y, 0, n, m);
+}
+
+#endif
+
+/* finis */
@@ -0,0 +1,55 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _MOMENTS_H_
+#define _MOMENTS_H_
+
+/*! \brief Raw moments of a polygon, summed over its edges as in
+  CellBase::SetIntegrals.
+
+  "area" is twice the signed area; the other members are the unscaled
+  first and second moments (CellBase::Length shows how they are
+  normalised).
+*/
+struct PolygonMoments {
+  double area;
+  double x, y;
+  double xx, xy, yy;
+};
+
+/*! \brief Compute all moments of the polygon with the "n" vertices
+  (x[i], y[i]) in a single pass.
+
+  The arrays must hold n + 1 elements, the last repeating the first
+  vertex, so that edge i runs from vertex i to vertex i + 1. The sums
+  are in the same order, and give the same results, as the loops over
+  the node list that CellBase used to have. Builds with SIMD_MOMENTS
+  defined use AVX or SSE2 when the compiler targets them; these sum in
+  a different order, so that results differ in the last bits.
+*/
+void CalcPolygonMoments(const double *x, const double *y, int n, PolygonMoments &m);
+
+#endif
+
+/* finis */
@@ -127,7 +127,7 @@ ostream &Node::print(ostream &os) const {
 
   os << "Neighbors = { ";
 
-  for (list<Neighbor>::const_iterator i =  owners.begin(); i!=owners.end(); i++) {
+  for (NodeOwners::const_iterator i =  owners.begin(); i!=owners.end(); i++) {
     os << " {" << i->cell->Index() << " " << i->nb1->Index() << " " << i->nb2->Index() << "} ";
   }
   os << " } " << endl;
@@ -173,7 +173,7 @@ void Node::DrawOwners(QGraphicsScene *c) const {
 QVector<qreal> Node::NeighbourAngles(void)
 {
   QVector<qreal> angles;
-  for (list<Neighbor>::iterator i=owners.begin(); i!=owners.end(); i++) {
+  for (NodeOwners::iterator i=owners.begin(); i!=owners.end(); i++) {
     Vector v1 = (*this - *i->nb1).Normalised();
     Vector v2 = (*this - *i->nb2).Normalised();	
 
@@ -45,6 +45,11 @@
 #include <QVector>
 
 #include "Neighbor.h"
+#include "pool.h"
+#include "smallvector.h"
+
+// The cells owning a node; rarely more than four
+typedef SmallVector<Neighbor, 4> NodeOwners;
 
 extern Parameter par;
 
@@ -69,7 +74,7 @@ class Edge {
   }
 
   // Ambidextrous equivalence 
-  inline bool operator==(const Edge &e) {
+  inline bool operator==(const Edge &e) const {
     return ( (first==e.first && second==e.second) ||
 	     (first==e.second && second==e.first) );
   }
@@ -83,6 +88,7 @@ class Edge {
 
 
 class NodeSet;
+class LeafMLWriter;
 
 // this class is a node in a cell wall
 class Node : public Vector {
@@ -108,6 +114,10 @@ class Node : public Vector {
 
   virtual ~Node() {}
 
+  // nodes are allocated from the object pools
+  static void *operator new(size_t size) { return ObjectPools().Allocate(size); }
+  static void operator delete(void *p) { PoolSet::Free(p); }
+
   inline int Index(void) const { return index; }
 
   inline bool IndexEquals(int i) { return i == index; }
@@ -128,7 +138,7 @@ class Node : public Vector {
   Cell &getCell(const Neighbor &i);
 
   ostream &print(ostream &os) const;
-  void XMLAdd(xmlNodePtr nodes_node) const;
+  void XMLAdd(LeafMLWriter &writer) const;
 
 #ifdef QTGRAPHICS
   void Draw(QGraphicsScene &c, QColor color=QColor("black"), int size = 10) const;
@@ -172,7 +182,7 @@ class Node : public Vector {
 
   // "owners" lists the cells to which this cell belong
   // and the two neighboring nodes relative to each cell
-  list< Neighbor > owners;
+  NodeOwners owners;
 
   Mesh *m;
   int index;
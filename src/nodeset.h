@@ -31,6 +31,7 @@
 #include <iterator>
 #include <functional>
 #include "node.h"
+#include "random.h"
 
 class NodeSet : public list<Node *> {
 
@@ -87,6 +88,12 @@ class NodeSet : public list<Node *> {
   */
 
   void AttemptMove(double rx, double ry) {
+    GlobalRandom rng;
+    AttemptMove(rx, ry, rng);
+  }
+
+  //! As AttemptMove, drawing the acceptance test from "rng"
+  template<class RNG> void AttemptMove(double rx, double ry, RNG &rng) {
 
     done = true;
     // 1. Collect list of all attached to the nodes in the set
@@ -129,7 +136,7 @@ class NodeSet : public list<Node *> {
     list<int> new_areas;
 
     // cerr << "Nodeset says: dh = " << dh << " ...";
-    if (dh < -sum_stiff || RANDOM()<exp((-dh - sum_stiff)/par.T) ) {
+    if (dh < -sum_stiff || rng.Uniform()<exp((-dh - sum_stiff)/par.T) ) {
 
       // ACCEPT
       // recalculate areas of cells
@@ -153,7 +160,7 @@ class NodeSet : public list<Node *> {
     }
   }
 
-  void XMLAdd(xmlNode *root) const;
+  void XMLAdd(LeafMLWriter &writer) const;
   void XMLRead(xmlNode *root, Mesh *m);
  private:
   bool done;
@@ -0,0 +1,65 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <string>
+#include "nodestore.h"
+#include "node.h"
+#include "cell.h"
+
+static const std::string _module_id("$Id$");
+
+void NodeStore::Clear(void)
+{
+  x.clear(); y.clear();
+  ring_start.clear(); ring.clear();
+}
+
+/*! Copy the coordinates of "nodes" (which must be ordered by node
+  index), and the node rings of "cells" (which must be ordered by cell
+  index) and of the boundary polygon.
+*/
+void NodeStore::Build(const vector<Node *> &nodes, const vector<Cell *> &cells, const Cell *boundary_polygon)
+{
+  Clear();
+
+  const int ncells = cells.size();
+
+  ring_start.reserve(ncells + 2);
+  for (int c = 0; c <= ncells; c++) {
+    const Cell *cell = c < ncells ? cells[c] : boundary_polygon;
+    ring_start.push_back(ring.size());
+    if (!cell) continue;
+    for (list<Node *>::const_iterator n = cell->nodes.begin(); n != cell->nodes.end(); n++) {
+      ring.push_back((*n)->Index());
+    }
+  }
+  ring_start.push_back(ring.size());
+
+  const int n = nodes.size();
+  x.resize(n);
+  y.resize(n);
+  for (int i = 0; i < n; i++) {
+    x[i] = nodes[i]->x;
+    y[i] = nodes[i]->y;
+  }
+}
+
+/* finis */
@@ -0,0 +1,68 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _NODESTORE_H_
+#define _NODESTORE_H_
+
+#include <vector>
+
+using namespace std;
+
+class Node;
+class Cell;
+
+/*! \brief Structure-of-arrays copy of the node coordinates and of the
+  cells' node rings, for geometry kernels that loop over the whole mesh
+  (see Mesh::SetCellIntegrals).
+
+  The Node objects remain the authoritative data; the store is a
+  snapshot, filled by Build, and is only valid until the nodes move or
+  the mesh changes.
+
+  Cells are numbered by their index; the boundary polygon, if any, is
+  cell number NCells().
+*/
+class NodeStore {
+
+ public:
+  NodeStore(void) {}
+
+  void Build(const vector<Node *> &nodes, const vector<Cell *> &cells, const Cell *boundary_polygon = 0);
+  void Clear(void);
+
+  inline int NNodes(void) const { return x.size(); }
+  inline int NCells(void) const { return ring_start.empty() ? 0 : ring_start.size() - 2; }
+  inline bool EmptyP(void) const { return x.empty(); }
+
+  // coordinates, by node index
+  vector<double> x, y;
+
+  // node rings: the nodes of cell c, in the order of its node list, are
+  // ring[ring_start[c]] ... ring[ring_start[c+1] - 1]
+  vector<int> ring_start, ring;
+};
+
+#endif
+
+/* finis */
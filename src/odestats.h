@@ -0,0 +1,61 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#ifndef _ODESTATS_H_
+#define _ODESTATS_H_
+
+#include <ostream>
+
+// Work counters of an ODE integrator, accumulated over calls to odeint
+struct ODEStats {
+
+  ODEStats(void) { Reset(); }
+
+  void Reset(void) {
+    steps=rejected=fevals=jvprods=jacobians=lin_iters=lin_failures=0;
+    wall_time=0.;
+  }
+
+  long steps; // accepted steps
+  long rejected; // rejected step attempts
+  long fevals; // right-hand side evaluations, including those for Jacobian products
+  long jvprods; // Jacobian-vector products (implicit solvers only)
+  long jacobians; // Jacobians for the preconditioner (implicit solvers only)
+  long lin_iters; // Krylov iterations (implicit solvers only)
+  long lin_failures; // linear solves that did not converge (implicit solvers only)
+  double wall_time; // seconds, if the caller keeps track
+};
+
+inline std::ostream &operator<<(std::ostream &os, const ODEStats &s)
+{
+  os << "steps = " << s.steps << ", rejected = " << s.rejected
+     << ", fevals = " << s.fevals << ", jvprods = " << s.jvprods
+     << ", jacobians = " << s.jacobians
+     << ", lin_iters = " << s.lin_iters << ", lin_failures = " << s.lin_failures
+     << ", wall_time = " << s.wall_time << " s";
+  return os;
+}
+
+#endif
+
+/* finis */
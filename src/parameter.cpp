@@ -55,6 +55,8 @@ Parameter::Parameter() {
   export_fn_prefix = strdup("cell.");
   storage_stride = 10;
   xml_storage_stride = 500;
+  trajectory_stride = 0;
+  checkpoint_stride = 0;
   datadir = strdup(".");
   datadir = AppendHomeDirIfPathRelative(datadir);
   T = 1.0;
@@ -66,8 +68,14 @@ Parameter::Parameter() {
   cell_div_expansion_rate = 0.;
   auxin_dependent_growth = true;
   ode_accuracy = 1e-4;
+  ode_threads = 0;
+  ode_solver = strdup("rungekutta");
+  ode_stats = false;
+  housekeeping_threads = 0;
   mc_stepsize = 0.4;
   mc_cell_stepsize = 0.2;
+  mc_threads = 0;
+  mc_check_intersections = false;
   energy_threshold = 1000.;
   bend_lambda = 0.;
   alignment_lambda = 0.;
@@ -145,6 +153,7 @@ Parameter::Parameter() {
   nit = 100000;
   maxt = 1000.;
   rseed = -1;
+  random_generator = strdup("knuth");
   constituous_expansion_limit = 16;
   vessel_inh_level = 1;
   vessel_expansion_rate = 0.25;
@@ -230,6 +239,10 @@ void Parameter::CleanUp(void) {
   if (model_choice)
     free(model_choice);
 
+  if (ode_solver)
+    free(ode_solver);
+  if (random_generator)
+    free(random_generator);
 }
 
 void Parameter::Read(const char* filename) {
@@ -261,6 +274,8 @@ void Parameter::Read(const char* filename) {
   export_fn_prefix = sgetpar(fp, "export_fn_prefix", "cell.", true);
   storage_stride = igetpar(fp, "storage_stride", 10, true);
   xml_storage_stride = igetpar(fp, "xml_storage_stride", 500, true);
+  trajectory_stride = igetpar(fp, "trajectory_stride", 0, true);
+  checkpoint_stride = igetpar(fp, "checkpoint_stride", 0, true);
   datadir = sgetpar(fp, "datadir", ".", true);
   datadir = AppendHomeDirIfPathRelative(datadir);
   if (strcmp(datadir, "."))
@@ -274,8 +289,14 @@ void Parameter::Read(const char* filename) {
   cell_div_expansion_rate = fgetpar(fp, "cell_div_expansion_rate", 0., true);
   auxin_dependent_growth = bgetpar(fp, "auxin_dependent_growth", true, true);
   ode_accuracy = fgetpar(fp, "ode_accuracy", 1e-4, true);
+  ode_threads = igetpar(fp, "ode_threads", 0, true);
+  ode_solver = sgetpar(fp, "ode_solver", "rungekutta", true);
+  ode_stats = bgetpar(fp, "ode_stats", false, true);
+  housekeeping_threads = igetpar(fp, "housekeeping_threads", 0, true);
   mc_stepsize = fgetpar(fp, "mc_stepsize", 0.4, true);
   mc_cell_stepsize = fgetpar(fp, "mc_cell_stepsize", 0.2, true);
+  mc_threads = igetpar(fp, "mc_threads", 0, true);
+  mc_check_intersections = bgetpar(fp, "mc_check_intersections", false, true);
   energy_threshold = fgetpar(fp, "energy_threshold", 1000., true);
   bend_lambda = fgetpar(fp, "bend_lambda", 0., true);
   alignment_lambda = fgetpar(fp, "alignment_lambda", 0., true);
@@ -323,6 +344,7 @@ void Parameter::Read(const char* filename) {
   nit = igetpar(fp, "nit", 100000, true);
   maxt = fgetpar(fp, "maxt", 1000., true);
   rseed = igetpar(fp, "rseed", -1, true);
+  random_generator = sgetpar(fp, "random_generator", "knuth", true);
   constituous_expansion_limit = igetpar(fp, "constituous_expansion_limit", 16, true);
   vessel_inh_level = fgetpar(fp, "vessel_inh_level", 1, true);
   vessel_expansion_rate = fgetpar(fp, "vessel_expansion_rate", 0.25, true);
@@ -395,6 +417,8 @@ void Parameter::Write(ostream& os) const {
     os << " export_fn_prefix = " << export_fn_prefix << endl;
   os << " storage_stride = " << storage_stride << endl;
   os << " xml_storage_stride = " << xml_storage_stride << endl;
+  os << " trajectory_stride = " << trajectory_stride << endl;
+  os << " checkpoint_stride = " << checkpoint_stride << endl;
   if (datadir) {
     QDir dataDir = QDir::home().relativeFilePath(datadir);
     os << " datadir = " << dataDir.dirName().toStdString().c_str() << endl;
@@ -411,8 +435,15 @@ void Parameter::Write(ostream& os) const {
   os << " cell_div_expansion_rate = " << cell_div_expansion_rate << endl;
   os << " auxin_dependent_growth = " << sbool(auxin_dependent_growth) << endl;
   os << " ode_accuracy = " << ode_accuracy << endl;
+  os << " ode_threads = " << ode_threads << endl;
+  if (ode_solver)
+    os << " ode_solver = " << ode_solver << endl;
+  os << " ode_stats = " << sbool(ode_stats) << endl;
+  os << " housekeeping_threads = " << housekeeping_threads << endl;
   os << " mc_stepsize = " << mc_stepsize << endl;
   os << " mc_cell_stepsize = " << mc_cell_stepsize << endl;
+  os << " mc_threads = " << mc_threads << endl;
+  os << " mc_check_intersections = " << sbool(mc_check_intersections) << endl;
   os << " energy_threshold = " << energy_threshold << endl;
   os << " bend_lambda = " << bend_lambda << endl;
   os << " alignment_lambda = " << alignment_lambda << endl;
@@ -460,6 +491,8 @@ void Parameter::Write(ostream& os) const {
   os << " nit = " << nit << endl;
   os << " maxt = " << maxt << endl;
   os << " rseed = " << rseed << endl;
+  if (random_generator)
+    os << " random_generator = " << random_generator << endl;
   os << " constituous_expansion_limit = " << constituous_expansion_limit << endl;
   os << " vessel_inh_level = " << vessel_inh_level << endl;
   os << " vessel_expansion_rate = " << vessel_expansion_rate << endl;
@@ -602,6 +635,20 @@ void Parameter::XMLAdd(xmlNode* root) const {
     text << xml_storage_stride;
     xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
   }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "trajectory_stride");
+    ostringstream text;
+    text << trajectory_stride;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "checkpoint_stride");
+    ostringstream text;
+    text << checkpoint_stride;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
   {
     xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
     xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "datadir");
@@ -676,6 +723,36 @@ void Parameter::XMLAdd(xmlNode* root) const {
     text << ode_accuracy;
     xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
   }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "ode_threads");
+    ostringstream text;
+    text << ode_threads;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "ode_solver");
+    ostringstream text;
+
+    if (ode_solver)
+      text << ode_solver;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "ode_stats");
+    ostringstream text;
+    text << sbool(ode_stats);
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "housekeeping_threads");
+    ostringstream text;
+    text << housekeeping_threads;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
   {
     xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
     xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "mc_stepsize");
@@ -690,6 +767,20 @@ void Parameter::XMLAdd(xmlNode* root) const {
     text << mc_cell_stepsize;
     xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
   }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "mc_threads");
+    ostringstream text;
+    text << mc_threads;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "mc_check_intersections");
+    ostringstream text;
+    text << sbool(mc_check_intersections);
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
   {
     xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
     xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "energy_threshold");
@@ -1195,6 +1286,15 @@ void Parameter::XMLAdd(xmlNode* root) const {
     text << rseed;
     xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
   }
+  {
+    xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
+    xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "random_generator");
+    ostringstream text;
+
+    if (random_generator)
+      text << random_generator;
+    xmlNewProp(xmlpar, BAD_CAST "val", BAD_CAST text.str().c_str());
+  }
   {
     xmlNode* xmlpar = xmlNewChild(xmlparameter, NULL, BAD_CAST "par", NULL);
     xmlNewProp(xmlpar, BAD_CAST "name", BAD_CAST "constituous_expansion_limit");
@@ -1552,6 +1652,14 @@ void Parameter::AssignValToPar(const char* namec, const char* valc) {
     xml_storage_stride = standardlocale.toInt(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'xml_storage_stride' from XML file.", valc); }
   }
+  if (!strcmp(namec, "trajectory_stride")) {
+    trajectory_stride = standardlocale.toInt(valc, &ok);
+    if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'trajectory_stride' from XML file.", valc); }
+  }
+  if (!strcmp(namec, "checkpoint_stride")) {
+    checkpoint_stride = standardlocale.toInt(valc, &ok);
+    if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'checkpoint_stride' from XML file.", valc); }
+  }
   if (!strcmp(namec, "datadir")) {
     if (datadir) { free(datadir); }
     datadir = strdup(valc);
@@ -1592,6 +1700,21 @@ void Parameter::AssignValToPar(const char* namec, const char* valc) {
     ode_accuracy = standardlocale.toDouble(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to double while reading parameter 'ode_accuracy' from XML file.", valc); }
   }
+  if (!strcmp(namec, "ode_threads")) {
+    ode_threads = standardlocale.toInt(valc, &ok);
+    if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'ode_threads' from XML file.", valc); }
+  }
+  if (!strcmp(namec, "ode_solver")) {
+    if (ode_solver) { free(ode_solver); }
+    ode_solver = strdup(valc);
+  }
+  if (!strcmp(namec, "ode_stats")) {
+    ode_stats = strtobool(valc);
+  }
+  if (!strcmp(namec, "housekeeping_threads")) {
+    housekeeping_threads = standardlocale.toInt(valc, &ok);
+    if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'housekeeping_threads' from XML file.", valc); }
+  }
   if (!strcmp(namec, "mc_stepsize")) {
     mc_stepsize = standardlocale.toDouble(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to double while reading parameter 'mc_stepsize' from XML file.", valc); }
@@ -1600,6 +1723,13 @@ void Parameter::AssignValToPar(const char* namec, const char* valc) {
     mc_cell_stepsize = standardlocale.toDouble(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to double while reading parameter 'mc_cell_stepsize' from XML file.", valc); }
   }
+  if (!strcmp(namec, "mc_threads")) {
+    mc_threads = standardlocale.toInt(valc, &ok);
+    if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'mc_threads' from XML file.", valc); }
+  }
+  if (!strcmp(namec, "mc_check_intersections")) {
+    mc_check_intersections = strtobool(valc);
+  }
   if (!strcmp(namec, "energy_threshold")) {
     energy_threshold = standardlocale.toDouble(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to double while reading parameter 'energy_threshold' from XML file.", valc); }
@@ -1778,6 +1908,10 @@ void Parameter::AssignValToPar(const char* namec, const char* valc) {
     rseed = standardlocale.toInt(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'rseed' from XML file.", valc); }
   }
+  if (!strcmp(namec, "random_generator")) {
+    if (random_generator) { free(random_generator); }
+    random_generator = strdup(valc);
+  }
   if (!strcmp(namec, "constituous_expansion_limit")) {
     constituous_expansion_limit = standardlocale.toInt(valc, &ok);
     if (!ok) { MyWarning::error("Read error: cannot convert string \"%s\" to integer while reading parameter 'constituous_expansion_limit' from XML file.", valc); }
@@ -57,6 +57,8 @@ public:
   char * export_fn_prefix;
   int storage_stride;
   int xml_storage_stride;
+  int trajectory_stride;
+  int checkpoint_stride;
   char * datadir;
   double T;
   double lambda_length;
@@ -67,8 +69,14 @@ public:
   double cell_div_expansion_rate;
   bool auxin_dependent_growth;
   double ode_accuracy;
+  int ode_threads;
+  char * ode_solver;
+  bool ode_stats;
+  int housekeeping_threads;
   double mc_stepsize;
   double mc_cell_stepsize;
+  int mc_threads;
+  bool mc_check_intersections;
   double energy_threshold;
   double bend_lambda;
   double alignment_lambda;
@@ -116,6 +124,7 @@ public:
   int nit;
   double maxt;
   int rseed;
+  char * random_generator;
   int constituous_expansion_limit;
   double vessel_inh_level;
   double vessel_expansion_rate;
@@ -47,6 +47,8 @@ ParameterDialog::ParameterDialog(QWidget *parent, const char *name, Qt::WindowFl
   export_fn_prefix_edit = new QLineEdit( QString("%1").arg(par.export_fn_prefix), this, "export_fn_prefix_edit" );
   storage_stride_edit = new QLineEdit( QString("%1").arg(par.storage_stride), this, "storage_stride_edit" );
   xml_storage_stride_edit = new QLineEdit( QString("%1").arg(par.xml_storage_stride), this, "xml_storage_stride_edit" );
+  trajectory_stride_edit = new QLineEdit( QString("%1").arg(par.trajectory_stride), this, "trajectory_stride_edit" );
+  checkpoint_stride_edit = new QLineEdit( QString("%1").arg(par.checkpoint_stride), this, "checkpoint_stride_edit" );
   datadir_edit = new QLineEdit( QString("%1").arg(par.datadir), this, "datadir_edit" );
   T_edit = new QLineEdit( QString("%1").arg(par.T), this, "T_edit" );
   lambda_length_edit = new QLineEdit( QString("%1").arg(par.lambda_length), this, "lambda_length_edit" );
@@ -57,8 +59,14 @@ ParameterDialog::ParameterDialog(QWidget *parent, const char *name, Qt::WindowFl
   cell_div_expansion_rate_edit = new QLineEdit( QString("%1").arg(par.cell_div_expansion_rate), this, "cell_div_expansion_rate_edit" );
   auxin_dependent_growth_edit = new QLineEdit( QString("%1").arg(sbool(par.auxin_dependent_growth)), this, "auxin_dependent_growth_edit" );
   ode_accuracy_edit = new QLineEdit( QString("%1").arg(par.ode_accuracy), this, "ode_accuracy_edit" );
+  ode_threads_edit = new QLineEdit( QString("%1").arg(par.ode_threads), this, "ode_threads_edit" );
+  ode_solver_edit = new QLineEdit( QString("%1").arg(par.ode_solver), this, "ode_solver_edit" );
+  ode_stats_edit = new QLineEdit( QString("%1").arg(sbool(par.ode_stats)), this, "ode_stats_edit" );
+  housekeeping_threads_edit = new QLineEdit( QString("%1").arg(par.housekeeping_threads), this, "housekeeping_threads_edit" );
   mc_stepsize_edit = new QLineEdit( QString("%1").arg(par.mc_stepsize), this, "mc_stepsize_edit" );
   mc_cell_stepsize_edit = new QLineEdit( QString("%1").arg(par.mc_cell_stepsize), this, "mc_cell_stepsize_edit" );
+  mc_threads_edit = new QLineEdit( QString("%1").arg(par.mc_threads), this, "mc_threads_edit" );
+  mc_check_intersections_edit = new QLineEdit( QString("%1").arg(sbool(par.mc_check_intersections)), this, "mc_check_intersections_edit" );
   energy_threshold_edit = new QLineEdit( QString("%1").arg(par.energy_threshold), this, "energy_threshold_edit" );
   bend_lambda_edit = new QLineEdit( QString("%1").arg(par.bend_lambda), this, "bend_lambda_edit" );
   alignment_lambda_edit = new QLineEdit( QString("%1").arg(par.alignment_lambda), this, "alignment_lambda_edit" );
@@ -110,6 +118,7 @@ ParameterDialog::ParameterDialog(QWidget *parent, const char *name, Qt::WindowFl
   nit_edit = new QLineEdit( QString("%1").arg(par.nit), this, "nit_edit" );
   maxt_edit = new QLineEdit( QString("%1").arg(par.maxt), this, "maxt_edit" );
   rseed_edit = new QLineEdit( QString("%1").arg(par.rseed), this, "rseed_edit" );
+  random_generator_edit = new QLineEdit( QString("%1").arg(par.random_generator), this, "random_generator_edit" );
   constituous_expansion_limit_edit = new QLineEdit( QString("%1").arg(par.constituous_expansion_limit), this, "constituous_expansion_limit_edit" );
   vessel_inh_level_edit = new QLineEdit( QString("%1").arg(par.vessel_inh_level), this, "vessel_inh_level_edit" );
   vessel_expansion_rate_edit = new QLineEdit( QString("%1").arg(par.vessel_expansion_rate), this, "vessel_expansion_rate_edit" );
@@ -177,200 +186,218 @@ QGridLayout *grid = new QGridLayout( this, 1, 1 );
   grid->addWidget( storage_stride_edit, 17, 0+1  );
   grid->addWidget( new QLabel( "xml_storage_stride", this ),18, 0 );
   grid->addWidget( xml_storage_stride_edit, 18, 0+1  );
-  grid->addWidget( new QLabel( "datadir", this ),19, 0 );
-  grid->addWidget( datadir_edit, 19, 0+1  );
-  grid->addWidget( new QLabel( "", this), 20, 0, 1, 2 );
-  grid->addWidget( new QLabel( " <b>Cell mechanics</b>", this), 21, 0, 1, 2 );
-  grid->addWidget( new QLabel( "T", this ),22, 0 );
-  grid->addWidget( T_edit, 22, 0+1  );
-  grid->addWidget( new QLabel( "lambda_length", this ),23, 0 );
-  grid->addWidget( lambda_length_edit, 23, 0+1  );
-  grid->addWidget( new QLabel( "yielding_threshold", this ),24, 0 );
-  grid->addWidget( yielding_threshold_edit, 24, 0+1  );
-  grid->addWidget( new QLabel( "lambda_celllength", this ),25, 0 );
-  grid->addWidget( lambda_celllength_edit, 25, 0+1  );
-  grid->addWidget( new QLabel( "target_length", this ),26, 0 );
-  grid->addWidget( target_length_edit, 26, 0+1  );
-  grid->addWidget( new QLabel( "cell_expansion_rate", this ),27, 0 );
-  grid->addWidget( cell_expansion_rate_edit, 27, 0+1  );
-  grid->addWidget( new QLabel( "cell_div_expansion_rate", this ),28, 0 );
-  grid->addWidget( cell_div_expansion_rate_edit, 28, 0+1  );
-  grid->addWidget( new QLabel( "auxin_dependent_growth", this ),29, 0 );
-  grid->addWidget( auxin_dependent_growth_edit, 29, 0+1  );
-  grid->addWidget( new QLabel( "ode_accuracy", this ),3, 2 );
-  grid->addWidget( ode_accuracy_edit, 3, 2+1  );
-  grid->addWidget( new QLabel( "mc_stepsize", this ),4, 2 );
-  grid->addWidget( mc_stepsize_edit, 4, 2+1  );
-  grid->addWidget( new QLabel( "mc_cell_stepsize", this ),5, 2 );
-  grid->addWidget( mc_cell_stepsize_edit, 5, 2+1  );
-  grid->addWidget( new QLabel( "energy_threshold", this ),6, 2 );
-  grid->addWidget( energy_threshold_edit, 6, 2+1  );
-  grid->addWidget( new QLabel( "bend_lambda", this ),7, 2 );
-  grid->addWidget( bend_lambda_edit, 7, 2+1  );
-  grid->addWidget( new QLabel( "alignment_lambda", this ),8, 2 );
-  grid->addWidget( alignment_lambda_edit, 8, 2+1  );
-  grid->addWidget( new QLabel( "rel_cell_div_threshold", this ),9, 2 );
-  grid->addWidget( rel_cell_div_threshold_edit, 9, 2+1  );
-  grid->addWidget( new QLabel( "rel_perimeter_stiffness", this ),10, 2 );
-  grid->addWidget( rel_perimeter_stiffness_edit, 10, 2+1  );
-  grid->addWidget( new QLabel( "collapse_node_threshold", this ),11, 2 );
-  grid->addWidget( collapse_node_threshold_edit, 11, 2+1  );
-  grid->addWidget( new QLabel( "morphogen_div_threshold", this ),12, 2 );
-  grid->addWidget( morphogen_div_threshold_edit, 12, 2+1  );
-  grid->addWidget( new QLabel( "morphogen_expansion_threshold", this ),13, 2 );
-  grid->addWidget( morphogen_expansion_threshold_edit, 13, 2+1  );
-  grid->addWidget( new QLabel( "copy_wall", this ),14, 2 );
-  grid->addWidget( copy_wall_edit, 14, 2+1  );
-  grid->addWidget( new QLabel( "", this), 15, 2, 1, 2 );
-  grid->addWidget( new QLabel( " <b>Auxin transport and PIN1 dynamics</b>", this), 16, 2, 1, 2 );
-  grid->addWidget( new QLabel( "source", this ),17, 2 );
-  grid->addWidget( source_edit, 17, 2+1  );
-  grid->addWidget( new QLabel( "D", this ),18, 2 );
-  grid->addWidget( D_edit, 18, 2+1  );
-  grid->addWidget( new QLabel( "initval", this ),19, 2 );
-  grid->addWidget( initval_edit, 19, 2+1  );
-  grid->addWidget( new QLabel( "k1", this ),20, 2 );
-  grid->addWidget( k1_edit, 20, 2+1  );
-  grid->addWidget( new QLabel( "k2", this ),21, 2 );
-  grid->addWidget( k2_edit, 21, 2+1  );
-  grid->addWidget( new QLabel( "r", this ),22, 2 );
-  grid->addWidget( r_edit, 22, 2+1  );
-  grid->addWidget( new QLabel( "kr", this ),23, 2 );
-  grid->addWidget( kr_edit, 23, 2+1  );
-  grid->addWidget( new QLabel( "km", this ),24, 2 );
-  grid->addWidget( km_edit, 24, 2+1  );
-  grid->addWidget( new QLabel( "Pi_tot", this ),25, 2 );
-  grid->addWidget( Pi_tot_edit, 25, 2+1  );
-  grid->addWidget( new QLabel( "transport", this ),26, 2 );
-  grid->addWidget( transport_edit, 26, 2+1  );
-  grid->addWidget( new QLabel( "ka", this ),27, 2 );
-  grid->addWidget( ka_edit, 27, 2+1  );
-  grid->addWidget( new QLabel( "pin_prod", this ),28, 2 );
-  grid->addWidget( pin_prod_edit, 28, 2+1  );
-  grid->addWidget( new QLabel( "pin_prod_in_epidermis", this ),29, 2 );
-  grid->addWidget( pin_prod_in_epidermis_edit, 29, 2+1  );
-  grid->addWidget( new QLabel( "pin_breakdown", this ),3, 4 );
-  grid->addWidget( pin_breakdown_edit, 3, 4+1  );
-  grid->addWidget( new QLabel( "pin_breakdown_internal", this ),4, 4 );
-  grid->addWidget( pin_breakdown_internal_edit, 4, 4+1  );
-  grid->addWidget( new QLabel( "aux1prod", this ),5, 4 );
-  grid->addWidget( aux1prod_edit, 5, 4+1  );
-  grid->addWidget( new QLabel( "aux1prodmeso", this ),6, 4 );
-  grid->addWidget( aux1prodmeso_edit, 6, 4+1  );
-  grid->addWidget( new QLabel( "aux1decay", this ),7, 4 );
-  grid->addWidget( aux1decay_edit, 7, 4+1  );
-  grid->addWidget( new QLabel( "aux1decaymeso", this ),8, 4 );
-  grid->addWidget( aux1decaymeso_edit, 8, 4+1  );
-  grid->addWidget( new QLabel( "aux1transport", this ),9, 4 );
-  grid->addWidget( aux1transport_edit, 9, 4+1  );
-  grid->addWidget( new QLabel( "aux_cons", this ),10, 4 );
-  grid->addWidget( aux_cons_edit, 10, 4+1  );
-  grid->addWidget( new QLabel( "aux_breakdown", this ),11, 4 );
-  grid->addWidget( aux_breakdown_edit, 11, 4+1  );
-  grid->addWidget( new QLabel( "kaux1", this ),12, 4 );
-  grid->addWidget( kaux1_edit, 12, 4+1  );
-  grid->addWidget( new QLabel( "kap", this ),13, 4 );
-  grid->addWidget( kap_edit, 13, 4+1  );
-  grid->addWidget( new QLabel( "leaf_tip_source", this ),14, 4 );
-  grid->addWidget( leaf_tip_source_edit, 14, 4+1  );
-  grid->addWidget( new QLabel( "sam_efflux", this ),15, 4 );
-  grid->addWidget( sam_efflux_edit, 15, 4+1  );
-  grid->addWidget( new QLabel( "sam_auxin", this ),16, 4 );
-  grid->addWidget( sam_auxin_edit, 16, 4+1  );
-  grid->addWidget( new QLabel( "sam_auxin_breakdown", this ),17, 4 );
-  grid->addWidget( sam_auxin_breakdown_edit, 17, 4+1  );
-  grid->addWidget( new QLabel( "van3prod", this ),18, 4 );
-  grid->addWidget( van3prod_edit, 18, 4+1  );
-  grid->addWidget( new QLabel( "van3autokat", this ),19, 4 );
-  grid->addWidget( van3autokat_edit, 19, 4+1  );
-  grid->addWidget( new QLabel( "van3sat", this ),20, 4 );
-  grid->addWidget( van3sat_edit, 20, 4+1  );
-  grid->addWidget( new QLabel( "k2van3", this ),21, 4 );
-  grid->addWidget( k2van3_edit, 21, 4+1  );
-  grid->addWidget( new QLabel( "", this), 22, 4, 1, 2 );
-  grid->addWidget( new QLabel( " <b>Integration parameters</b>", this), 23, 4, 1, 2 );
-  grid->addWidget( new QLabel( "dt", this ),24, 4 );
-  grid->addWidget( dt_edit, 24, 4+1  );
-  grid->addWidget( new QLabel( "rd_dt", this ),25, 4 );
-  grid->addWidget( rd_dt_edit, 25, 4+1  );
-  grid->addWidget( new QLabel( "movie", this ),26, 4 );
-  grid->addWidget( movie_edit, 26, 4+1  );
-  grid->addWidget( new QLabel( "nit", this ),27, 4 );
-  grid->addWidget( nit_edit, 27, 4+1  );
-  grid->addWidget( new QLabel( "maxt", this ),28, 4 );
-  grid->addWidget( maxt_edit, 28, 4+1  );
-  grid->addWidget( new QLabel( "rseed", this ),29, 4 );
-  grid->addWidget( rseed_edit, 29, 4+1  );
+  grid->addWidget( new QLabel( "trajectory_stride", this ),19, 0 );
+  grid->addWidget( trajectory_stride_edit, 19, 0+1  );
+  grid->addWidget( new QLabel( "checkpoint_stride", this ),20, 0 );
+  grid->addWidget( checkpoint_stride_edit, 20, 0+1  );
+  grid->addWidget( new QLabel( "datadir", this ),21, 0 );
+  grid->addWidget( datadir_edit, 21, 0+1  );
+  grid->addWidget( new QLabel( "", this), 22, 0, 1, 2 );
+  grid->addWidget( new QLabel( " <b>Cell mechanics</b>", this), 23, 0, 1, 2 );
+  grid->addWidget( new QLabel( "T", this ),24, 0 );
+  grid->addWidget( T_edit, 24, 0+1  );
+  grid->addWidget( new QLabel( "lambda_length", this ),25, 0 );
+  grid->addWidget( lambda_length_edit, 25, 0+1  );
+  grid->addWidget( new QLabel( "yielding_threshold", this ),26, 0 );
+  grid->addWidget( yielding_threshold_edit, 26, 0+1  );
+  grid->addWidget( new QLabel( "lambda_celllength", this ),27, 0 );
+  grid->addWidget( lambda_celllength_edit, 27, 0+1  );
+  grid->addWidget( new QLabel( "target_length", this ),28, 0 );
+  grid->addWidget( target_length_edit, 28, 0+1  );
+  grid->addWidget( new QLabel( "cell_expansion_rate", this ),29, 0 );
+  grid->addWidget( cell_expansion_rate_edit, 29, 0+1  );
+  grid->addWidget( new QLabel( "cell_div_expansion_rate", this ),3, 2 );
+  grid->addWidget( cell_div_expansion_rate_edit, 3, 2+1  );
+  grid->addWidget( new QLabel( "auxin_dependent_growth", this ),4, 2 );
+  grid->addWidget( auxin_dependent_growth_edit, 4, 2+1  );
+  grid->addWidget( new QLabel( "ode_accuracy", this ),5, 2 );
+  grid->addWidget( ode_accuracy_edit, 5, 2+1  );
+  grid->addWidget( new QLabel( "ode_threads", this ),6, 2 );
+  grid->addWidget( ode_threads_edit, 6, 2+1  );
+  grid->addWidget( new QLabel( "ode_solver", this ),7, 2 );
+  grid->addWidget( ode_solver_edit, 7, 2+1  );
+  grid->addWidget( new QLabel( "ode_stats", this ),8, 2 );
+  grid->addWidget( ode_stats_edit, 8, 2+1  );
+  grid->addWidget( new QLabel( "housekeeping_threads", this ),9, 2 );
+  grid->addWidget( housekeeping_threads_edit, 9, 2+1  );
+  grid->addWidget( new QLabel( "mc_stepsize", this ),10, 2 );
+  grid->addWidget( mc_stepsize_edit, 10, 2+1  );
+  grid->addWidget( new QLabel( "mc_cell_stepsize", this ),11, 2 );
+  grid->addWidget( mc_cell_stepsize_edit, 11, 2+1  );
+  grid->addWidget( new QLabel( "mc_threads", this ),12, 2 );
+  grid->addWidget( mc_threads_edit, 12, 2+1  );
+  grid->addWidget( new QLabel( "mc_check_intersections", this ),13, 2 );
+  grid->addWidget( mc_check_intersections_edit, 13, 2+1  );
+  grid->addWidget( new QLabel( "energy_threshold", this ),14, 2 );
+  grid->addWidget( energy_threshold_edit, 14, 2+1  );
+  grid->addWidget( new QLabel( "bend_lambda", this ),15, 2 );
+  grid->addWidget( bend_lambda_edit, 15, 2+1  );
+  grid->addWidget( new QLabel( "alignment_lambda", this ),16, 2 );
+  grid->addWidget( alignment_lambda_edit, 16, 2+1  );
+  grid->addWidget( new QLabel( "rel_cell_div_threshold", this ),17, 2 );
+  grid->addWidget( rel_cell_div_threshold_edit, 17, 2+1  );
+  grid->addWidget( new QLabel( "rel_perimeter_stiffness", this ),18, 2 );
+  grid->addWidget( rel_perimeter_stiffness_edit, 18, 2+1  );
+  grid->addWidget( new QLabel( "collapse_node_threshold", this ),19, 2 );
+  grid->addWidget( collapse_node_threshold_edit, 19, 2+1  );
+  grid->addWidget( new QLabel( "morphogen_div_threshold", this ),20, 2 );
+  grid->addWidget( morphogen_div_threshold_edit, 20, 2+1  );
+  grid->addWidget( new QLabel( "morphogen_expansion_threshold", this ),21, 2 );
+  grid->addWidget( morphogen_expansion_threshold_edit, 21, 2+1  );
+  grid->addWidget( new QLabel( "copy_wall", this ),22, 2 );
+  grid->addWidget( copy_wall_edit, 22, 2+1  );
+  grid->addWidget( new QLabel( "", this), 23, 2, 1, 2 );
+  grid->addWidget( new QLabel( " <b>Auxin transport and PIN1 dynamics</b>", this), 24, 2, 1, 2 );
+  grid->addWidget( new QLabel( "source", this ),25, 2 );
+  grid->addWidget( source_edit, 25, 2+1  );
+  grid->addWidget( new QLabel( "D", this ),26, 2 );
+  grid->addWidget( D_edit, 26, 2+1  );
+  grid->addWidget( new QLabel( "initval", this ),27, 2 );
+  grid->addWidget( initval_edit, 27, 2+1  );
+  grid->addWidget( new QLabel( "k1", this ),28, 2 );
+  grid->addWidget( k1_edit, 28, 2+1  );
+  grid->addWidget( new QLabel( "k2", this ),29, 2 );
+  grid->addWidget( k2_edit, 29, 2+1  );
+  grid->addWidget( new QLabel( "r", this ),3, 4 );
+  grid->addWidget( r_edit, 3, 4+1  );
+  grid->addWidget( new QLabel( "kr", this ),4, 4 );
+  grid->addWidget( kr_edit, 4, 4+1  );
+  grid->addWidget( new QLabel( "km", this ),5, 4 );
+  grid->addWidget( km_edit, 5, 4+1  );
+  grid->addWidget( new QLabel( "Pi_tot", this ),6, 4 );
+  grid->addWidget( Pi_tot_edit, 6, 4+1  );
+  grid->addWidget( new QLabel( "transport", this ),7, 4 );
+  grid->addWidget( transport_edit, 7, 4+1  );
+  grid->addWidget( new QLabel( "ka", this ),8, 4 );
+  grid->addWidget( ka_edit, 8, 4+1  );
+  grid->addWidget( new QLabel( "pin_prod", this ),9, 4 );
+  grid->addWidget( pin_prod_edit, 9, 4+1  );
+  grid->addWidget( new QLabel( "pin_prod_in_epidermis", this ),10, 4 );
+  grid->addWidget( pin_prod_in_epidermis_edit, 10, 4+1  );
+  grid->addWidget( new QLabel( "pin_breakdown", this ),11, 4 );
+  grid->addWidget( pin_breakdown_edit, 11, 4+1  );
+  grid->addWidget( new QLabel( "pin_breakdown_internal", this ),12, 4 );
+  grid->addWidget( pin_breakdown_internal_edit, 12, 4+1  );
+  grid->addWidget( new QLabel( "aux1prod", this ),13, 4 );
+  grid->addWidget( aux1prod_edit, 13, 4+1  );
+  grid->addWidget( new QLabel( "aux1prodmeso", this ),14, 4 );
+  grid->addWidget( aux1prodmeso_edit, 14, 4+1  );
+  grid->addWidget( new QLabel( "aux1decay", this ),15, 4 );
+  grid->addWidget( aux1decay_edit, 15, 4+1  );
+  grid->addWidget( new QLabel( "aux1decaymeso", this ),16, 4 );
+  grid->addWidget( aux1decaymeso_edit, 16, 4+1  );
+  grid->addWidget( new QLabel( "aux1transport", this ),17, 4 );
+  grid->addWidget( aux1transport_edit, 17, 4+1  );
+  grid->addWidget( new QLabel( "aux_cons", this ),18, 4 );
+  grid->addWidget( aux_cons_edit, 18, 4+1  );
+  grid->addWidget( new QLabel( "aux_breakdown", this ),19, 4 );
+  grid->addWidget( aux_breakdown_edit, 19, 4+1  );
+  grid->addWidget( new QLabel( "kaux1", this ),20, 4 );
+  grid->addWidget( kaux1_edit, 20, 4+1  );
+  grid->addWidget( new QLabel( "kap", this ),21, 4 );
+  grid->addWidget( kap_edit, 21, 4+1  );
+  grid->addWidget( new QLabel( "leaf_tip_source", this ),22, 4 );
+  grid->addWidget( leaf_tip_source_edit, 22, 4+1  );
+  grid->addWidget( new QLabel( "sam_efflux", this ),23, 4 );
+  grid->addWidget( sam_efflux_edit, 23, 4+1  );
+  grid->addWidget( new QLabel( "sam_auxin", this ),24, 4 );
+  grid->addWidget( sam_auxin_edit, 24, 4+1  );
+  grid->addWidget( new QLabel( "sam_auxin_breakdown", this ),25, 4 );
+  grid->addWidget( sam_auxin_breakdown_edit, 25, 4+1  );
+  grid->addWidget( new QLabel( "van3prod", this ),26, 4 );
+  grid->addWidget( van3prod_edit, 26, 4+1  );
+  grid->addWidget( new QLabel( "van3autokat", this ),27, 4 );
+  grid->addWidget( van3autokat_edit, 27, 4+1  );
+  grid->addWidget( new QLabel( "van3sat", this ),28, 4 );
+  grid->addWidget( van3sat_edit, 28, 4+1  );
+  grid->addWidget( new QLabel( "k2van3", this ),29, 4 );
+  grid->addWidget( k2van3_edit, 29, 4+1  );
   grid->addWidget( new QLabel( "", this), 3, 6, 1, 2 );
-  grid->addWidget( new QLabel( " <b>Meinhardt leaf venation model</b>", this), 4, 6, 1, 2 );
-  grid->addWidget( new QLabel( "constituous_expansion_limit", this ),5, 6 );
-  grid->addWidget( constituous_expansion_limit_edit, 5, 6+1  );
-  grid->addWidget( new QLabel( "vessel_inh_level", this ),6, 6 );
-  grid->addWidget( vessel_inh_level_edit, 6, 6+1  );
-  grid->addWidget( new QLabel( "vessel_expansion_rate", this ),7, 6 );
-  grid->addWidget( vessel_expansion_rate_edit, 7, 6+1  );
-  grid->addWidget( new QLabel( "d", this ),8, 6 );
-  grid->addWidget( d_edit, 8, 6+1  );
-  grid->addWidget( new QLabel( "e", this ),9, 6 );
-  grid->addWidget( e_edit, 9, 6+1  );
-  grid->addWidget( new QLabel( "f", this ),10, 6 );
-  grid->addWidget( f_edit, 10, 6+1  );
-  grid->addWidget( new QLabel( "c", this ),11, 6 );
-  grid->addWidget( c_edit, 11, 6+1  );
-  grid->addWidget( new QLabel( "mu", this ),12, 6 );
-  grid->addWidget( mu_edit, 12, 6+1  );
-  grid->addWidget( new QLabel( "nu", this ),13, 6 );
-  grid->addWidget( nu_edit, 13, 6+1  );
-  grid->addWidget( new QLabel( "rho0", this ),14, 6 );
-  grid->addWidget( rho0_edit, 14, 6+1  );
-  grid->addWidget( new QLabel( "rho1", this ),15, 6 );
-  grid->addWidget( rho1_edit, 15, 6+1  );
-  grid->addWidget( new QLabel( "c0", this ),16, 6 );
-  grid->addWidget( c0_edit, 16, 6+1  );
-  grid->addWidget( new QLabel( "gamma", this ),17, 6 );
-  grid->addWidget( gamma_edit, 17, 6+1  );
-  grid->addWidget( new QLabel( "eps", this ),18, 6 );
-  grid->addWidget( eps_edit, 18, 6+1  );
-  grid->addWidget( new QLabel( "", this), 19, 6, 1, 2 );
-  grid->addWidget( new QLabel( " <b>User-defined parameters</b>", this), 20, 6, 1, 2 );
-  grid->addWidget( new QLabel( "k", this ),21, 6 );
-  grid->addWidget( k_edit, 21, 6+1  );
-  grid->addWidget( new QLabel( "i1", this ),22, 6 );
-  grid->addWidget( i1_edit, 22, 6+1  );
-  grid->addWidget( new QLabel( "i2", this ),23, 6 );
-  grid->addWidget( i2_edit, 23, 6+1  );
-  grid->addWidget( new QLabel( "i3", this ),24, 6 );
-  grid->addWidget( i3_edit, 24, 6+1  );
-  grid->addWidget( new QLabel( "i4", this ),25, 6 );
-  grid->addWidget( i4_edit, 25, 6+1  );
-  grid->addWidget( new QLabel( "i5", this ),26, 6 );
-  grid->addWidget( i5_edit, 26, 6+1  );
-  grid->addWidget( new QLabel( "s1", this ),27, 6 );
-  grid->addWidget( s1_edit, 27, 6+1  );
-  grid->addWidget( new QLabel( "s2", this ),28, 6 );
-  grid->addWidget( s2_edit, 28, 6+1  );
-  grid->addWidget( new QLabel( "s3", this ),29, 6 );
-  grid->addWidget( s3_edit, 29, 6+1  );
-  grid->addWidget( new QLabel( "b1", this ),3, 8 );
-  grid->addWidget( b1_edit, 3, 8+1  );
-  grid->addWidget( new QLabel( "b2", this ),4, 8 );
-  grid->addWidget( b2_edit, 4, 8+1  );
-  grid->addWidget( new QLabel( "b3", this ),5, 8 );
-  grid->addWidget( b3_edit, 5, 8+1  );
-  grid->addWidget( new QLabel( "b4", this ),6, 8 );
-  grid->addWidget( b4_edit, 6, 8+1  );
-  grid->addWidget( new QLabel( "dir1", this ),7, 8 );
-  grid->addWidget( dir1_edit, 7, 8+1  );
-  grid->addWidget( new QLabel( "dir2", this ),8, 8 );
-  grid->addWidget( dir2_edit, 8, 8+1  );
+  grid->addWidget( new QLabel( " <b>Integration parameters</b>", this), 4, 6, 1, 2 );
+  grid->addWidget( new QLabel( "dt", this ),5, 6 );
+  grid->addWidget( dt_edit, 5, 6+1  );
+  grid->addWidget( new QLabel( "rd_dt", this ),6, 6 );
+  grid->addWidget( rd_dt_edit, 6, 6+1  );
+  grid->addWidget( new QLabel( "movie", this ),7, 6 );
+  grid->addWidget( movie_edit, 7, 6+1  );
+  grid->addWidget( new QLabel( "nit", this ),8, 6 );
+  grid->addWidget( nit_edit, 8, 6+1  );
+  grid->addWidget( new QLabel( "maxt", this ),9, 6 );
+  grid->addWidget( maxt_edit, 9, 6+1  );
+  grid->addWidget( new QLabel( "rseed", this ),10, 6 );
+  grid->addWidget( rseed_edit, 10, 6+1  );
+  grid->addWidget( new QLabel( "random_generator", this ),11, 6 );
+  grid->addWidget( random_generator_edit, 11, 6+1  );
+  grid->addWidget( new QLabel( "", this), 12, 6, 1, 2 );
+  grid->addWidget( new QLabel( " <b>Meinhardt leaf venation model</b>", this), 13, 6, 1, 2 );
+  grid->addWidget( new QLabel( "constituous_expansion_limit", this ),14, 6 );
+  grid->addWidget( constituous_expansion_limit_edit, 14, 6+1  );
+  grid->addWidget( new QLabel( "vessel_inh_level", this ),15, 6 );
+  grid->addWidget( vessel_inh_level_edit, 15, 6+1  );
+  grid->addWidget( new QLabel( "vessel_expansion_rate", this ),16, 6 );
+  grid->addWidget( vessel_expansion_rate_edit, 16, 6+1  );
+  grid->addWidget( new QLabel( "d", this ),17, 6 );
+  grid->addWidget( d_edit, 17, 6+1  );
+  grid->addWidget( new QLabel( "e", this ),18, 6 );
+  grid->addWidget( e_edit, 18, 6+1  );
+  grid->addWidget( new QLabel( "f", this ),19, 6 );
+  grid->addWidget( f_edit, 19, 6+1  );
+  grid->addWidget( new QLabel( "c", this ),20, 6 );
+  grid->addWidget( c_edit, 20, 6+1  );
+  grid->addWidget( new QLabel( "mu", this ),21, 6 );
+  grid->addWidget( mu_edit, 21, 6+1  );
+  grid->addWidget( new QLabel( "nu", this ),22, 6 );
+  grid->addWidget( nu_edit, 22, 6+1  );
+  grid->addWidget( new QLabel( "rho0", this ),23, 6 );
+  grid->addWidget( rho0_edit, 23, 6+1  );
+  grid->addWidget( new QLabel( "rho1", this ),24, 6 );
+  grid->addWidget( rho1_edit, 24, 6+1  );
+  grid->addWidget( new QLabel( "c0", this ),25, 6 );
+  grid->addWidget( c0_edit, 25, 6+1  );
+  grid->addWidget( new QLabel( "gamma", this ),26, 6 );
+  grid->addWidget( gamma_edit, 26, 6+1  );
+  grid->addWidget( new QLabel( "eps", this ),27, 6 );
+  grid->addWidget( eps_edit, 27, 6+1  );
+  grid->addWidget( new QLabel( "", this), 28, 6, 1, 2 );
+  grid->addWidget( new QLabel( " <b>User-defined parameters</b>", this), 29, 6, 1, 2 );
+  grid->addWidget( new QLabel( "k", this ),3, 8 );
+  grid->addWidget( k_edit, 3, 8+1  );
+  grid->addWidget( new QLabel( "i1", this ),4, 8 );
+  grid->addWidget( i1_edit, 4, 8+1  );
+  grid->addWidget( new QLabel( "i2", this ),5, 8 );
+  grid->addWidget( i2_edit, 5, 8+1  );
+  grid->addWidget( new QLabel( "i3", this ),6, 8 );
+  grid->addWidget( i3_edit, 6, 8+1  );
+  grid->addWidget( new QLabel( "i4", this ),7, 8 );
+  grid->addWidget( i4_edit, 7, 8+1  );
+  grid->addWidget( new QLabel( "i5", this ),8, 8 );
+  grid->addWidget( i5_edit, 8, 8+1  );
+  grid->addWidget( new QLabel( "s1", this ),9, 8 );
+  grid->addWidget( s1_edit, 9, 8+1  );
+  grid->addWidget( new QLabel( "s2", this ),10, 8 );
+  grid->addWidget( s2_edit, 10, 8+1  );
+  grid->addWidget( new QLabel( "s3", this ),11, 8 );
+  grid->addWidget( s3_edit, 11, 8+1  );
+  grid->addWidget( new QLabel( "b1", this ),12, 8 );
+  grid->addWidget( b1_edit, 12, 8+1  );
+  grid->addWidget( new QLabel( "b2", this ),13, 8 );
+  grid->addWidget( b2_edit, 13, 8+1  );
+  grid->addWidget( new QLabel( "b3", this ),14, 8 );
+  grid->addWidget( b3_edit, 14, 8+1  );
+  grid->addWidget( new QLabel( "b4", this ),15, 8 );
+  grid->addWidget( b4_edit, 15, 8+1  );
+  grid->addWidget( new QLabel( "dir1", this ),16, 8 );
+  grid->addWidget( dir1_edit, 16, 8+1  );
+  grid->addWidget( new QLabel( "dir2", this ),17, 8 );
+  grid->addWidget( dir2_edit, 17, 8+1  );
 QPushButton *pb = new QPushButton( "&Write", this );
-grid->addWidget(pb, 31, 6 );
+grid->addWidget(pb, 31, 8 );
 connect( pb, SIGNAL( clicked() ), this, SLOT( write() ) );
 QPushButton *pb2 = new QPushButton( "&Close", this );
-grid->addWidget(pb2,31, 6+1 );
+grid->addWidget(pb2,31, 8+1 );
 connect( pb2, SIGNAL( clicked() ), this, SLOT( close() ) );
 QPushButton *pb3 = new QPushButton( "&Reset", this );
-grid->addWidget(pb3, 31, 6+2 );
+grid->addWidget(pb3, 31, 8+2 );
 connect( pb3, SIGNAL( clicked() ), this, SLOT( Reset() ) );
 show();
 };
@@ -389,6 +416,8 @@ delete export_interval_edit;
 delete export_fn_prefix_edit;
 delete storage_stride_edit;
 delete xml_storage_stride_edit;
+delete trajectory_stride_edit;
+delete checkpoint_stride_edit;
 delete datadir_edit;
 delete T_edit;
 delete lambda_length_edit;
@@ -399,8 +428,14 @@ delete cell_expansion_rate_edit;
 delete cell_div_expansion_rate_edit;
 delete auxin_dependent_growth_edit;
 delete ode_accuracy_edit;
+delete ode_threads_edit;
+delete ode_solver_edit;
+delete ode_stats_edit;
+delete housekeeping_threads_edit;
 delete mc_stepsize_edit;
 delete mc_cell_stepsize_edit;
+delete mc_threads_edit;
+delete mc_check_intersections_edit;
 delete energy_threshold_edit;
 delete bend_lambda_edit;
 delete alignment_lambda_edit;
@@ -448,6 +483,7 @@ delete movie_edit;
 delete nit_edit;
 delete maxt_edit;
 delete rseed_edit;
+delete random_generator_edit;
 delete constituous_expansion_limit_edit;
 delete vessel_inh_level_edit;
 delete vessel_expansion_rate_edit;
@@ -496,6 +532,8 @@ QString tmpval;
   par.export_fn_prefix = strdup((const char *)export_fn_prefix_edit->text());
   par.storage_stride = storage_stride_edit->text().toInt();
   par.xml_storage_stride = xml_storage_stride_edit->text().toInt();
+  par.trajectory_stride = trajectory_stride_edit->text().toInt();
+  par.checkpoint_stride = checkpoint_stride_edit->text().toInt();
   par.datadir = strdup((const char *)datadir_edit->text());
   par.T = T_edit->text().toDouble();
   par.lambda_length = lambda_length_edit->text().toDouble();
@@ -512,8 +550,26 @@ QString tmpval;
       else par.auxin_dependent_growth=false;
   }
   par.ode_accuracy = ode_accuracy_edit->text().toDouble();
+  par.ode_threads = ode_threads_edit->text().toInt();
+  par.ode_solver = strdup((const char *)ode_solver_edit->text());
+  tmpval = ode_stats_edit->text().stripWhiteSpace();
+  if (tmpval == "true" || tmpval == "yes" ) par.ode_stats = true;
+  else if (tmpval == "false" || tmpval == "no") par.ode_stats = false;
+  else {
+    if (QMessageBox::question(this, "Syntax error", tr("Value %1 of parameter %2 is not recognized as Boolean.\nDo you mean TRUE or FALSE?").arg(tmpval).arg("ode_stats"),"True","False", QString::null, 0, 1)==0) par.ode_stats=true;
+      else par.ode_stats=false;
+  }
+  par.housekeeping_threads = housekeeping_threads_edit->text().toInt();
   par.mc_stepsize = mc_stepsize_edit->text().toDouble();
   par.mc_cell_stepsize = mc_cell_stepsize_edit->text().toDouble();
+  par.mc_threads = mc_threads_edit->text().toInt();
+  tmpval = mc_check_intersections_edit->text().stripWhiteSpace();
+  if (tmpval == "true" || tmpval == "yes" ) par.mc_check_intersections = true;
+  else if (tmpval == "false" || tmpval == "no") par.mc_check_intersections = false;
+  else {
+    if (QMessageBox::question(this, "Syntax error", tr("Value %1 of parameter %2 is not recognized as Boolean.\nDo you mean TRUE or FALSE?").arg(tmpval).arg("mc_check_intersections"),"True","False", QString::null, 0, 1)==0) par.mc_check_intersections=true;
+      else par.mc_check_intersections=false;
+  }
   par.energy_threshold = energy_threshold_edit->text().toDouble();
   par.bend_lambda = bend_lambda_edit->text().toDouble();
   par.alignment_lambda = alignment_lambda_edit->text().toDouble();
@@ -631,6 +687,7 @@ QString tmpval;
   par.nit = nit_edit->text().toInt();
   par.maxt = maxt_edit->text().toDouble();
   par.rseed = rseed_edit->text().toInt();
+  par.random_generator = strdup((const char *)random_generator_edit->text());
   par.constituous_expansion_limit = constituous_expansion_limit_edit->text().toInt();
   par.vessel_inh_level = vessel_inh_level_edit->text().toDouble();
   par.vessel_expansion_rate = vessel_expansion_rate_edit->text().toDouble();
@@ -731,6 +788,8 @@ void ParameterDialog::Reset(void) {
   export_fn_prefix_edit->setText( QString("%1").arg(par.export_fn_prefix) );
   storage_stride_edit->setText( QString("%1").arg(par.storage_stride) );
   xml_storage_stride_edit->setText( QString("%1").arg(par.xml_storage_stride) );
+  trajectory_stride_edit->setText( QString("%1").arg(par.trajectory_stride) );
+  checkpoint_stride_edit->setText( QString("%1").arg(par.checkpoint_stride) );
   datadir_edit->setText( QString("%1").arg(par.datadir) );
   T_edit->setText( QString("%1").arg(par.T) );
   lambda_length_edit->setText( QString("%1").arg(par.lambda_length) );
@@ -741,8 +800,14 @@ void ParameterDialog::Reset(void) {
   cell_div_expansion_rate_edit->setText( QString("%1").arg(par.cell_div_expansion_rate) );
   auxin_dependent_growth_edit->setText( QString("%1").arg(sbool(par.auxin_dependent_growth)));
   ode_accuracy_edit->setText( QString("%1").arg(par.ode_accuracy) );
+  ode_threads_edit->setText( QString("%1").arg(par.ode_threads) );
+  ode_solver_edit->setText( QString("%1").arg(par.ode_solver) );
+  ode_stats_edit->setText( QString("%1").arg(sbool(par.ode_stats)));
+  housekeeping_threads_edit->setText( QString("%1").arg(par.housekeeping_threads) );
   mc_stepsize_edit->setText( QString("%1").arg(par.mc_stepsize) );
   mc_cell_stepsize_edit->setText( QString("%1").arg(par.mc_cell_stepsize) );
+  mc_threads_edit->setText( QString("%1").arg(par.mc_threads) );
+  mc_check_intersections_edit->setText( QString("%1").arg(sbool(par.mc_check_intersections)));
   energy_threshold_edit->setText( QString("%1").arg(par.energy_threshold) );
   bend_lambda_edit->setText( QString("%1").arg(par.bend_lambda) );
   alignment_lambda_edit->setText( QString("%1").arg(par.alignment_lambda) );
@@ -794,6 +859,7 @@ void ParameterDialog::Reset(void) {
   nit_edit->setText( QString("%1").arg(par.nit) );
   maxt_edit->setText( QString("%1").arg(par.maxt) );
   rseed_edit->setText( QString("%1").arg(par.rseed) );
+  random_generator_edit->setText( QString("%1").arg(par.random_generator) );
   constituous_expansion_limit_edit->setText( QString("%1").arg(par.constituous_expansion_limit) );
   vessel_inh_level_edit->setText( QString("%1").arg(par.vessel_inh_level) );
   vessel_expansion_rate_edit->setText( QString("%1").arg(par.vessel_expansion_rate) );
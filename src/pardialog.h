@@ -59,6 +59,8 @@ class ParameterDialog : public QDialog {
   QLineEdit *export_fn_prefix_edit;
   QLineEdit *storage_stride_edit;
   QLineEdit *xml_storage_stride_edit;
+  QLineEdit *trajectory_stride_edit;
+  QLineEdit *checkpoint_stride_edit;
   QLineEdit *datadir_edit;
   QLineEdit *T_edit;
   QLineEdit *lambda_length_edit;
@@ -69,8 +71,14 @@ class ParameterDialog : public QDialog {
   QLineEdit *cell_div_expansion_rate_edit;
   QLineEdit *auxin_dependent_growth_edit;
   QLineEdit *ode_accuracy_edit;
+  QLineEdit *ode_threads_edit;
+  QLineEdit *ode_solver_edit;
+  QLineEdit *ode_stats_edit;
+  QLineEdit *housekeeping_threads_edit;
   QLineEdit *mc_stepsize_edit;
   QLineEdit *mc_cell_stepsize_edit;
+  QLineEdit *mc_threads_edit;
+  QLineEdit *mc_check_intersections_edit;
   QLineEdit *energy_threshold_edit;
   QLineEdit *bend_lambda_edit;
   QLineEdit *alignment_lambda_edit;
@@ -118,6 +126,7 @@ class ParameterDialog : public QDialog {
   QLineEdit *nit_edit;
   QLineEdit *maxt_edit;
   QLineEdit *rseed_edit;
+  QLineEdit *random_generator_edit;
   QLineEdit *constituous_expansion_limit_edit;
   QLineEdit *vessel_inh_level_edit;
   QLineEdit *vessel_expansion_rate_edit;
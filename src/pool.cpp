@@ -0,0 +1,174 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "pool.h"
+
+static const std::string _module_id("$Id$");
+
+MemoryPool::MemoryPool(size_t block_size, size_t blocks) :
+  blocks_per_chunk(blocks), free_list(0), in_use(0)
+{
+  // room for the free list pointer, rounded up to the alignment
+  if (block_size < sizeof(void *)) block_size = sizeof(void *);
+  stride = sizeof(Header) + (block_size + sizeof(Header) - 1) / sizeof(Header) * sizeof(Header);
+}
+
+MemoryPool::~MemoryPool()
+{
+  Release(true);
+}
+
+void MemoryPool::NewChunk(void)
+{
+  char *chunk = (char *)malloc(stride * blocks_per_chunk);
+  if (!chunk) throw bad_alloc();
+  chunks.push_back(chunk);
+
+  // thread the new blocks onto the free list, in address order
+  for (size_t i = blocks_per_chunk; i > 0; i--) {
+    void *block = chunk + (i - 1) * stride + sizeof(Header);
+    *(void **)block = free_list;
+    free_list = block;
+  }
+}
+
+void *MemoryPool::Allocate(void)
+{
+  if (!free_list) NewChunk();
+
+  void *block = free_list;
+  free_list = *(void **)block;
+  ((Header *)block - 1)->pool = this;
+  in_use++;
+  return block;
+}
+
+void MemoryPool::Free(void *p)
+{
+  if (!p) return;
+
+  MemoryPool *pool = ((Header *)p - 1)->pool;
+  *(void **)p = pool->free_list;
+  pool->free_list = p;
+  pool->in_use--;
+}
+
+bool MemoryPool::Release(bool force)
+{
+  if (in_use && !force) return false;
+
+  for (vector<char *>::iterator c = chunks.begin(); c != chunks.end(); c++) {
+    free(*c);
+  }
+  chunks.clear();
+  free_list = 0;
+  in_use = 0;
+  return true;
+}
+
+PoolSet::PoolSet(void) :
+  pools(max_size / 16, (MemoryPool *)0) {}
+
+// Pools that still have blocks in use are left behind, so that
+// deleting those blocks later remains safe
+PoolSet::~PoolSet()
+{
+  for (vector<MemoryPool *>::iterator p = pools.begin(); p != pools.end(); p++) {
+    if (*p && !(*p)->BlocksInUse()) {
+      delete *p;
+    }
+  }
+}
+
+void *PoolSet::Allocate(size_t size)
+{
+  if (size > max_size) {
+    // large blocks get a header without a pool
+    void *block = ::operator new(size + 16);
+    *(MemoryPool **)block = 0;
+    return (char *)block + 16;
+  }
+
+  size_t size_class = size ? (size - 1) / 16 : 0;
+  if (!pools[size_class]) {
+    pools[size_class] = new MemoryPool(16 * (size_class + 1));
+  }
+  return pools[size_class]->Allocate();
+}
+
+void PoolSet::Free(void *p)
+{
+  if (!p) return;
+
+  if (*(MemoryPool **)((char *)p - 16) == 0) {
+    ::operator delete((char *)p - 16);
+  }
+  else {
+    MemoryPool::Free(p);
+  }
+}
+
+void PoolSet::Release(bool force)
+{
+  for (vector<MemoryPool *>::iterator p = pools.begin(); p != pools.end(); p++) {
+    if (*p) (*p)->Release(force);
+  }
+}
+
+size_t PoolSet::BlocksInUse(void) const
+{
+  size_t n = 0;
+  for (vector<MemoryPool *>::const_iterator p = pools.begin(); p != pools.end(); p++) {
+    if (*p) n += (*p)->BlocksInUse();
+  }
+  return n;
+}
+
+static PoolSet *object_pools = 0, *wall_payload_pools = 0;
+
+// The process-wide pool sets are never destroyed, so that objects that
+// outlive them at program exit can still be deleted.
+static PoolSet &DefaultPools(void)
+{
+  static PoolSet *pools = new PoolSet();
+  return *pools;
+}
+
+PoolSet &ObjectPools(void)
+{
+  return object_pools ? *object_pools : DefaultPools();
+}
+
+PoolSet &WallPayloadPools(void)
+{
+  return wall_payload_pools ? *wall_payload_pools : DefaultPools();
+}
+
+void SelectPools(PoolSet *objects, PoolSet *wall_payloads)
+{
+  object_pools = objects;
+  wall_payload_pools = wall_payloads;
+}
+
+/* finis */
@@ -0,0 +1,119 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/*! \brief Allocator of fixed-size blocks, carved from large chunks.
+
+  Freed blocks are kept on a free list for reuse; the chunks themselves
+  are only returned to the system by Release. Each block is preceded by
+  a header that points back to its pool, so Free does not need to know
+  the block size or the pool.
+
+  Pools are not thread safe: allocate and free from serial code only.
+*/
+class MemoryPool {
+
+ public:
+  explicit MemoryPool(size_t block_size, size_t blocks_per_chunk = 1024);
+  ~MemoryPool();
+
+  void *Allocate(void);
+  static void Free(void *p);
+
+  // Return all chunks to the system if no block is in use, or
+  // regardless if "force" is set; returns whether they were released.
+  bool Release(bool force = false);
+
+  inline size_t BlocksInUse(void) const { return in_use; }
+
+ private:
+  // keeps the blocks 16-byte aligned
+  union Header {
+    MemoryPool *pool;
+    double align[2];
+  };
+
+  MemoryPool(const MemoryPool &);
+  MemoryPool &operator=(const MemoryPool &);
+
+  void NewChunk(void);
+
+  size_t stride, blocks_per_chunk;
+  vector<char *> chunks;
+  void *free_list;
+  size_t in_use;
+};
+
+/*! \brief A set of memory pools with size classes of 16 bytes, for
+  objects of any size (requests above max_size go to operator new).
+*/
+class PoolSet {
+
+ public:
+  PoolSet(void);
+  ~PoolSet();
+
+  void *Allocate(size_t size);
+  static void Free(void *p);
+
+  inline double *AllocateDoubles(int n) { return (double *)Allocate(n * sizeof(double)); }
+
+  // Release the chunks of all pools (see MemoryPool::Release)
+  void Release(bool force = false);
+
+  size_t BlocksInUse(void) const;
+
+  static const size_t max_size = 1024;
+
+ private:
+  PoolSet(const PoolSet &);
+  PoolSet &operator=(const PoolSet &);
+
+  vector<MemoryPool *> pools;
+};
+
+/*! Pools for the Node, Wall and Cell objects, and the cells' chemicals:
+  those selected with SelectPools, normally the Mesh's own.
+*/
+PoolSet &ObjectPools(void);
+
+//! Pools for the transporter arrays of the walls, selected as ObjectPools
+PoolSet &WallPayloadPools(void);
+
+/*! Allocate new objects from "objects" and "wall_payloads" from now on.
+  Zero selects process-wide pools, which are never released; these are
+  used before a Mesh exists, or after it has gone.
+*/
+void SelectPools(PoolSet *objects, PoolSet *wall_payloads);
+
+#endif
+
+/* finis */
@@ -25,52 +25,189 @@
 #include <stdlib.h>
 #include <sys/timeb.h>
 #include <iostream>
+#include <string.h>
+#include <algorithm>
 #include "random.h"
 
 static const std::string _module_id("$Id$");
 
 static int idum = -1;
+static bool init = true; // must RANDOM() initialize from idum first?
 using namespace std;
 
 static int counter = 0;
+static RandomStream global_stream;
+static PhiloxStream global_philox;
+static RandomGenerator generator = KnuthGenerator;
+
+// the stream of the innermost LocalRandomStream of this thread, if any
+static PhiloxStream *local_stream = 0;
+#ifdef _OPENMP
+#pragma omp threadprivate(local_stream)
+#endif
+// in a plugin, the host's CurrentLocalRandomStream; see UseHostLocalRandomStreams
+static PhiloxStream *(*host_local_stream)(void) = 0;
+
 /*! \return A random double between 0 and 1
 **/
 double RANDOM(void)
 /* Knuth's substrative method, see Numerical Recipes */
 {
-  static int inext, inextp;
-  static long ma[56];
-  static int iff = 0;
+  PhiloxStream *local = host_local_stream ? host_local_stream() : local_stream;
+  if (local) {
+    return local->Uniform();
+  }
   counter++;
+  if (generator == PhiloxGenerator) {
+    return global_philox.Uniform();
+  }
+  if (idum < 0 || init) {
+    global_stream.Init(idum);
+    idum = 1;
+    init = false;
+  }
+  return global_stream.Uniform();
+}
+
+/*! Choose the generator behind RANDOM(): "knuth", the subtractive
+  generator VirtualLeaf has always used, which reproduces earlier runs
+  exactly, or "philox", the counter-based PhiloxStream. Takes effect at
+  the next call of Seed().
+  \param The name of the generator
+  \return false if the name is unknown, in which case the generator is
+  left as it was
+**/
+bool SelectRandomGenerator(const char *name)
+{
+  if (!strcmp(name, "knuth")) {
+    generator = KnuthGenerator;
+  } else if (!strcmp(name, "philox")) {
+    generator = PhiloxGenerator;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+RandomGenerator SelectedRandomGenerator(void) {
+  return generator;
+}
+
+/*! \return The Philox stream behind RANDOM() when "philox" is selected
+**/
+PhiloxStream &GlobalPhiloxStream(void) {
+  return global_philox;
+}
+
+LocalRandomStream::LocalRandomStream(PhiloxStream &s) : previous(local_stream)
+{
+  local_stream = &s;
+}
+
+LocalRandomStream::~LocalRandomStream(void)
+{
+  local_stream = previous;
+}
+
+PhiloxStream *CurrentLocalRandomStream(void)
+{
+  return local_stream;
+}
+
+/*! Let RANDOM() draw from the local streams of another copy of this
+  file: a plugin has one of its own, with a generator of its own, and
+  the host uses this to hand its local streams over, so that RANDOM()
+  in a plugin's CellHouseKeeping draws from the cell's stream. Outside
+  the host's LocalRandomStreams, the plugin's RANDOM() is unchanged.
+  \param current The host's CurrentLocalRandomStream
+**/
+void UseHostLocalRandomStreams(PhiloxStream *(*current)(void))
+{
+  host_local_stream = current;
+}
+
+/*! Save the state of the generator behind RANDOM(), of both kinds,
+  whichever is selected.
+  \param The state
+**/
+void GetRandomState(RandomState &state)
+{
+  memset(&state, 0, sizeof(state));
+  state.generator = generator;
+  state.idum = idum;
+  state.counter = counter;
+  global_stream.GetState(state);
+  state.philox_seed = global_philox.SeedValue();
+  state.philox_stream = global_philox.StreamId();
+  state.philox_step = global_philox.Step();
+}
+
+/*! Restore the generator behind RANDOM() to a state saved by
+  GetRandomState; it then continues with exactly the numbers it would
+  have drawn after saving.
+  \param The state
+**/
+void SetRandomState(const RandomState &state)
+{
+  generator = state.generator == PhiloxGenerator ? PhiloxGenerator : KnuthGenerator;
+  idum = state.idum;
+  init = false;
+  counter = state.counter;
+  global_stream.SetState(state);
+  global_philox.Seed(state.philox_seed, state.philox_stream);
+  global_philox.SetStep(state.philox_step);
+}
+
+/*! Initialize the state table from the seed, as RANDOM() does after
+  Seed().
+  \param The seed; only its absolute value is used
+**/
+void RandomStream::Init(long seed)
+{
   long mj, mk;
   int i, ii, k;
 
-  if (idum < 0 || iff == 0) {
-    iff = 1;
-    mj = MSEED - (idum < 0 ? -idum : idum);
-    mj %= MBIG;
-    ma[55] = mj;
-    mk = 1;
+  mj = MSEED - (seed < 0 ? -seed : seed);
+  mj %= MBIG;
+  ma[55] = mj;
+  mk = 1;
+  i = 1;
+  do {
+    ii = (21 * i) % 55;
+    ma[ii] = mk;
+    mk = mj - mk;
+    if (mk < MZ) mk += MBIG;
+    mj = ma[ii];
+  } while (++i <= 54);
+  k = 1;
+  do {
     i = 1;
     do {
-      ii = (21 * i) % 55;
-      ma[ii] = mk;
-      mk = mj - mk;
-      if (mk < MZ) mk += MBIG;
-      mj = ma[ii];
-    } while (++i <= 54);
-    k = 1;
-    do {
-      i = 1;
-      do {
-        ma[i] -= ma[1 + (i + 30) % 55];
-        if (ma[i] < MZ) ma[i] += MBIG;
-      } while (++i <= 55);
-    } while (++k <= 4);
-    inext = 0;
-    inextp = 31;
-    idum = 1;
-  }
+      ma[i] -= ma[1 + (i + 30) % 55];
+      if (ma[i] < MZ) ma[i] += MBIG;
+    } while (++i <= 55);
+  } while (++k <= 4);
+  inext = 0;
+  inextp = 31;
+}
+
+/*! Seed the stream and discard the first hundred numbers, like Seed()
+  does for the global generator.
+  \param An integer random seed
+**/
+void RandomStream::Seed(long seed)
+{
+  Init(seed);
+  for (int i = 0; i < 100; i++)
+    Uniform();
+}
+
+/*! \return A random double between 0 and 1 from this stream
+**/
+double RandomStream::Uniform(void)
+{
+  long mj;
+
   if (++inext == 56) inext = 1;
   if (++inextp == 56) inextp = 1;
   mj = ma[inext] - ma[inextp];
@@ -79,6 +216,170 @@ double RANDOM(void)
   return mj * FAC;
 }
 
+void RandomStream::GetState(RandomState &state) const
+{
+  // the entries are below MBIG, and fit in 32 bits
+  for (int i = 0; i < 56; i++)
+    state.ma[i] = ma[i];
+  state.inext = inext;
+  state.inextp = inextp;
+}
+
+void RandomStream::SetState(const RandomState &state)
+{
+  for (int i = 0; i < 56; i++)
+    ma[i] = state.ma[i];
+  inext = state.inext;
+  inextp = state.inextp;
+}
+
+// Philox4x32 multipliers and Weyl constants for the key schedule
+static const uint32_t PHILOX_M0 = 0xD2511F53;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const uint32_t PHILOX_W0 = 0x9E3779B9;
+static const uint32_t PHILOX_W1 = 0xBB67AE85;
+
+/*! Key the stream with the seed and the stream id, and rewind it.
+  \param seed The random seed
+  \param stream The stream id, e.g. the thread or cell number
+**/
+void PhiloxStream::Seed(long s, long id)
+{
+  seed = s;
+  stream = id;
+  uint64_t k = (uint64_t)s, c = (uint64_t)id;
+  key[0] = (uint32_t)k;
+  key[1] = (uint32_t)(k >> 32);
+  ctr[0] = (uint32_t)c;
+  ctr[1] = (uint32_t)(c >> 32);
+  block = 0;
+  pos = 4;
+}
+
+/*! Position the stream so that the next number drawn is number "step"
+  since seeding, as if "step" numbers had been drawn.
+**/
+void PhiloxStream::SetStep(uint64_t step)
+{
+  block = step / 4;
+  pos = 4;
+  if (step % 4) {
+    Generate();
+    pos = step % 4;
+  }
+}
+
+// the number of blocks Encrypt does in one go
+static const int PHILOX_LANES = 16;
+
+/*! Encrypt the counters of blocks first, first+1, ..., first+nblocks-1
+  (at most PHILOX_LANES) of this stream into out, four words per block.
+  The blocks are held in separate arrays per word, so that the rounds
+  run over all blocks in a loop that vectorizes.
+**/
+void PhiloxStream::Encrypt(uint64_t first, int nblocks, uint32_t *out) const
+{
+  uint32_t x0[PHILOX_LANES], x1[PHILOX_LANES], x2[PHILOX_LANES], x3[PHILOX_LANES];
+  for (int l = 0; l < nblocks; l++) {
+    x0[l] = (uint32_t)(first + l);
+    x1[l] = (uint32_t)((first + l) >> 32);
+    x2[l] = ctr[0];
+    x3[l] = ctr[1];
+  }
+
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; round++) {
+    for (int l = 0; l < nblocks; l++) {
+      uint64_t p0 = (uint64_t)PHILOX_M0 * x0[l];
+      uint64_t p1 = (uint64_t)PHILOX_M1 * x2[l];
+      x0[l] = (uint32_t)(p1 >> 32) ^ x1[l] ^ k0;
+      x1[l] = (uint32_t)p1;
+      x2[l] = (uint32_t)(p0 >> 32) ^ x3[l] ^ k1;
+      x3[l] = (uint32_t)p0;
+    }
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  for (int l = 0; l < nblocks; l++) {
+    out[4 * l] = x0[l];
+    out[4 * l + 1] = x1[l];
+    out[4 * l + 2] = x2[l];
+    out[4 * l + 3] = x3[l];
+  }
+}
+
+// Encrypt the next block into buf
+void PhiloxStream::Generate(void)
+{
+  Encrypt(block, 1, buf);
+  block++;
+  pos = 0;
+}
+
+static const double PHILOX_SCALE = 1. / 4294967296.;
+
+/*! \return A random double in [0,1) from this stream
+**/
+double PhiloxStream::Uniform(void)
+{
+  if (pos == 4) Generate();
+  return buf[pos++] * PHILOX_SCALE;
+}
+
+/*! Draw the next n numbers of the stream at once into out; the same
+  numbers as n calls of Uniform(), but generated PHILOX_LANES blocks at
+  a time.
+**/
+void PhiloxStream::Fill(double *out, size_t n)
+{
+  // finish the current block first
+  while (n && pos < 4) {
+    *out++ = buf[pos++] * PHILOX_SCALE;
+    n--;
+  }
+
+  uint32_t words[4 * PHILOX_LANES];
+  while (n >= 4) {
+    int nblocks = min((size_t)PHILOX_LANES, n / 4);
+    Encrypt(block, nblocks, words);
+    block += nblocks;
+    for (int i = 0; i < 4 * nblocks; i++) {
+      out[i] = words[i] * PHILOX_SCALE;
+    }
+    out += 4 * nblocks;
+    n -= 4 * nblocks;
+  }
+
+  while (n--) {
+    *out++ = Uniform();
+  }
+}
+
+/*! \param s The stream to draw from
+  \param n The number of numbers to draw per batch
+**/
+PhiloxBuffer::PhiloxBuffer(PhiloxStream &s, size_t n) :
+  stream(s), numbers(n > 0 ? n : 1)
+{
+  first = stream.Step();
+  stream.Fill(&numbers[0], numbers.size());
+  next = 0;
+}
+
+// Hand the unused numbers back to the stream
+PhiloxBuffer::~PhiloxBuffer(void)
+{
+  stream.SetStep(first + next);
+}
+
+void PhiloxBuffer::Refill(void)
+{
+  first += numbers.size();
+  stream.Fill(&numbers[0], numbers.size());
+  next = 0;
+}
+
 /*! \param An integer random seed
   \return the random seed
 **/
@@ -94,6 +395,8 @@ int Seed(int seed)
   else {
     int i;
     idum = -seed;
+    init = true;
+    global_philox.Seed(seed);
     for (i = 0; i < 100; i++)
       RANDOM();
     return seed;
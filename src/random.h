@@ -25,6 +25,10 @@
 #ifndef _RANDOM_H_
 #define _RANDOM_H_
 
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
 #define MBIG 1000000000
 #define MSEED 161803398
 #define MZ 0
@@ -37,6 +41,167 @@ void AskSeed();
 int Randomize(void);
 int RandomCounter(void);
 
+// The generators that can drive RANDOM(); see SelectRandomGenerator
+enum RandomGenerator { KnuthGenerator, PhiloxGenerator };
+
+bool SelectRandomGenerator(const char *name);
+RandomGenerator SelectedRandomGenerator(void);
+class PhiloxStream;
+PhiloxStream &GlobalPhiloxStream(void);
+
+// The complete state of the generator behind RANDOM(), so that a
+// simulation can be checkpointed and continued exactly. The layout is
+// fixed, as it is written to checkpoint files as is.
+struct RandomState {
+  int32_t generator; // a RandomGenerator
+  int32_t idum, counter;
+  int32_t inext, inextp; // the state of the subtractive generator
+  int32_t ma[56];
+  int32_t reserved;
+  int64_t philox_seed, philox_stream; // the state of the Philox stream
+  uint64_t philox_step;
+};
+
+void GetRandomState(RandomState &state);
+void SetRandomState(const RandomState &state);
+
+// Knuth's subtractive generator with its own state, so that independent
+// streams (e.g. one per thread in a parallel Monte Carlo sweep) can be
+// drawn from without touching the global generator behind RANDOM().
+class RandomStream {
+
+ public:
+  RandomStream(void) { Seed(1); }
+  RandomStream(long seed) { Seed(seed); }
+
+  void Seed(long seed);
+  void Init(long seed);
+  double Uniform(void);
+
+  void GetState(RandomState &state) const;
+  void SetState(const RandomState &state);
+
+ private:
+  long ma[56];
+  int inext, inextp;
+};
+
+/*! \brief Counter-based generator (Philox4x32-10, Salmon et al., SC'11).
+
+  The n-th number of a stream is a pure function of (seed, stream, n),
+  so there is no state to share: each thread, cell or replicate can
+  draw from its own stream, and a stream can be positioned anywhere
+  without drawing the numbers before it. Each block of the cipher
+  gives four numbers, of 32 bits each. The interface follows
+  RandomStream, and includes MyUrand's, so that a stream can be
+  passed to random_shuffle.
+*/
+class PhiloxStream {
+
+ public:
+  PhiloxStream(void) { Seed(1); }
+  PhiloxStream(long seed, long stream = 0) { Seed(seed, stream); }
+
+  void Seed(long seed, long stream = 0);
+  double Uniform(void);
+  void Fill(double *out, size_t n);
+
+  //! A random integer between 1 and max, as RandomNumber
+  inline long RandomNumber(long max) { return (long)(Uniform() * max + 1); }
+  inline long operator()(long nn) { return RandomNumber(nn) - 1; }
+
+  //! The number of numbers drawn since seeding
+  uint64_t Step(void) const { return 4 * block - (4 - pos); }
+  void SetStep(uint64_t step);
+
+  long SeedValue(void) const { return seed; }
+  long StreamId(void) const { return stream; }
+
+ private:
+  void Generate(void);
+  void Encrypt(uint64_t first, int nblocks, uint32_t *out) const;
+
+  long seed, stream;
+  uint32_t key[2], ctr[2]; // the key, and the stream half of the counter
+  uint64_t block; // index of the next block to generate
+  uint32_t buf[4];
+  int pos; // next unused entry of buf; 4 if buf is used up
+};
+
+/*! \brief Hands out the numbers of a PhiloxStream from a buffer that
+  is filled in batches, e.g. a Monte Carlo sweep's worth at a time.
+
+  Filling encrypts many counters at once, in a loop the compiler can
+  vectorize, and drawing is then an inlined array read. When the buffer
+  is destroyed, the stream is positioned just after the last number
+  drawn, so the numbers that were buffered but not used are not lost:
+  drawing through a buffer gives exactly the same numbers as drawing
+  from the stream directly. The buffer refills itself when it runs out.
+*/
+class PhiloxBuffer {
+
+ public:
+  PhiloxBuffer(PhiloxStream &s, size_t n);
+  ~PhiloxBuffer(void);
+
+  inline double Uniform(void) {
+    if (next == numbers.size()) Refill();
+    return numbers[next++];
+  }
+  inline long RandomNumber(long max) { return (long)(Uniform() * max + 1); }
+  inline long operator()(long nn) { return RandomNumber(nn) - 1; }
+
+ private:
+  PhiloxBuffer(const PhiloxBuffer &);
+  PhiloxBuffer &operator=(const PhiloxBuffer &);
+  void Refill(void);
+
+  PhiloxStream &stream;
+  uint64_t first; // the step of numbers[0] in the stream
+  std::vector<double> numbers;
+  size_t next;
+};
+
+/*! \brief While it exists, RANDOM() draws from the given stream in the
+  thread that created it, instead of from the global generator.
+
+  This gives code that calls RANDOM(), e.g. a plugin's
+  CellHouseKeeping, a stream of its own when it runs in parallel (see
+  Mesh::DoCellHouseKeepingParallel). The numbers then depend on the
+  stream only, not on which thread runs when.
+
+  A plugin links a copy of this file of its own, so its RANDOM() does
+  not see the host's local streams unless the host hands them over,
+  with UseHostLocalRandomStreams (see
+  SimPluginInterface::SetLocalRandomStreams).
+*/
+class LocalRandomStream {
+
+ public:
+  LocalRandomStream(PhiloxStream &s);
+  ~LocalRandomStream(void);
+
+ private:
+  LocalRandomStream(const LocalRandomStream &);
+  LocalRandomStream &operator=(const LocalRandomStream &);
+
+  PhiloxStream *previous;
+};
+
+// The stream of the innermost LocalRandomStream of the calling thread, or 0
+PhiloxStream *CurrentLocalRandomStream(void);
+// Make RANDOM() use the local streams that "current" returns, e.g. the
+// host's CurrentLocalRandomStream, instead of its own
+void UseHostLocalRandomStreams(PhiloxStream *(*current)(void));
+
+// Adapter exposing the global generator through the RandomStream
+// interface, for code that is templated on the generator.
+class GlobalRandom {
+
+ public:
+  inline double Uniform(void) { return RANDOM(); }
+};
+
 
 
 // Class MyUrand, so we can pass the random generator to STL's random_shuffle,
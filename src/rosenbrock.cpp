@@ -0,0 +1,332 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <string>
+#include <cmath>
+#include <cfloat>
+#include "rosenbrock.h"
+#include "warning.h"
+#include "maxmin.h"
+
+static const std::string _module_id("$Id$");
+
+// Step size control, as for stiff() in Numerical Recipes 16.6
+const double Rosenbrock::Safety = 0.9;
+const double Rosenbrock::Grow = 1.5;
+const double Rosenbrock::PGrow = -0.25;
+const double Rosenbrock::Shrnk = 0.5;
+const double Rosenbrock::PShrnk = -1.0/3.0;
+const double Rosenbrock::Errcon = 0.1296; // (Grow/Safety)^(1/PGrow)
+const int Rosenbrock::Maxtry = 40;
+const double Rosenbrock::Maxstp = 10000;
+const double Rosenbrock::Tiny = 1.0e-30;
+const double Rosenbrock::Atol = 1.0e-3;
+
+// GMRES(KrylovDim); the residual must drop below KrylovTol times the
+// requested accuracy, so that the linear solves do not spoil the error
+// estimate
+const int Rosenbrock::KrylovDim = 30;
+const int Rosenbrock::MaxKrylovIters = 300;
+const double Rosenbrock::KrylovTol = 1e-2;
+
+// Shampine's parameters for the four-stage Kaps-Rentrop scheme
+static const double Gam = 1.0/2.0, A21 = 2.0, A31 = 48.0/25.0, A32 = 6.0/25.0,
+  C21 = -8.0, C31 = 372.0/25.0, C32 = 12.0/5.0,
+  C41 = -112.0/125.0, C42 = -54.0/125.0, C43 = -2.0/5.0,
+  B1 = 19.0/9.0, B2 = 1.0/2.0, B3 = 25.0/108.0, B4 = 125.0/108.0,
+  E1 = 17.0/54.0, E2 = 7.0/36.0, E3 = 0.0, E4 = 125.0/108.0,
+  A2X = 1.0, A3X = 3.0/5.0;
+
+static double Norm2(int n, const double *v)
+{
+  double sum=0.;
+  for (int i=0;i<n;i++) sum+=v[i]*v[i];
+  return sqrt(sum);
+}
+
+void Rosenbrock::ResizeWorkspace(int n)
+{
+  if ((int)y.size() == n) return;
+
+  std::vector<double> *ws[] = { &yscal, &y, &dydx, &ysav, &dysav, &g1, &g2, &g3, &g4,
+				&err, &rhs, &r, &yarg, &farg, &zarg };
+  for (unsigned int i=0;i<sizeof(ws)/sizeof(ws[0]);i++) {
+    ws[i]->assign(n, 0.);
+  }
+  krylov.assign((KrylovDim+1)*n, 0.);
+  hess.assign((KrylovDim+1)*KrylovDim, 0.);
+  givens_c.assign(KrylovDim, 0.);
+  givens_s.assign(KrylovDim, 0.);
+  gvec.assign(KrylovDim+1, 0.);
+}
+
+void Rosenbrock::ApplyOperator(int n, double x, double gh, const double *v, double *out)
+/* out = v - gh J v, with J v approximated by a forward difference of
+   derivs around (x, ysav), where dysav holds the derivatives. */
+{
+  double vnorm=Norm2(n,v);
+  if (vnorm==0.) {
+    for (int i=0;i<n;i++) out[i]=0.;
+    return;
+  }
+  double sigma=sqrt(DBL_EPSILON)*(1.+Norm2(n,&ysav[0])/sqrt((double)n))/(vnorm/sqrt((double)n));
+  for (int i=0;i<n;i++) yarg[i]=ysav[i]+sigma*v[i];
+  derivs(x,&yarg[0],&farg[0]);
+  stats.fevals++;
+  stats.jvprods++;
+  for (int i=0;i<n;i++) out[i]=v[i]-gh*(farg[i]-dysav[i])/sigma;
+}
+
+void Rosenbrock::Precondition(int n, const double *v, double *out)
+{
+  if (precondition) {
+    jac.SolveILU(ilu,v,out);
+  } else if (out!=v) {
+    for (int i=0;i<n;i++) out[i]=v[i];
+  }
+}
+
+bool Rosenbrock::SolveLinear(int n, double x, double gh, double eps, const double *b, double *g)
+/* Restarted GMRES with modified Gram-Schmidt orthogonalisation and
+   Givens rotations (Saad, Iterative Methods for Sparse Linear Systems,
+   alg. 6.9), starting from g = 0, right-preconditioned with M
+   (alg. 9.5): it solves (A M^-1) u = b for u, and g = M^-1 u. Since
+   the preconditioning is on the right, the residuals are those of the
+   original system. Returns false if the residual did not converge
+   within MaxKrylovIters iterations. */
+{
+  const int m=KrylovDim;
+  double bnorm=Norm2(n,b);
+  for (int i=0;i<n;i++) g[i]=0.;
+  if (bnorm==0.) return true;
+
+  double tol=KrylovTol*eps*bnorm;
+  double *V=&krylov[0], *H=&hess[0];
+  int iters=0;
+
+  for (int i=0;i<n;i++) r[i]=b[i];
+  double beta=bnorm;
+
+  for (;;) {
+    for (int i=0;i<n;i++) V[i]=r[i]/beta;
+    gvec[0]=beta;
+    for (int k=1;k<=m;k++) gvec[k]=0.;
+
+    int k=0;
+    bool converged=false;
+    for (int j=0;j<m;j++) {
+      double *w=V+(j+1)*n;
+      Precondition(n,V+j*n,&zarg[0]);
+      ApplyOperator(n,x,gh,&zarg[0],w);
+      for (int i=0;i<=j;i++) {
+	double *vi=V+i*n, hij=0.;
+	for (int l=0;l<n;l++) hij+=w[l]*vi[l];
+	for (int l=0;l<n;l++) w[l]-=hij*vi[l];
+	H[i*m+j]=hij;
+      }
+      double hnext=Norm2(n,w);
+      if (hnext>0.) {
+	for (int l=0;l<n;l++) w[l]/=hnext;
+      }
+
+      // apply the previous rotations to the new column, then
+      // eliminate H(j+1,j)
+      for (int i=0;i<j;i++) {
+	double t=givens_c[i]*H[i*m+j]+givens_s[i]*H[(i+1)*m+j];
+	H[(i+1)*m+j]=-givens_s[i]*H[i*m+j]+givens_c[i]*H[(i+1)*m+j];
+	H[i*m+j]=t;
+      }
+      double d=sqrt(H[j*m+j]*H[j*m+j]+hnext*hnext);
+      givens_c[j]=d>0. ? H[j*m+j]/d : 1.;
+      givens_s[j]=d>0. ? hnext/d : 0.;
+      H[j*m+j]=d;
+      gvec[j+1]=-givens_s[j]*gvec[j];
+      gvec[j]*=givens_c[j];
+
+      k=j+1;
+      iters++;
+      stats.lin_iters++;
+      if (fabs(gvec[j+1])<=tol || hnext==0.) {
+	converged=true;
+	break;
+      }
+      if (iters>=MaxKrylovIters) break;
+    }
+
+    // back substitution for the coefficients, which go in gvec
+    for (int i=k-1;i>=0;i--) {
+      double sum=gvec[i];
+      for (int l=i+1;l<k;l++) sum-=H[i*m+l]*gvec[l];
+      gvec[i]= H[i*m+i]!=0. ? sum/H[i*m+i] : 0.;
+    }
+    for (int l=0;l<n;l++) zarg[l]=0.;
+    for (int i=0;i<k;i++) {
+      double *vi=V+i*n;
+      for (int l=0;l<n;l++) zarg[l]+=gvec[i]*vi[l];
+    }
+    Precondition(n,&zarg[0],&zarg[0]);
+    for (int l=0;l<n;l++) g[l]+=zarg[l];
+
+    if (converged) return true;
+    if (iters>=MaxKrylovIters) return false;
+
+    // restart from the true residual
+    ApplyOperator(n,x,gh,g,&r[0]);
+    for (int i=0;i<n;i++) r[i]=b[i]-r[i];
+    beta=Norm2(n,&r[0]);
+    if (beta<=tol) return true;
+  }
+}
+
+void Rosenbrock::stiff(double *y, double *dydx, int n, double *x, double htry, double eps,
+		       double *yscal, double *hdid, double *hnext)
+/* Fourth-order Rosenbrock step with monitoring of local truncation
+   error to adjust stepsize, after stiff() in Numerical Recipes 16.6,
+   for an autonomous system. Input are y[0..n-1] and its derivative
+   dydx at x, the stepsize to be attempted htry, the required accuracy
+   eps and the vector yscal against which the error is scaled. On
+   output, y and x are replaced by their new values, hdid is the
+   stepsize that was actually accomplished, and hnext is the estimated
+   next stepsize.
+
+   Each stage solves (I - Gam h J) g = Gam h rhs, which is the stage
+   equation (1/(Gam h) - J) g = rhs of Numerical Recipes scaled by Gam h.
+   The Jacobian for the preconditioner is evaluated once per step, and
+   factored again for each step size that is tried. */
+{
+  double xsav=(*x), h=htry;
+  for (int i=0;i<n;i++) {
+    ysav[i]=y[i];
+    dysav[i]=dydx[i];
+  }
+
+  bool have_jacobian=jacobian(xsav,&ysav[0],jac);
+  if (have_jacobian) stats.jacobians++;
+
+  for (int jtry=0;jtry<Maxtry;jtry++) {
+    double gh=Gam*h;
+    // without usable factors, GMRES runs unpreconditioned
+    precondition=have_jacobian && jac.NRows()==n && jac.FactorILU(gh,ilu);
+    for (int i=0;i<n;i++) rhs[i]=gh*dysav[i];
+    bool solved=SolveLinear(n,xsav,gh,eps,&rhs[0],&g1[0]);
+
+    if (solved) {
+      for (int i=0;i<n;i++) y[i]=ysav[i]+A21*g1[i];
+      derivs(xsav+A2X*h,y,dydx);
+      stats.fevals++;
+      for (int i=0;i<n;i++) rhs[i]=gh*(dydx[i]+C21*g1[i]/h);
+      solved=SolveLinear(n,xsav,gh,eps,&rhs[0],&g2[0]);
+    }
+    if (solved) {
+      for (int i=0;i<n;i++) y[i]=ysav[i]+A31*g1[i]+A32*g2[i];
+      derivs(xsav+A3X*h,y,dydx);
+      stats.fevals++;
+      for (int i=0;i<n;i++) rhs[i]=gh*(dydx[i]+(C31*g1[i]+C32*g2[i])/h);
+      solved=SolveLinear(n,xsav,gh,eps,&rhs[0],&g3[0]);
+    }
+    if (solved) {
+      for (int i=0;i<n;i++) rhs[i]=gh*(dydx[i]+(C41*g1[i]+C42*g2[i]+C43*g3[i])/h);
+      solved=SolveLinear(n,xsav,gh,eps,&rhs[0],&g4[0]);
+    }
+
+    if (solved) {
+      double errmax=0.0;
+      for (int i=0;i<n;i++) {
+	y[i]=ysav[i]+B1*g1[i]+B2*g2[i]+B3*g3[i]+B4*g4[i];
+	err[i]=E1*g1[i]+E2*g2[i]+E3*g3[i]+E4*g4[i];
+	errmax=FMAX(errmax,fabs(err[i]/yscal[i]));
+      }
+      errmax /= eps;
+      if (errmax <= 1.0) {
+	*x=xsav+h;
+	*hdid=h;
+	*hnext=(errmax > Errcon ? Safety*h*pow(errmax,PGrow) : Grow*h);
+	stats.steps++;
+	return;
+      }
+      // Truncation error too large, reduce stepsize
+      stats.rejected++;
+      h=SIGN(FMAX(Safety*h*pow(errmax,PShrnk),Shrnk*fabs(h)),h);
+    } else {
+      // the Krylov solver gave up; a smaller step makes the system
+      // better conditioned
+      stats.lin_failures++;
+      stats.rejected++;
+      h*=Shrnk;
+    }
+    if (xsav+h == xsav) MyWarning::error("stepsize underflow in Rosenbrock::stiff, with h = %f and htry = %f",h,htry);
+  }
+  MyWarning::error("Exceeded Maxtry in Rosenbrock::stiff");
+}
+
+void Rosenbrock::odeint(double *ystart, int nvar, double x1, double x2, double eps, double h1, double hmin, int *nok, int *nbad)
+/* Driver with adaptive stepsize control, as RungeKutta::odeint.
+   Integrate starting values ystart[0..nvar-1] from x1 to x2 with
+   accuracy eps. h1 is the guessed first stepsize, unless a previous
+   call ended with a larger one; hmin is the minimum allowed stepsize
+   (can be zero). On output nok and nbad are the number of good and bad
+   (but retried and fixed) steps taken, and ystart is replaced by values
+   at the end of the integration interval. */
+{
+  *nok = (*nbad) = 0;
+  if (nvar<=0) return;
+
+  ResizeWorkspace(nvar);
+  double *yscal=&this->yscal[0],*y=&this->y[0],*dydx=&this->dydx[0];
+
+  double x=x1,hnext,hdid;
+  double h=SIGN(FMAX(fabs(h1),hlast),x2-x1);
+  for (int i=0;i<nvar;i++) y[i]=ystart[i];
+
+  for (int nstp=0;nstp<Maxstp;nstp++) {
+    derivs(x,y,dydx);
+    stats.fevals++;
+    // As in RungeKutta, but with an absolute floor: components that
+    // are (still) zero would otherwise have to be solved for exactly,
+    // which the iterative linear solver cannot do
+    double ymax=0.;
+    for (int i=0;i<nvar;i++) ymax=FMAX(ymax,fabs(y[i])+fabs(dydx[i]*h));
+    for (int i=0;i<nvar;i++)
+      yscal[i]=fabs(y[i])+fabs(dydx[i]*h)+Atol*ymax+Tiny;
+
+    bool last=false;
+    if ((x+h-x2)*(x+h-x1) > 0.0) {
+      // If stepsize can overshoot, decrease, but remember the size we
+      // would have liked for the next call
+      hlast=fabs(h);
+      h=x2-x;
+      last=true;
+    }
+
+    stiff(y,dydx,nvar,&x,h,eps,yscal,&hdid,&hnext);
+    if (hdid == h) ++(*nok); else ++(*nbad);
+    if ((x-x2)*(x2-x1) >= 0.0) {
+      for (int i=0;i<nvar;i++) ystart[i]=y[i];
+      if (!last) hlast=fabs(hnext);
+      return;
+    }
+    if (fabs(hnext) <= hmin) MyWarning::error("Step size too small in Rosenbrock::odeint");
+    h=hnext;
+  }
+  MyWarning::error("Too many steps in Rosenbrock::odeint");
+}
+
+/* finis */
@@ -0,0 +1,112 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _ROSENBROCK_H_
+#define _ROSENBROCK_H_
+
+#include <vector>
+#include "odestats.h"
+#include "sparsejacobian.h"
+
+// Fourth-order Rosenbrock integrator with adaptive stepsize control,
+// for stiff systems (fast diffusion or transporter kinetics). It has
+// the same interface as RungeKutta. The linear systems of the stages
+// are solved with restarted GMRES, using finite-difference products of
+// the Jacobian with a vector. If the derived class supplies a sparse
+// Jacobian (see "jacobian"), GMRES is preconditioned with an
+// incomplete LU factorisation of it. The right-hand side must not
+// depend explicitly on x.
+class Rosenbrock  {
+
+ public:
+  Rosenbrock(void) : hlast(0.), precondition(false) {}
+  virtual ~Rosenbrock() {}
+
+  void odeint(double ystart[], int nvar, double x1, double x2, double eps, double h1,
+	      double hmin, int *nok, int *nbad);
+
+  ODEStats &Stats(void) { return stats; }
+
+  // The step size carried from one call to odeint to the next, so that
+  // it can be saved and restored with the state; 0 starts afresh from h1
+  double LastStepSize(void) const { return hlast; }
+  void SetLastStepSize(double h) { hlast = h; }
+
+ protected:
+  // implement "derivs" in a derived class
+  virtual void derivs(double x, double *y, double *dxdy) = 0;
+  // Fill in the Jacobian of derivs at (x, y) and return true, or
+  // return false to solve without a preconditioner. It is called once
+  // per step.
+  virtual bool jacobian(double x, double *y, SparseJacobian &J) { return false; }
+
+ private:
+  void stiff(double *y, double *dydx, int n, double *x, double htry, double eps,
+	     double *yscal, double *hdid, double *hnext);
+
+  // Solve (I - gh J) g = b, with J the Jacobian at (x, ysav), to a
+  // tolerance relative to the accuracy eps of the step
+  bool SolveLinear(int n, double x, double gh, double eps, const double *b, double *g);
+  // out = v - gh J v
+  void ApplyOperator(int n, double x, double gh, const double *v, double *out);
+  // out = M^-1 v, with M the preconditioner; out may be v
+  void Precondition(int n, const double *v, double *out);
+
+  void ResizeWorkspace(int n);
+
+  // step size at the end of the previous call to odeint, used as first
+  // guess for the next, because the stiff step sizes are typically
+  // much larger than h1
+  double hlast;
+
+  // Work arrays, kept between calls to odeint
+  std::vector<double> yscal, y, dydx; // odeint
+  std::vector<double> ysav, dysav, g1, g2, g3, g4, err, rhs; // stiff
+  std::vector<double> krylov, hess, givens_c, givens_s, gvec, r, yarg, farg, zarg; // SolveLinear
+
+  // the Jacobian at the start of the step, and the ILU factors of
+  // I - gh J, if "precondition"
+  SparseJacobian jac;
+  std::vector<double> ilu;
+  bool precondition;
+
+  ODEStats stats;
+
+  static const double Safety;
+  static const double Grow;
+  static const double PGrow;
+  static const double Shrnk;
+  static const double PShrnk;
+  static const double Errcon;
+  static const int Maxtry;
+  static const double Maxstp;
+  static const double Tiny;
+  static const double Atol;
+  static const int KrylovDim;
+  static const int MaxKrylovIters;
+  static const double KrylovTol;
+};
+#endif
+
+/* finis */
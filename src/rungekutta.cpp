@@ -58,9 +58,8 @@ void RungeKutta::rkqs(double *y, double *dydx, int n, double *x, double htry, do
    routine that computes the right-hand side derivatives. */
 {
   int i;
-  double errmax,h,htemp,xnew,*yerr,*ytemp;
-  yerr=new double[n];
-  ytemp=new double[n];
+  double errmax,h,htemp,xnew;
+  double *yerr=&this->yerr[0],*ytemp=&this->ytemp[0];
 
   h=htry; // Set stepsize to the initial trial value.
   for (;;) {
@@ -69,6 +68,7 @@ void RungeKutta::rkqs(double *y, double *dydx, int n, double *x, double htry, do
     for (i=0;i<n;i++) errmax=FMAX(errmax,fabs(yerr[i]/yscal[i]));
     errmax /= eps; // Scale relative to required tolerance.
     if (errmax <= 1.0) break; //Step succeeded. Compute size of next step.
+    stats.rejected++;
     htemp=Safety*h*pow(errmax,Pshrnk);
     //Truncation error too large, reduce stepsize.
     h=(h >= 0.0 ? FMAX(htemp,0.1*h) : FMIN(htemp,0.1*h));
@@ -82,9 +82,8 @@ void RungeKutta::rkqs(double *y, double *dydx, int n, double *x, double htry, do
   }
   else *hnext=5.0*h; //No more than a factor of 5 increase.
   *x += (*hdid=h);
+  stats.steps++;
   for (i=0;i<n;i++) y[i]=ytemp[i];
-  delete[] ytemp;
-  delete[] yerr;
 }
 
 
@@ -106,13 +105,8 @@ void RungeKutta::rkck(double *y, double *dydx, int n, double x, double h, double
     dc5 = -277.00/14336.0;
   double dc1=c1-2825.0/27648.0,dc3=c3-18575.0/48384.0,
     dc4=c4-13525.0/55296.0,dc6=c6-0.25;
-  double *ak2,*ak3,*ak4,*ak5,*ak6,*ytemp;
-  ak2=new double[n];
-  ak3=new double[n];
-  ak4=new double[n];
-  ak5=new double[n];
-  ak6=new double[n];
-  ytemp=new double[n];
+  double *ak2=&this->ak2[0],*ak3=&this->ak3[0],*ak4=&this->ak4[0],
+    *ak5=&this->ak5[0],*ak6=&this->ak6[0],*ytemp=&yarg[0];
   for (i=0;i<n;i++) //First step.
     ytemp[i]=y[i]+b21*h*dydx[i];
   derivs(x+a2*h,ytemp,ak2);// Second step.
@@ -128,18 +122,25 @@ void RungeKutta::rkck(double *y, double *dydx, int n, double x, double h, double
   for (i=0;i<n;i++)
     ytemp[i]=y[i]+h*(b61*dydx[i]+b62*ak2[i]+b63*ak3[i]+b64*ak4[i]+b65*ak5[i]);
   derivs(x+a6*h,ytemp,ak6); //Sixth step.
+  stats.fevals += 5;
   for (i=0;i<n;i++) //Accumulate increments with proper weights.
     yout[i]=y[i]+h*(c1*dydx[i]+c3*ak3[i]+c4*ak4[i]+c6*ak6[i]);
   for (i=0;i<n;i++)
     yerr[i]=h*(dc1*dydx[i]+dc3*ak3[i]+dc4*ak4[i]+dc5*ak5[i]+dc6*ak6[i]);
-
   //Estimate error as difference between fourth and fifth order methods.
-  delete[] ytemp;
-  delete[] ak6;
-  delete[] ak5;
-  delete[] ak4;
-  delete[] ak3;
-  delete[] ak2;
+}
+
+void RungeKutta::ResizeWorkspace(int n)
+{
+  if ((int)y.size() == n) return;
+
+  // assign() keeps the capacity, so a system that shrinks and grows
+  // again does not go back to the heap
+  std::vector<double> *ws[] = { &yscal, &y, &dydx, &yerr, &ytemp,
+				&ak2, &ak3, &ak4, &ak5, &ak6, &yarg };
+  for (unsigned int i=0;i<sizeof(ws)/sizeof(ws[0]);i++) {
+    ws[i]->assign(n, 0.);
+  }
 }
 
 
@@ -161,10 +162,8 @@ void RungeKutta::odeint(double *ystart, int nvar, double x1, double x2, double e
 {
   int nstp,i;
   double xsav=0,x,hnext,hdid,h;
-  double *yscal,*y,*dydx;
-  yscal=new double[nvar];
-  y=new double[nvar];
-  dydx=new double[nvar];
+  ResizeWorkspace(nvar);
+  double *yscal=&this->yscal[0],*y=&this->y[0],*dydx=&this->dydx[0];
   x=x1;
   h=SIGN(h1,x2-x1);
   *nok = (*nbad) = kount = 0;
@@ -172,6 +171,7 @@ void RungeKutta::odeint(double *ystart, int nvar, double x1, double x2, double e
   if (kmax > 0) xsav=x-dxsav*2.0; //Assures storage of first step.
   for (nstp=0;nstp<Maxstp;nstp++) { //Take at most Maxstp steps.
     derivs(x,y,dydx);
+    stats.fevals++;
     for (i=0;i<nvar;i++)
       /* Scaling used to monitor accuracy. This general-purpose choice can be modified
 	 if need be.*/
@@ -192,9 +192,6 @@ void RungeKutta::odeint(double *ystart, int nvar, double x1, double x2, double e
 	xp[kount]=x; //Save final step.
 	for (i=0;i<nvar;i++) yp[i][kount]=y[i];
       }
-      delete[] dydx;
-      delete[] y;
-      delete[] yscal;
       return; //Normal exit.
     }
     if (fabs(hnext) <= hmin) MyWarning::error("Step size too small in odeint");
@@ -25,6 +25,9 @@
 #ifndef _RUNGEKUTTA_H_
 #define _RUNGEKUTTA_H_
 
+#include <vector>
+#include "odestats.h"
+
 class RungeKutta  {
 
  public:
@@ -39,6 +42,8 @@ class RungeKutta  {
   void odeint(double ystart[], int nvar, double x1, double x2, double eps, double h1,
 	      double hmin, int *nok, int *nbad);
 
+  ODEStats &Stats(void) { return stats; }
+
 
  protected:
   // implement "derivs" in a derived class
@@ -53,6 +58,18 @@ class RungeKutta  {
   void rkck(double *y, double *dydx, int n, double x, double h, double yout[],
 	    double *yerr);
 
+  // (Re)allocate the work arrays; a no-op unless the number of
+  // variables changed since the previous call (e.g. after a cell division)
+  void ResizeWorkspace(int n);
+
+  // Work arrays, kept between calls to odeint so that the integrator
+  // does not touch the heap in its inner loop
+  std::vector<double> yscal, y, dydx; // odeint
+  std::vector<double> yerr, ytemp; // rkqs
+  std::vector<double> ak2, ak3, ak4, ak5, ak6, yarg; // rkck
+
+  ODEStats stats;
+
   static const double Safety;
   static const double PGrow;
   static const double Pshrnk;
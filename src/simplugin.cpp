@@ -22,6 +22,7 @@
 #include <string>
 #include <QString>
 #include "simplugin.h"
+#include "random.h"
 
 static const std::string _module_id("$Id$");
 
@@ -40,6 +41,19 @@ void SimPluginInterface::SetMesh(Mesh*)
 
 }
 
+void SimPluginInterface::SetLocalRandomStreams(PhiloxStream *(*current)(void))
+{
+  UseHostLocalRandomStreams(current);
+}
+
 QString SimPluginInterface::DefaultLeafML(void) { return QString(); }
 
+bool SimPluginInterface::CellJacobian(CellBase *, double *) { return false; }
+
+bool SimPluginInterface::WallJacobian(Wall *, double *) { return false; }
+
+bool SimPluginInterface::ParallelHouseKeeping(void) { return false; }
+
+bool SimPluginInterface::ParallelDynamics(void) { return false; }
+
 /* finis */
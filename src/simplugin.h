@@ -31,6 +31,7 @@
 #include "wallbase.h"
 
 class Parameter;
+class PhiloxStream;
 
 #include <QColor>
 #include <QString>
@@ -67,17 +68,47 @@ class SimPluginInterface {
 
   // Default LeafML-file to be read after model startup
   virtual QString DefaultLeafML(void);
+
+  // Optional analytic Jacobians, for implicit solvers (see
+  // Mesh::Jacobian). Return true after filling in "jac" (row major);
+  // the default returns false, and the Jacobian is then estimated by
+  // finite differences.
+
+  // Derivatives of CellDynamics' dchem with respect to the chemicals
+  // of c; NChem() x NChem()
+  virtual bool CellJacobian(CellBase *c, double *jac);
+
+  // Derivatives of WallDynamics and CelltoCellTransport of w, with rows
+  // [dchem_c1, dchem_c2, dw1, dw2] and columns [chemicals of C1,
+  // chemicals of C2, transporters1, transporters2]; 4 NChem() x 4 NChem()
+  virtual bool WallJacobian(Wall *w, double *jac);
+
+  // Return true if CellHouseKeeping may run for several cells at once
+  // (parameter housekeeping_threads, see
+  // Mesh::DoCellHouseKeepingParallel). It must then only write its own
+  // cell and keep no state of its own, e.g. in static variables. The
+  // default returns false, and housekeeping then runs serially.
+  // RANDOM() then draws from a stream per cell.
+  virtual bool ParallelHouseKeeping(void);
+
+  // Return true if CellDynamics, WallDynamics and CelltoCellTransport
+  // may run for several cells and walls at once (parameter
+  // ode_threads, see Mesh::DerivativesParallel). They must then only
+  // write the derivatives they are given. The default returns false,
+  // and the derivatives are then evaluated serially.
+  virtual bool ParallelDynamics(void);
   
   // For internal use; not to be redefined by end users
   virtual void SetParameters(Parameter *pass_pars);// { par = pass_pars; }
   virtual void SetCellsStaticDatamembers (CellsStaticDatamembers *cells_static_data_members_of_main);
   virtual void SetMesh(Mesh* m);
+  virtual void SetLocalRandomStreams(PhiloxStream *(*current)(void));
 
  protected:
   class Parameter *par;
 };
 
-Q_DECLARE_INTERFACE(SimPluginInterface, "nl.cwi.VirtualLeaf.SimPluginInterface/1.3") 
+Q_DECLARE_INTERFACE(SimPluginInterface, "nl.cwi.VirtualLeaf.SimPluginInterface/1.7") 
 Q_DECLARE_METATYPE(SimPluginInterface *)
 
 #endif
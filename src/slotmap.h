@@ -0,0 +1,103 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _SLOTMAP_H_
+#define _SLOTMAP_H_
+
+#include <vector>
+#include <algorithm>
+
+/*! \brief Contiguous, unordered collection of objects, with constant
+  time lookup and removal.
+
+  The objects themselves are the (stable) handles: each knows its
+  position in the collection through a data member "slot", which T
+  must have and must make accessible to SlotMap. Removing an object
+  moves the last one into its place, so the order of the objects
+  changes, but deterministically. An object can be in one SlotMap at a
+  time.
+*/
+template<class T> class SlotMap {
+
+ public:
+  typedef T *value_type;
+  typedef typename std::vector<T *>::iterator iterator;
+  typedef typename std::vector<T *>::const_iterator const_iterator;
+  typedef typename std::vector<T *>::size_type size_type;
+
+  inline iterator begin(void) { return items.begin(); }
+  inline iterator end(void) { return items.end(); }
+  inline const_iterator begin(void) const { return items.begin(); }
+  inline const_iterator end(void) const { return items.end(); }
+
+  inline size_type size(void) const { return items.size(); }
+  inline bool empty(void) const { return items.empty(); }
+  inline T *operator[](size_type i) const { return items[i]; }
+
+  void clear(void) { items.clear(); }
+  void reserve(size_type n) { items.reserve(n); }
+
+  void push_back(T *x) {
+    x->slot = items.size();
+    items.push_back(x);
+  }
+
+  bool contains(const T *x) const {
+    return x && x->slot >= 0 && x->slot < (int)items.size() && items[x->slot] == x;
+  }
+
+  // Remove the object at "pos", which is not dereferenced, so it may
+  // already have been deleted. Returns the iterator to the object that
+  // took its place (or end()), so that erasing while iterating works
+  // as for std::list.
+  iterator erase(iterator pos) {
+    size_type i = pos - items.begin();
+    if (i + 1 != items.size()) {
+      items[i] = items.back();
+      items[i]->slot = i;
+    }
+    items.pop_back();
+    return items.begin() + i;
+  }
+
+  void erase(T *x) {
+    if (contains(x)) erase(items.begin() + x->slot);
+  }
+
+  // Remove all entries equal to x, keeping the order of the others;
+  // typically x is 0, after entries have been cleared while iterating
+  void remove(const T *x) {
+    items.erase(std::remove(items.begin(), items.end(), x), items.end());
+    for (size_type i = 0; i < items.size(); i++) {
+      items[i]->slot = i;
+    }
+  }
+
+ private:
+  std::vector<T *> items;
+};
+
+#endif
+
+/* finis */
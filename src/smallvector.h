@@ -0,0 +1,151 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _SMALLVECTOR_H_
+#define _SMALLVECTOR_H_
+
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+
+/*! \brief Vector that keeps up to N elements inline, in the object
+  itself, and only goes to the heap beyond that.
+
+  Meant for the short per-cell and per-node lists of the mesh (a cell's
+  walls, a node's owners), which are walked far more often than they
+  change. Supports the parts of the std::list interface those lists
+  use; "erase" and "insert" keep the order of the elements. T must be
+  default constructible and assignable.
+*/
+template<class T, int N> class SmallVector {
+
+ public:
+  typedef T value_type;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef size_t size_type;
+
+  SmallVector(void) : data(local), n(0), capacity(N) {}
+  SmallVector(const SmallVector &src) : data(local), n(0), capacity(N) {
+    *this = src;
+  }
+  ~SmallVector() {
+    if (data != local) delete[] data;
+  }
+
+  SmallVector &operator=(const SmallVector &src) {
+    if (this != &src) {
+      clear();
+      reserve(src.n);
+      std::copy(src.begin(), src.end(), data);
+      n = src.n;
+    }
+    return *this;
+  }
+
+  inline iterator begin(void) { return data; }
+  inline iterator end(void) { return data + n; }
+  inline const_iterator begin(void) const { return data; }
+  inline const_iterator end(void) const { return data + n; }
+  inline reverse_iterator rbegin(void) { return reverse_iterator(end()); }
+  inline reverse_iterator rend(void) { return reverse_iterator(begin()); }
+  inline const_reverse_iterator rbegin(void) const { return const_reverse_iterator(end()); }
+  inline const_reverse_iterator rend(void) const { return const_reverse_iterator(begin()); }
+
+  inline size_type size(void) const { return n; }
+  inline bool empty(void) const { return n == 0; }
+
+  inline T &operator[](size_type i) { return data[i]; }
+  inline const T &operator[](size_type i) const { return data[i]; }
+  inline T &front(void) { return data[0]; }
+  inline const T &front(void) const { return data[0]; }
+  inline T &back(void) { return data[n - 1]; }
+  inline const T &back(void) const { return data[n - 1]; }
+
+  void push_back(const T &x) {
+    if (n == capacity) {
+      // x may live in our own buffer
+      T copy(x);
+      reserve(2 * capacity);
+      data[n++] = copy;
+    } else {
+      data[n++] = x;
+    }
+  }
+
+  void push_front(const T &x) {
+    insert(begin(), x);
+  }
+
+  iterator insert(iterator pos, const T &x) {
+    size_type i = pos - data;
+    T copy(x);
+    if (n == capacity) reserve(2 * capacity);
+    std::copy_backward(data + i, data + n, data + n + 1);
+    data[i] = copy;
+    n++;
+    return data + i;
+  }
+
+  iterator erase(iterator pos) {
+    return erase(pos, pos + 1);
+  }
+
+  iterator erase(iterator first, iterator last) {
+    iterator new_end = std::copy(last, end(), first);
+    std::fill(new_end, end(), T());
+    n = new_end - data;
+    return first;
+  }
+
+  // Remove all elements equal to x
+  void remove(const T &x) {
+    erase(std::remove(begin(), end(), x), end());
+  }
+
+  void clear(void) {
+    std::fill(begin(), end(), T());
+    n = 0;
+  }
+
+  void reserve(size_type cap) {
+    if (cap <= capacity) return;
+    T *p = new T[cap];
+    std::copy(data, data + n, p);
+    if (data != local) delete[] data;
+    data = p;
+    capacity = cap;
+  }
+
+ private:
+  T local[N];
+  T *data;
+  size_type n, capacity;
+};
+
+#endif
+
+/* finis */
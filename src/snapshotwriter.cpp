@@ -0,0 +1,151 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <string>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include "snapshotwriter.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+SnapshotWriter::SnapshotWriter(int c) :
+  capacity(c > 0 ? c : 1), busy(0), stopping(false)
+{
+}
+
+SnapshotWriter::~SnapshotWriter(void)
+{
+  {
+    QMutexLocker lock(&mutex);
+    stopping = true;
+    not_empty.wakeAll();
+  }
+  wait();
+  ReportErrors();
+}
+
+void SnapshotWriter::WriteImage(const QString &fname, const QImage &image)
+{
+  Job job;
+  job.fname = fname;
+  job.image = image;
+  Enqueue(job);
+}
+
+void SnapshotWriter::WriteData(const QString &fname, const QByteArray &data)
+{
+  Job job;
+  job.fname = fname;
+  job.data = data;
+  Enqueue(job);
+}
+
+void SnapshotWriter::Enqueue(const Job &job)
+{
+  ReportErrors();
+  {
+    QMutexLocker lock(&mutex);
+    // back-pressure: wait for the writer to catch up
+    while (jobs.size() >= capacity) {
+      not_full.wait(&mutex);
+    }
+    jobs.enqueue(job);
+    not_empty.wakeOne();
+  }
+  if (!isRunning()) {
+    start(QThread::LowPriority);
+  }
+}
+
+void SnapshotWriter::Flush(void)
+{
+  {
+    QMutexLocker lock(&mutex);
+    while (!jobs.isEmpty() || busy) {
+      idle.wait(&mutex);
+    }
+  }
+  ReportErrors();
+}
+
+void SnapshotWriter::ReportErrors(void)
+{
+  QStringList reported;
+  {
+    QMutexLocker lock(&mutex);
+    reported.swap(errors);
+  }
+  for (QStringList::const_iterator e = reported.begin(); e != reported.end(); e++) {
+    MyWarning::warning("%s", e->toStdString().c_str());
+  }
+}
+
+void SnapshotWriter::run(void)
+{
+  for (;;) {
+    Job job;
+    {
+      QMutexLocker lock(&mutex);
+      while (jobs.isEmpty() && !stopping) {
+	not_empty.wait(&mutex);
+      }
+      if (jobs.isEmpty()) {
+	return;
+      }
+      job = jobs.dequeue();
+      busy++;
+      not_full.wakeOne();
+    }
+
+    bool ok = Write(job);
+
+    QMutexLocker lock(&mutex);
+    if (!ok) {
+      errors.append(job.image.isNull() ?
+		    QString("File '%1' not saved successfully. Is the disk full?").arg(job.fname) :
+		    QString("Image '%1' not saved successfully. Is the disk full or the extension not recognized?").arg(job.fname));
+    }
+    busy--;
+    if (jobs.isEmpty() && !busy) {
+      idle.wakeAll();
+    }
+  }
+}
+
+bool SnapshotWriter::Write(const Job &job)
+{
+  if (!job.image.isNull()) {
+    // the format follows from the extension, as in MainBase::Save
+    return job.image.save(QDir::toNativeSeparators(job.fname));
+  }
+
+  QFile file(job.fname);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+  bool ok = file.write(job.data) == job.data.size();
+  file.close();
+  return ok && file.error() == QFile::NoError;
+}
+
+/* finis */
@@ -0,0 +1,93 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+
+#ifndef _SNAPSHOTWRITER_H_
+#define _SNAPSHOTWRITER_H_
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QStringList>
+#include <QImage>
+#include <QByteArray>
+
+/*! \brief Writes snapshots (images, LeafML files) to disk in a
+  background thread, so that the simulation can go on meanwhile.
+
+  The caller captures a snapshot, e.g. renders the canvas into a
+  QImage, which is cheap, and queues it; the thread then does what is
+  expensive: encoding the image, and writing the files. The images and
+  buffers are implicitly shared, so queueing does not copy them. The
+  queue holds at most "capacity" snapshots; when it is full, queueing
+  another waits until the oldest has been written, so that a simulation
+  that produces snapshots faster than they can be written is slowed
+  down to match, instead of filling up the memory.
+
+  Snapshots are written in the order in which they were queued. Write
+  errors are reported, with MyWarning::warning, in the thread that
+  queues snapshots, on the next call of WriteImage, WriteData or Flush.
+*/
+class SnapshotWriter : public QThread {
+
+ public:
+  SnapshotWriter(int capacity = 4);
+  //! Writes all queued snapshots, then stops the thread
+  ~SnapshotWriter(void);
+
+  //! Save "image" to "fname"; the format follows from the extension
+  void WriteImage(const QString &fname, const QImage &image);
+  //! Write "data" to "fname" as is
+  void WriteData(const QString &fname, const QByteArray &data);
+
+  //! Wait until all queued snapshots have been written
+  void Flush(void);
+
+ protected:
+  void run(void);
+
+ private:
+  struct Job {
+    QString fname;
+    QImage image;
+    QByteArray data;
+  };
+
+  void Enqueue(const Job &job);
+  void ReportErrors(void);
+  bool Write(const Job &job);
+
+  QQueue<Job> jobs;
+  int capacity;
+  int busy; // taken from the queue, but not yet written
+  bool stopping;
+  QStringList errors;
+  QMutex mutex;
+  QWaitCondition not_empty, not_full, idle;
+};
+
+#endif
+
+/* finis */
@@ -0,0 +1,220 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <string>
+#include <algorithm>
+#include "sparsejacobian.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+void SparseJacobian::Clear(void)
+{
+  n = ncolors = 0;
+  row_start.clear();
+  col.clear();
+  val.clear();
+  col_start.clear();
+  col_rows.clear();
+  col_entry.clear();
+  color.clear();
+  color_start.clear();
+  color_cols.clear();
+  diag.clear();
+  key.clear();
+}
+
+void SparseJacobian::SetPattern(int size, vector< pair<int, int> > &entries, const vector<int> &k)
+{
+  n = size;
+  key = k;
+
+  sort(entries.begin(), entries.end());
+  entries.erase(unique(entries.begin(), entries.end()), entries.end());
+
+  row_start.assign(n + 1, 0);
+  col.resize(entries.size());
+  for (size_t e = 0; e < entries.size(); e++) {
+    row_start[entries[e].first + 1]++;
+    col[e] = entries[e].second;
+  }
+  for (int i = 0; i < n; i++) {
+    row_start[i + 1] += row_start[i];
+  }
+  val.assign(col.size(), 0.);
+
+  SetupColumns();
+}
+
+/*! Set up the compressed column storage, and color the columns.
+
+  The coloring is a greedy distance-2 coloring, in column order: a
+  column gets the lowest color not yet used by any column that shares
+  a nonzero row with it. The number of colors is at most one more than
+  the largest number of columns any column shares a row with, which for
+  the mesh is a small multiple of NChem() times the number of walls of
+  a cell, independent of the size of the mesh.
+*/
+void SparseJacobian::SetupColumns(void)
+{
+  // compressed column storage of the pattern
+  col_start.assign(n + 1, 0);
+  col_rows.resize(col.size());
+  col_entry.resize(col.size());
+  for (size_t e = 0; e < col.size(); e++) {
+    col_start[col[e] + 1]++;
+  }
+  for (int j = 0; j < n; j++) {
+    col_start[j + 1] += col_start[j];
+  }
+  vector<int> next(col_start.begin(), col_start.end() - 1);
+  diag.assign(n, -1);
+  for (int i = 0; i < n; i++) {
+    for (int e = row_start[i]; e < row_start[i + 1]; e++) {
+      int pos = next[col[e]]++;
+      col_rows[pos] = i;
+      col_entry[pos] = e;
+      if (col[e] == i) diag[i] = e;
+    }
+  }
+
+  color.assign(n, -1);
+  ncolors = 0;
+  // forbidden[c] == j marks color c as taken by a neighbor of column j
+  vector<int> forbidden;
+  for (int j = 0; j < n; j++) {
+    for (int e = col_start[j]; e < col_start[j + 1]; e++) {
+      int i = col_rows[e];
+      for (int f = row_start[i]; f < row_start[i + 1]; f++) {
+        int c = color[col[f]];
+        if (c >= 0) forbidden[c] = j;
+      }
+    }
+    int c = 0;
+    while (c < ncolors && forbidden[c] == j) c++;
+    if (c == ncolors) {
+      ncolors++;
+      forbidden.push_back(-1);
+    }
+    color[j] = c;
+  }
+
+  color_start.assign(ncolors + 1, 0);
+  color_cols.resize(n);
+  for (int j = 0; j < n; j++) {
+    color_start[color[j] + 1]++;
+  }
+  for (int c = 0; c < ncolors; c++) {
+    color_start[c + 1] += color_start[c];
+  }
+  vector<int> pos(color_start.begin(), color_start.end() - 1);
+  for (int j = 0; j < n; j++) {
+    color_cols[pos[color[j]]++] = j;
+  }
+}
+
+void SparseJacobian::Zero(void)
+{
+  fill(val.begin(), val.end(), 0.);
+}
+
+void SparseJacobian::Add(int i, int j, double v)
+{
+  vector<int>::const_iterator first = col.begin() + row_start[i], last = col.begin() + row_start[i + 1];
+  vector<int>::const_iterator e = lower_bound(first, last, j);
+  if (e == last || *e != j) {
+    MyWarning::error("SparseJacobian::Add: element (%d, %d) is not in the pattern", i, j);
+  }
+  val[e - col.begin()] += v;
+}
+
+void SparseJacobian::Multiply(const double *x, double *y) const
+{
+  for (int i = 0; i < n; i++) {
+    double sum = 0.;
+    for (int e = row_start[i]; e < row_start[i + 1]; e++) {
+      sum += val[e] * x[col[e]];
+    }
+    y[i] = sum;
+  }
+}
+
+/*! ILU(0) of I - a J, row by row (Saad, Iterative Methods for Sparse
+  Linear Systems, alg. 10.4). The strictly lower part of "lu" holds
+  the multipliers of L, which has a unit diagonal, and the rest holds
+  U. Fill-in outside the pattern of J is dropped; the pattern of the
+  mesh's Jacobian is symmetric and has dense diagonal blocks, so the
+  factors are close to the exact ones for the local (stiff) couplings.
+*/
+bool SparseJacobian::FactorILU(double a, vector<double> &lu) const
+{
+  lu.resize(val.size());
+  for (size_t e = 0; e < val.size(); e++) {
+    lu[e] = -a * val[e];
+  }
+  for (int i = 0; i < n; i++) {
+    if (diag[i] < 0) return false;
+    lu[diag[i]] += 1.;
+  }
+
+  // pos[j] is the index of element (i, j) of the current row, or -1
+  vector<int> pos(n, -1);
+  for (int i = 0; i < n; i++) {
+    for (int e = row_start[i]; e < row_start[i + 1]; e++) {
+      pos[col[e]] = e;
+    }
+    for (int e = row_start[i]; e < diag[i]; e++) {
+      int k = col[e];
+      lu[e] /= lu[diag[k]];
+      for (int f = diag[k] + 1; f < row_start[k + 1]; f++) {
+        int p = pos[col[f]];
+        if (p >= 0) lu[p] -= lu[e] * lu[f];
+      }
+    }
+    for (int e = row_start[i]; e < row_start[i + 1]; e++) {
+      pos[col[e]] = -1;
+    }
+    if (lu[diag[i]] == 0.) return false;
+  }
+  return true;
+}
+
+void SparseJacobian::SolveILU(const vector<double> &lu, const double *b, double *x) const
+{
+  // L x = b
+  for (int i = 0; i < n; i++) {
+    double sum = b[i];
+    for (int e = row_start[i]; e < diag[i]; e++) {
+      sum -= lu[e] * x[col[e]];
+    }
+    x[i] = sum;
+  }
+  // U x = x
+  for (int i = n - 1; i >= 0; i--) {
+    double sum = x[i];
+    for (int e = diag[i] + 1; e < row_start[i + 1]; e++) {
+      sum -= lu[e] * x[col[e]];
+    }
+    x[i] = sum / lu[diag[i]];
+  }
+}
+
+/* finis */
@@ -0,0 +1,103 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+#ifndef _SPARSEJACOBIAN_H_
+#define _SPARSEJACOBIAN_H_
+
+#include <vector>
+
+using namespace std;
+
+/*! \brief Sparse (compressed row) Jacobian matrix of an ODE system,
+  with a column coloring for finite-difference estimation.
+
+  Columns of the same color have no nonzero row in common, so the
+  Jacobian columns of a whole color can be estimated from a single
+  extra evaluation of the right-hand side, with all variables of that
+  color perturbed at once (Curtis, Powell and Reid 1974). Mesh sets up
+  the pattern from the cell-wall topology and fills in the values, see
+  Mesh::Jacobian.
+*/
+class SparseJacobian {
+
+ public:
+  SparseJacobian(void) : n(0), ncolors(0) {}
+
+  void Clear(void);
+
+  // Set the pattern of an n x n matrix from the (row, column) pairs of
+  // its nonzeros, which may contain duplicates, color the columns and
+  // zero the values. "key" identifies what the pattern was built for.
+  void SetPattern(int n, vector< pair<int, int> > &entries, const vector<int> &key);
+
+  // Zero all values, keeping the pattern
+  void Zero(void);
+
+  // Add v to element (i, j), which must be in the pattern
+  void Add(int i, int j, double v);
+
+  // y = J x
+  void Multiply(const double *x, double *y) const;
+
+  // Incomplete LU factorisation without fill-in, ILU(0), of I - a J,
+  // into "lu", which takes the pattern of J. Returns false if the
+  // pattern lacks a diagonal element or a pivot vanishes.
+  bool FactorILU(double a, vector<double> &lu) const;
+
+  // Solve L U x = b, with the factors of FactorILU; x may be b
+  void SolveILU(const vector<double> &lu, const double *b, double *x) const;
+
+  inline int NRows(void) const { return n; }
+  inline int NNonZeros(void) const { return (int)col.size(); }
+  inline int NColors(void) const { return ncolors; }
+  inline const vector<int> &Key(void) const { return key; }
+
+  // compressed row storage
+  vector<int> row_start; // n + 1 entries
+  vector<int> col; // column of each nonzero, ascending within a row
+  vector<double> val;
+
+  // the same pattern in compressed column storage: the rows of the
+  // nonzeros of column j, and their index in col and val, are
+  // col_rows[col_start[j] .. col_start[j+1]-1] and col_entry[...]
+  vector<int> col_start, col_rows, col_entry;
+
+  // color of each column, and the columns of each color in
+  // compressed form: color_cols[color_start[c] .. color_start[c+1]-1]
+  vector<int> color;
+  vector<int> color_start, color_cols;
+
+  // index in col and val of the diagonal element of each row, or -1
+  vector<int> diag;
+
+ private:
+  void SetupColumns(void);
+
+  int n, ncolors;
+  vector<int> key;
+};
+
+#endif
+
+/* finis */
@@ -0,0 +1,597 @@
+/*
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "trajectory.h"
+#include "mesh.h"
+#include "warning.h"
+
+static const std::string _module_id("$Id$");
+
+using namespace std;
+
+#define TRAJECTORY_MAGIC "VLEAFTRJ"
+#define TRAJECTORY_FRAME_MAGIC "VLFRAME"
+#define TRAJECTORY_INDEX_MAGIC "VLTRJIDX"
+#define TRAJECTORY_VERSION 1
+#define TRAJECTORY_BYTE_ORDER 0x01020304
+
+// The file, the frames and the index are made up of these records,
+// in the byte order of the machine that wrote them
+
+struct TrajectoryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t reserved[4];
+};
+
+struct TrajectoryFrameHeader {
+  char magic[8];
+  uint64_t size; // of the whole block: this header, the column headers and the chunks
+  double time;
+  int32_t nnodes, ncells, nwalls, nchem;
+  int32_t ncolumns;
+  int32_t topology; // does the frame have the topology columns?
+};
+
+// the chunks follow the column headers in the same order, each
+// padded to a multiple of eight bytes
+struct TrajectoryColumn {
+  char name[16]; // zero padded
+  uint32_t record_size;
+  uint32_t filter;
+  uint64_t raw_size, compressed_size;
+};
+
+enum { FILTER_SHUFFLE = 1, FILTER_ZLIB = 2 };
+
+struct TrajectoryTrailer {
+  uint64_t index_offset;
+  uint64_t nframes;
+  char magic[8];
+};
+
+static inline uint64_t Align8(uint64_t n) { return (n + 7) & ~(uint64_t)7; }
+
+// Put the first bytes of all n records first, then the second bytes, etc.
+static void Shuffle(const char *in, char *out, size_t n, size_t record_size)
+{
+  for (size_t b=0;b<record_size;b++) {
+    for (size_t i=0;i<n;i++) {
+      out[b*n + i] = in[i*record_size + b];
+    }
+  }
+}
+
+static void Unshuffle(const char *in, char *out, size_t n, size_t record_size)
+{
+  for (size_t b=0;b<record_size;b++) {
+    for (size_t i=0;i<n;i++) {
+      out[i*record_size + b] = in[b*n + i];
+    }
+  }
+}
+
+// A column compressed, ready to be written
+struct Chunk {
+  TrajectoryColumn column;
+  vector<char> data;
+
+  Chunk(const char *name, const void *values, size_t record_size, size_t n) {
+    memset(&column, 0, sizeof(column));
+    strncpy(column.name, name, sizeof(column.name) - 1);
+    column.record_size = record_size;
+    column.filter = FILTER_SHUFFLE | FILTER_ZLIB;
+    column.raw_size = record_size * n;
+
+    vector<char> shuffled(column.raw_size);
+    if (n) {
+      Shuffle((const char *)values, &shuffled[0], n, record_size);
+    }
+    uLongf compressed_size = compressBound(column.raw_size);
+    data.resize(compressed_size);
+    if (compress2((Bytef *)&data[0], &compressed_size,
+		  (const Bytef *)(n ? &shuffled[0] : 0), column.raw_size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+      // store it as it is
+      column.filter = 0;
+      data.assign((const char *)values, (const char *)values + column.raw_size);
+      compressed_size = column.raw_size;
+    }
+    column.compressed_size = compressed_size;
+    data.resize(compressed_size);
+  }
+};
+
+TrajectoryWriter::TrajectoryWriter(void) : end(0)
+{
+}
+
+TrajectoryWriter::~TrajectoryWriter(void)
+{
+  Close();
+}
+
+/*! Open trajectory "fname" for appending frames.
+  \param append Continue the trajectory if it exists, rather than
+  start it anew. Its index is removed until it is closed again, so
+  that the file ends with the last frame.
+  \return false if it cannot be opened, or is not a trajectory
+*/
+bool TrajectoryWriter::Open(const char *fname, bool append)
+{
+  Close();
+  file.setFileName(fname);
+  QIODevice::OpenMode mode = QIODevice::ReadWrite;
+  if (!append) {
+    mode |= QIODevice::Truncate;
+  }
+  if (!file.open(mode)) {
+    MyWarning::unique_warning("Could not open trajectory %s for writing", fname);
+    return false;
+  }
+
+  index.clear();
+  if (file.size() == 0) {
+    TrajectoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.byte_order = TRAJECTORY_BYTE_ORDER;
+    if (file.write((const char *)&header, sizeof(header)) != sizeof(header) || !file.flush()) {
+      Fail();
+      return false;
+    }
+    end = sizeof(header);
+  } else {
+    TrajectoryHeader header;
+    if (file.read((char *)&header, sizeof(header)) != sizeof(header) ||
+	memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) ||
+	header.version != TRAJECTORY_VERSION || header.byte_order != TRAJECTORY_BYTE_ORDER) {
+      MyWarning::unique_warning("%s is not a trajectory that can be appended to", fname);
+      file.close();
+      return false;
+    }
+    ReadIndex(file, index, end);
+    // a stale index, or a damaged tail, must not survive a crash of this run
+    if (!file.resize(end)) {
+      Fail();
+      return false;
+    }
+  }
+
+  // the first frame appended will have the topology
+  last_cell_node_offsets.clear();
+  last_cell_nodes.clear();
+  last_walls.clear();
+  return true;
+}
+
+void TrajectoryWriter::Close(void)
+{
+  if (file.isOpen()) {
+    if (WriteIndex()) {
+      file.close();
+    } else {
+      Fail();
+    }
+  }
+}
+
+/*! Drop the frames at or after time "time", e.g. when a run is
+  continued from a checkpoint written before the end of the trajectory.
+*/
+void TrajectoryWriter::Truncate(double time)
+{
+  if (!file.isOpen()) return;
+
+  size_t i = index.size();
+  while (i > 0 && index[i-1].time >= time) {
+    i--;
+  }
+  if (i == index.size()) return;
+
+  end = index[i].offset;
+  index.resize(i);
+  if (!file.resize(end)) {
+    Fail();
+    return;
+  }
+  last_cell_node_offsets.clear();
+  last_cell_nodes.clear();
+  last_walls.clear();
+}
+
+double TrajectoryWriter::LastTime(void) const
+{
+  return index.empty() ? -1. : index.back().time;
+}
+
+void TrajectoryWriter::Fail(void)
+{
+  MyWarning::warning("Error writing trajectory %s", file.fileName().toStdString().c_str());
+  file.close();
+}
+
+/*! Append a frame. It is flushed, so that it survives a crash. */
+void TrajectoryWriter::Append(const TrajectoryFrame &frame)
+{
+  if (!file.isOpen()) return;
+
+  bool topology = index.empty() || frame.cell_node_offsets != last_cell_node_offsets ||
+    frame.cell_nodes != last_cell_nodes || frame.walls != last_walls;
+
+  vector<Chunk> chunks;
+  chunks.push_back(Chunk("node_x", frame.node_x.empty() ? 0 : &frame.node_x[0], sizeof(double), frame.node_x.size()));
+  chunks.push_back(Chunk("node_y", frame.node_y.empty() ? 0 : &frame.node_y[0], sizeof(double), frame.node_y.size()));
+  chunks.push_back(Chunk("cell_area", frame.cell_area.empty() ? 0 : &frame.cell_area[0], sizeof(double), frame.cell_area.size()));
+  chunks.push_back(Chunk("cell_chem", frame.cell_chem.empty() ? 0 : &frame.cell_chem[0], sizeof(double), frame.cell_chem.size()));
+  if (topology) {
+    chunks.push_back(Chunk("cell_node_offs", &frame.cell_node_offsets[0], sizeof(int32_t), frame.cell_node_offsets.size()));
+    chunks.push_back(Chunk("cell_nodes", frame.cell_nodes.empty() ? 0 : &frame.cell_nodes[0], sizeof(int32_t), frame.cell_nodes.size()));
+    chunks.push_back(Chunk("walls", frame.walls.empty() ? 0 : &frame.walls[0], sizeof(int32_t), frame.walls.size()));
+  }
+
+  TrajectoryFrameHeader header;
+  memset(&header, 0, sizeof(header));
+  strncpy(header.magic, TRAJECTORY_FRAME_MAGIC, sizeof(header.magic));
+  header.time = frame.time;
+  header.nnodes = frame.NNodes();
+  header.ncells = frame.NCells();
+  header.nwalls = frame.NWalls();
+  header.nchem = frame.nchem;
+  header.ncolumns = chunks.size();
+  header.topology = topology;
+
+  uint64_t size = sizeof(header) + chunks.size() * sizeof(TrajectoryColumn);
+  for (vector<Chunk>::const_iterator c=chunks.begin(); c!=chunks.end(); c++) {
+    size += Align8(c->data.size());
+  }
+  header.size = size;
+
+  // assemble the block, so that it is written in one go
+  vector<char> block(size, 0);
+  char *p = &block[0];
+  memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  for (vector<Chunk>::const_iterator c=chunks.begin(); c!=chunks.end(); c++) {
+    memcpy(p, &c->column, sizeof(TrajectoryColumn));
+    p += sizeof(TrajectoryColumn);
+  }
+  for (vector<Chunk>::const_iterator c=chunks.begin(); c!=chunks.end(); c++) {
+    if (!c->data.empty()) {
+      memcpy(p, &c->data[0], c->data.size());
+    }
+    p += Align8(c->data.size());
+  }
+
+  if (!file.seek(end) || file.write(&block[0], size) != (qint64)size || !file.flush()) {
+    Fail();
+    return;
+  }
+
+  IndexEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.offset = end;
+  entry.time = frame.time;
+  entry.topology_frame = topology ? index.size() : index.back().topology_frame;
+  index.push_back(entry);
+  end += size;
+
+  if (topology) {
+    last_cell_node_offsets = frame.cell_node_offsets;
+    last_cell_nodes = frame.cell_nodes;
+    last_walls = frame.walls;
+  }
+}
+
+bool TrajectoryWriter::WriteIndex(void)
+{
+  TrajectoryTrailer trailer;
+  memset(&trailer, 0, sizeof(trailer));
+  trailer.index_offset = end;
+  trailer.nframes = index.size();
+  memcpy(trailer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(trailer.magic));
+
+  qint64 index_size = index.size() * sizeof(IndexEntry);
+  return file.seek(end) &&
+    (!index_size || file.write((const char *)&index[0], index_size) == index_size) &&
+    file.write((const char *)&trailer, sizeof(trailer)) == sizeof(trailer) &&
+    file.resize(end + index_size + sizeof(trailer)) &&
+    file.flush();
+}
+
+/*! Read the index of the frames of "file" from the end of the file,
+  or, if it is missing or does not match, rebuild it by going through
+  the frames.
+  \param end Set to the end of the last complete frame
+  \return false if the index had to be rebuilt
+*/
+bool TrajectoryWriter::ReadIndex(QFile &file, vector<IndexEntry> &index, uint64_t &end)
+{
+  index.clear();
+  uint64_t size = file.size();
+
+  TrajectoryTrailer trailer;
+  if (size >= sizeof(TrajectoryHeader) + sizeof(trailer) &&
+      file.seek(size - sizeof(trailer)) &&
+      file.read((char *)&trailer, sizeof(trailer)) == sizeof(trailer) &&
+      !memcmp(trailer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(trailer.magic)) &&
+      trailer.index_offset >= sizeof(TrajectoryHeader) &&
+      trailer.index_offset <= size - sizeof(trailer) &&
+      trailer.nframes == (size - sizeof(trailer) - trailer.index_offset) / sizeof(IndexEntry) &&
+      trailer.index_offset + trailer.nframes * sizeof(IndexEntry) + sizeof(trailer) == size) {
+
+    index.resize(trailer.nframes);
+    qint64 index_size = trailer.nframes * sizeof(IndexEntry);
+    if (file.seek(trailer.index_offset) &&
+	(!index_size || file.read((char *)&index[0], index_size) == index_size)) {
+      bool ok = true;
+      for (size_t i=0;ok && i<index.size();i++) {
+	ok = index[i].offset < trailer.index_offset &&
+	  index[i].topology_frame >= 0 && index[i].topology_frame <= (int32_t)i;
+      }
+      if (ok) {
+	end = trailer.index_offset;
+	return true;
+      }
+    }
+    index.clear();
+  }
+
+  // go through the frames, up to the last complete one
+  end = sizeof(TrajectoryHeader);
+  int32_t topology_frame = -1;
+  TrajectoryFrameHeader header;
+  while (end + sizeof(header) <= size && file.seek(end) &&
+	 file.read((char *)&header, sizeof(header)) == sizeof(header) &&
+	 !strncmp(header.magic, TRAJECTORY_FRAME_MAGIC, sizeof(header.magic)) &&
+	 header.size >= sizeof(header) && header.size <= size - end) {
+    if (header.topology) {
+      topology_frame = index.size();
+    } else if (topology_frame < 0) {
+      break;
+    }
+    IndexEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = end;
+    entry.time = header.time;
+    entry.topology_frame = topology_frame;
+    index.push_back(entry);
+    end += header.size;
+  }
+  return false;
+}
+
+TrajectoryReader::TrajectoryReader(const char *fname) :
+  file(fname), topology_frame(-1)
+{
+  if (!file.open(QIODevice::ReadOnly)) {
+    throw("Could not open trajectory file.");
+  }
+  TrajectoryHeader header;
+  if (file.read((char *)&header, sizeof(header)) != sizeof(header) ||
+      memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic))) {
+    throw("Not a trajectory file.");
+  }
+  if (header.byte_order != TRAJECTORY_BYTE_ORDER) {
+    throw("Trajectory file was written on a machine of different byte order.");
+  }
+  if (header.version != TRAJECTORY_VERSION) {
+    throw("Trajectory file was written by a different version of VirtualLeaf.");
+  }
+  uint64_t end;
+  TrajectoryWriter::ReadIndex(file, index, end);
+}
+
+/*! Read a frame, including the topology, which may come from an
+  earlier frame.
+  \param frame The number of the frame, 0 being the first
+  \param f The frame read
+**/
+void TrajectoryReader::Read(int frame, TrajectoryFrame &f)
+{
+  if (frame < 0 || frame >= (int)index.size()) {
+    throw("No such frame in trajectory file.");
+  }
+
+  ReadBlock(frame, f);
+
+  int t = index[frame].topology_frame;
+  if (t == frame) {
+    cell_node_offsets = f.cell_node_offsets;
+    cell_nodes = f.cell_nodes;
+    walls = f.walls;
+    topology_frame = t;
+  } else {
+    if (t != topology_frame) {
+      TrajectoryFrame topology;
+      ReadBlock(t, topology);
+      cell_node_offsets.swap(topology.cell_node_offsets);
+      cell_nodes.swap(topology.cell_nodes);
+      walls.swap(topology.walls);
+      topology_frame = t;
+    }
+    f.cell_node_offsets = cell_node_offsets;
+    f.cell_nodes = cell_nodes;
+    f.walls = walls;
+  }
+
+  if ((int)f.cell_node_offsets.size() != f.NCells() + 1) {
+    throw("Trajectory file is damaged: the topology does not match the frame.");
+  }
+}
+
+// Read the columns of a frame that are stored with it
+void TrajectoryReader::ReadBlock(int frame, TrajectoryFrame &f)
+{
+  static const char *damaged = "Trajectory file is damaged.";
+
+  TrajectoryFrameHeader header;
+  if (!file.seek(index[frame].offset) ||
+      file.read((char *)&header, sizeof(header)) != sizeof(header) ||
+      strncmp(header.magic, TRAJECTORY_FRAME_MAGIC, sizeof(header.magic)) ||
+      header.ncolumns < 0 || header.nnodes < 0 || header.ncells < 0 || header.nwalls < 0 || header.nchem < 0) {
+    throw(damaged);
+  }
+
+  vector<TrajectoryColumn> columns(header.ncolumns);
+  qint64 columns_size = columns.size() * sizeof(TrajectoryColumn);
+  if (columns_size && file.read((char *)&columns[0], columns_size) != columns_size) {
+    throw(damaged);
+  }
+
+  f.time = header.time;
+  f.nchem = header.nchem;
+  f.node_x.clear();
+  f.node_y.clear();
+  f.cell_area.clear();
+  f.cell_chem.clear();
+  f.cell_node_offsets.clear();
+  f.cell_nodes.clear();
+  f.walls.clear();
+
+  uint64_t pos = index[frame].offset + sizeof(header) + columns_size;
+  vector<char> compressed, shuffled;
+  for (vector<TrajectoryColumn>::const_iterator c=columns.begin(); c!=columns.end(); c++) {
+    uint64_t next = pos + Align8(c->compressed_size);
+
+    // the columns this version knows, and the number of records they must have
+    void *values = 0;
+    uint64_t n = 0;
+    if (!strncmp(c->name, "node_x", sizeof(c->name))) {
+      f.node_x.resize(n = header.nnodes); values = n ? &f.node_x[0] : 0;
+    } else if (!strncmp(c->name, "node_y", sizeof(c->name))) {
+      f.node_y.resize(n = header.nnodes); values = n ? &f.node_y[0] : 0;
+    } else if (!strncmp(c->name, "cell_area", sizeof(c->name))) {
+      f.cell_area.resize(n = header.ncells); values = n ? &f.cell_area[0] : 0;
+    } else if (!strncmp(c->name, "cell_chem", sizeof(c->name))) {
+      f.cell_chem.resize(n = (uint64_t)header.ncells * header.nchem); values = n ? &f.cell_chem[0] : 0;
+    } else if (!strncmp(c->name, "cell_node_offs", sizeof(c->name))) {
+      f.cell_node_offsets.resize(n = header.ncells + 1); values = &f.cell_node_offsets[0];
+    } else if (!strncmp(c->name, "cell_nodes", sizeof(c->name))) {
+      // as many as the offsets say; those precede the nodes
+      n = c->record_size ? c->raw_size / c->record_size : 0;
+      f.cell_nodes.resize(n); values = n ? &f.cell_nodes[0] : 0;
+    } else if (!strncmp(c->name, "walls", sizeof(c->name))) {
+      f.walls.resize(n = 4 * (uint64_t)header.nwalls); values = n ? &f.walls[0] : 0;
+    } else {
+      pos = next;
+      continue;
+    }
+
+    size_t record_size = c->record_size;
+    if (c->raw_size != n * record_size || (record_size != sizeof(double) && record_size != sizeof(int32_t)) ||
+	(c->filter & ~(FILTER_SHUFFLE | FILTER_ZLIB)) || next > (uint64_t)file.size()) {
+      throw(damaged);
+    }
+
+    compressed.resize(c->compressed_size + 1);
+    if (!file.seek(pos) || file.read(&compressed[0], c->compressed_size) != (qint64)c->compressed_size) {
+      throw(damaged);
+    }
+    shuffled.resize(c->raw_size + 1);
+    if (c->filter & FILTER_ZLIB) {
+      uLongf raw_size = c->raw_size;
+      if (uncompress((Bytef *)&shuffled[0], &raw_size, (const Bytef *)&compressed[0], c->compressed_size) != Z_OK ||
+	  raw_size != c->raw_size) {
+	throw(damaged);
+      }
+    } else if (c->compressed_size == c->raw_size) {
+      shuffled.swap(compressed);
+    } else {
+      throw(damaged);
+    }
+    if (c->filter & FILTER_SHUFFLE) {
+      Unshuffle(&shuffled[0], (char *)values, n, record_size);
+    } else if (n) {
+      memcpy(values, &shuffled[0], c->raw_size);
+    }
+    pos = next;
+  }
+
+  // the nodes of the cells must be nodes, and follow the offsets
+  if (!f.cell_node_offsets.empty()) {
+    bool ok = f.cell_node_offsets[0] == 0 && f.cell_node_offsets.back() == (int32_t)f.cell_nodes.size();
+    for (size_t i=0;ok && i+1<f.cell_node_offsets.size();i++) {
+      ok = f.cell_node_offsets[i] <= f.cell_node_offsets[i+1];
+    }
+    for (size_t i=0;ok && i<f.cell_nodes.size();i++) {
+      ok = f.cell_nodes[i] >= 0 && f.cell_nodes[i] < header.nnodes;
+    }
+    if (!ok) {
+      throw(damaged);
+    }
+  }
+}
+
+/*! Fill in "frame" with the current state of the mesh, for
+  TrajectoryWriter. The boundary polygon is not one of the cells.
+*/
+void Mesh::GetTrajectoryFrame(TrajectoryFrame &frame) const
+{
+  const int nchem = Cell::NChem();
+
+  // not while the values are in the ODE solver's arrays
+  assert(StateInPlaceP());
+
+  frame.time = time;
+  frame.nchem = nchem;
+
+  frame.node_x.resize(nodes.size());
+  frame.node_y.resize(nodes.size());
+  for (size_t i=0;i<nodes.size();i++) {
+    frame.node_x[i] = nodes[i]->x;
+    frame.node_y[i] = nodes[i]->y;
+  }
+
+  frame.cell_area.resize(cells.size());
+  frame.cell_chem.resize(cells.size() * nchem);
+  frame.cell_node_offsets.assign(1, 0);
+  frame.cell_nodes.clear();
+  for (size_t i=0;i<cells.size();i++) {
+    const Cell *c = cells[i];
+    frame.cell_area[i] = c->Area();
+    for (int ch=0;ch<nchem;ch++) {
+      frame.cell_chem[i*nchem + ch] = c->Chemical(ch);
+    }
+    for (list<Node *>::const_iterator n=c->nodes.begin(); n!=c->nodes.end(); n++) {
+      frame.cell_nodes.push_back((*n)->Index());
+    }
+    frame.cell_node_offsets.push_back(frame.cell_nodes.size());
+  }
+
+  frame.walls.clear();
+  frame.walls.reserve(4 * walls.size());
+  for (SlotMap<Wall>::const_iterator i=walls.begin(); i!=walls.end(); i++) {
+    const Wall *w = *i;
+    frame.walls.push_back(w->c1->Index());
+    frame.walls.push_back(w->c2->Index());
+    frame.walls.push_back(w->n1->Index());
+    frame.walls.push_back(w->n2->Index());
+  }
+}
+
+/* finis */
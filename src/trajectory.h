@@ -0,0 +1,148 @@
+/*
+ *
+ *  $Id$
+ *
+ *  This file is part of the Virtual Leaf.
+ *
+ *  VirtualLeaf is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  VirtualLeaf is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the Virtual Leaf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Copyright 2010 Roeland Merks.
+ *
+ */
+
+
+
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <QFile>
+
+/*! \brief One frame of a trajectory: the state of the mesh that
+  post-processing usually needs, in flat arrays.
+
+  The topology (which nodes make up each cell, which cells and nodes
+  each wall connects) changes only when cells divide or nodes are
+  inserted, and is stored only in the frames in which it has changed;
+  TrajectoryReader fills it in for all frames.
+*/
+struct TrajectoryFrame {
+  double time;
+  int nchem;
+
+  std::vector<double> node_x, node_y;
+  std::vector<double> cell_area;
+  std::vector<double> cell_chem; // ncells x nchem, by cell
+
+  // the nodes of cell c are cell_nodes[cell_node_offsets[c]] up to
+  // cell_nodes[cell_node_offsets[c+1]], in order
+  std::vector<int32_t> cell_node_offsets, cell_nodes;
+  // c1, c2, n1, n2 of each wall; -1 is the boundary polygon
+  std::vector<int32_t> walls;
+
+  int NNodes(void) const { return node_x.size(); }
+  int NCells(void) const { return cell_area.size(); }
+  int NWalls(void) const { return walls.size() / 4; }
+};
+
+/*! \brief Appends frames to a trajectory file: a single file for all
+  of a run, instead of one LeafML file per frame.
+
+  The file starts with a header, followed by the frames. Each frame is
+  a block with its time and sizes, and its columns (node x, node y,
+  cell areas, chemicals, and, when it has changed, the topology), each
+  compressed separately with zlib as a chunk, after shuffling the bytes
+  of the numbers so that similar bytes (e.g. the exponents) are
+  adjacent, which compresses much better. After the last frame comes
+  an index of the frames, for random access, which is written when the
+  trajectory is closed. A trajectory without a valid index (e.g. the
+  run that wrote it was interrupted) is still read: the index is
+  rebuilt by going through the frames.
+
+  Write errors are reported once, with MyWarning::warning, after which
+  the writer ignores all further calls.
+*/
+class TrajectoryWriter {
+
+ public:
+  TrajectoryWriter(void);
+  ~TrajectoryWriter(void);
+
+  //! Start a new trajectory file, or continue an existing one
+  bool Open(const char *fname, bool append=false);
+  bool IsOpen(void) const { return file.isOpen(); }
+  //! Write the index and close the file
+  void Close(void);
+  //! Drop the frames from time "time" on
+  void Truncate(double time);
+
+  void Append(const TrajectoryFrame &frame);
+
+  //! The number of frames in the file
+  int NFrames(void) const { return index.size(); }
+  //! The time of the last frame, or a negative number if there is none
+  double LastTime(void) const;
+
+ private:
+  TrajectoryWriter(const TrajectoryWriter &);
+  TrajectoryWriter &operator=(const TrajectoryWriter &);
+
+  void Fail(void);
+  bool WriteIndex(void);
+
+  struct IndexEntry {
+    uint64_t offset;
+    double time;
+    int32_t topology_frame; // the frame with the topology of this one
+    int32_t reserved;
+  };
+  friend class TrajectoryReader;
+  static bool ReadIndex(QFile &file, std::vector<IndexEntry> &index, uint64_t &end);
+
+  QFile file;
+  std::vector<IndexEntry> index;
+  uint64_t end; // of the last frame
+  std::vector<int32_t> last_cell_node_offsets, last_cell_nodes, last_walls;
+};
+
+/*! \brief Reads frames from a trajectory file written by
+  TrajectoryWriter, in any order.
+
+  Errors in the file are thrown as a message.
+*/
+class TrajectoryReader {
+
+ public:
+  TrajectoryReader(const char *fname);
+
+  int NFrames(void) const { return index.size(); }
+  double Time(int frame) const { return index[frame].time; }
+
+  //! Read frame "frame", 0 being the first
+  void Read(int frame, TrajectoryFrame &f);
+
+ private:
+  void ReadBlock(int frame, TrajectoryFrame &f);
+
+  QFile file;
+  std::vector<TrajectoryWriter::IndexEntry> index;
+  int topology_frame; // the frame whose topology was read last
+  std::vector<int32_t> cell_node_offsets, cell_nodes, walls;
+};
+
+#endif
+
+/* finis */
@@ -90,14 +90,14 @@ bool Wall::CorrectWall( void ) {
       qDebug() << endl;
       qDebug() << "Owners node " << n1->Index() << ": ";
 
-      for (list<Neighbor>::iterator i = n1->owners.begin(); i!=n1->owners.end(); i++) {
+      for (NodeOwners::iterator i = n1->owners.begin(); i!=n1->owners.end(); i++) {
 	qDebug() << i->getCell()->Index() << " ";
       }
 
       qDebug() << endl;
       qDebug() << "Owners node " << n2->Index() << ": ";
 
-      for (list<Neighbor>::iterator i = n2->owners.begin(); i!=n2->owners.end(); i++) {
+      for (NodeOwners::iterator i = n2->owners.begin(); i!=n2->owners.end(); i++) {
 	qDebug() << i->getCell()->Index() << " ";
       }
       qDebug() << endl;
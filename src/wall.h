@@ -31,13 +31,15 @@
 
 #include<QGraphicsScene>
 
+class LeafMLWriter;
+
 class Wall : public WallBase {
 
  public:
  Wall(Node *sn1, Node *sn2, CellBase *sc1, CellBase *sc2) : WallBase(sn1, sn2, sc1, sc2) {}
 
 
-  void XMLAdd(xmlNodePtr parent_node) const;
+  void XMLAdd(LeafMLWriter &writer) const;
   bool CorrectWall(void);
 
 
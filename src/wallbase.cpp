@@ -71,16 +71,17 @@ WallBase::WallBase(Node *sn1, Node *sn2, CellBase *sc1, CellBase *sc2)
   n1 = sn1;
   n2 = sn2;
 
-  transporters1 = new double[CellBase::NChem()];
-  transporters2 = new double[CellBase::NChem()];
-  new_transporters1 = new double[CellBase::NChem()];
-  new_transporters2 = new double[CellBase::NChem()];
+  transporters1 = own_transporters1 = WallPayloadPools().AllocateDoubles(CellBase::NChem());
+  transporters2 = own_transporters2 = WallPayloadPools().AllocateDoubles(CellBase::NChem());
+  new_transporters1 = WallPayloadPools().AllocateDoubles(CellBase::NChem());
+  new_transporters2 = WallPayloadPools().AllocateDoubles(CellBase::NChem());
+  owns_payload = true;
 
   for (int i=0;i<CellBase::NChem();i++) {
     transporters1[i] = transporters2[i] = new_transporters1[i] = new_transporters2[i] = 0.;
   }
 
-//  apoplast = new double[CellBase::NChem()]; // not yet in use.
+//  apoplast = WallPayloadPools().AllocateDoubles(CellBase::NChem()); // not yet in use.
 
   SetLength();
 
@@ -89,12 +90,23 @@ WallBase::WallBase(Node *sn1, Node *sn2, CellBase *sc1, CellBase *sc2)
   dead = false;
   wall_type = Normal;
   wall_index = nwalls++;
+  slot = -1;
 
   SetWallStrength(sn1,sn2);//WORTEL
     SetWallStrain(0);//WORTEL
 }
 
 
+WallBase::~WallBase()
+{
+  if (owns_payload) {
+    PoolSet::Free(own_transporters1);
+    PoolSet::Free(own_transporters2);
+    PoolSet::Free(new_transporters1);
+    PoolSet::Free(new_transporters2);
+  }
+}
+
 void WallBase::SetWallStrength(Node* nn1, Node* nn2)//WORTEL
 {
   Vector ref(1., 0., 0.);
@@ -140,6 +152,18 @@ void WallBase::CopyWallContents(const WallBase &src)
   wall_strain = src.wall_strain;//WORTEL
 }
 
+void WallBase::DetachTransporters(void)
+{
+  if (transporters1 == own_transporters1 && transporters2 == own_transporters2) return;
+
+  for (int i=0; i<CellBase::NChem(); i++) {
+    own_transporters1[i] = transporters1[i];
+    own_transporters2[i] = transporters2[i];
+  }
+  transporters1 = own_transporters1;
+  transporters2 = own_transporters2;
+}
+
 void WallBase::SwapWallContents(WallBase *src)
 {
 
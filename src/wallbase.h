@@ -29,6 +29,7 @@
 #include <list>
 #include <iostream>
 #include "vector.h"
+#include "pool.h"
 
 class Node;
 class CellBase;
@@ -56,6 +57,7 @@ class WallBase {
   friend class CellBase;
   friend class Cell;
   friend class Mesh;
+  template<class T> friend class SlotMap;
   //! Cells to which the wall belongs
   CellBase *c1, *c2;
 
@@ -63,6 +65,12 @@ class WallBase {
   double *transporters1, *transporters2;
   double *new_transporters1, *new_transporters2;
 
+  //! The wall's own transporter arrays; transporters1 and 2 point either
+  //! to these, or into the mesh's state vector (see Mesh::BindState)
+  double *own_transporters1, *own_transporters2;
+  //! Does this wall free its transporter arrays? Shallow copies do not.
+  bool owns_payload;
+
   bool IllegalP(void) { return c1 == c2; }
 
   //! The chemicals in the apoplast at this position
@@ -83,7 +91,7 @@ class WallBase {
   double wall_strain;//WORTEL
 
   // disallow usage of empty constructor
-  WallBase(void) {}
+  WallBase(void) : owns_payload(false) {}
 
 
   enum WallType {Normal, AuxSource, AuxSink};
@@ -91,10 +99,17 @@ class WallBase {
  protected:
   int wall_index;
   WallType wall_type;
+  //! Position in Mesh::walls (see SlotMap), or -1
+  int slot;
 
 
  public:
   WallBase(Node *sn1, Node *sn2, CellBase *sc1, CellBase *sc2); 
+  ~WallBase();
+
+  // walls are allocated from the object pools
+  static void *operator new(size_t size) { return ObjectPools().Allocate(size); }
+  static void operator delete(void *p) { PoolSet::Free(p); }
 
   // shallow copy
   WallBase(const WallBase &src) {
@@ -104,6 +119,12 @@ class WallBase {
     transporters2 = src.transporters2;
     new_transporters1 = src.new_transporters1;
     new_transporters2 = src.new_transporters2;
+    own_transporters1 = src.own_transporters1;
+    own_transporters2 = src.own_transporters2;
+    owns_payload = false;
+    // the copy must not point into the mesh's state vector, which is
+    // rebuilt without it; it takes the values as they are now
+    DetachTransporters();
     //apoplast = src.apoplast;
     n1 = src.n1;
     n2 = src.n2;
@@ -111,6 +132,7 @@ class WallBase {
     viz_flux = src.viz_flux;
     dead = src.dead;
     wall_index = src.wall_index;
+    slot = -1;
     wall_strength = src.wall_strength;//WORTEL
     wall_strain= src.wall_strain;//WORTEL
   }
@@ -135,6 +157,9 @@ class WallBase {
   inline void setNewTransporters2(int ch, double val) { new_transporters2[ch]=val; }
   inline double Transporters1(int ch) { return transporters1[ch]; }
   inline double Transporters2(int ch) { return transporters2[ch]; }
+  //! Copy the transporters back into the wall's own arrays and point
+  //! transporters1 and 2 at them, e.g. when the wall leaves the mesh
+  void DetachTransporters(void);
 
   //! Return true if the WallBase adheres to the SAM (shoot apical meristem)
   bool SAM_P(void);
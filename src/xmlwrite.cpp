@@ -33,6 +33,8 @@
 #include <libxml/xmlreader.h>
 #include <QLocale>
 #include "xmlwrite.h"
+#include "leafmlwriter.h"
+#include "leafmlreader.h"
 #include "nodeset.h"
 #include "warning.h"
 #include "output.h" 
@@ -50,207 +52,96 @@ void ThrowStringStream(stringstream &s) {
 }
 
 
-// Add this cell to the XML tree
-void Cell::XMLAdd(xmlNodePtr cells_node) const {
+// Write this cell to the LeafML document
+void Cell::XMLAdd(LeafMLWriter &writer) const {
 
   // Save the cell to a stream so we can reconstruct its state later
-  xmlNodePtr xmlcell = xmlNewChild(cells_node, NULL, BAD_CAST "cell",NULL);
-  XMLAddCore(xmlcell);
+  writer.StartElement("cell");
+  XMLAddCore(writer);
+  writer.EndElement();
 }
 
-void BoundaryPolygon::XMLAdd(xmlNodePtr parent_node) const {
+void BoundaryPolygon::XMLAdd(LeafMLWriter &writer) const {
 
-  xmlNodePtr xmlcell = xmlNewChild(parent_node, NULL, BAD_CAST "boundary_polygon",NULL);
-  XMLAddCore(xmlcell);
+  writer.StartElement("boundary_polygon");
+  XMLAddCore(writer);
+  writer.EndElement();
 }
 
-void NodeSet::XMLAdd(xmlNode *root) const {
+void NodeSet::XMLAdd(LeafMLWriter &writer) const {
 
-  xmlNode *xmlnodeset = xmlNewChild(root, NULL, BAD_CAST "nodeset", NULL);
+  writer.StartElement("nodeset");
 
   for (list<Node *>::const_iterator i=begin();i!=end();i++) {
-    {
-      ostringstream text;
-      xmlNodePtr node_xml = xmlNewChild(xmlnodeset, NULL, BAD_CAST "node", NULL);
-      text << (*i)->Index();
-      xmlNewProp(node_xml, BAD_CAST "n", BAD_CAST text.str().c_str());
-    }
+    writer.StartElement("node");
+    writer.Attribute("n", (*i)->Index());
+    writer.EndElement();
   }
+
+  writer.EndElement();
 }
 
 
 
 
-void Cell::XMLAddCore(xmlNodePtr xmlcell) const {
+void Cell::XMLAddCore(LeafMLWriter &writer) const {
 
   // properties
-
-  {
-    ostringstream text;
-    text << index;
-    xmlNewProp(xmlcell, BAD_CAST "index" , BAD_CAST text.str().c_str() );
-  }
-  {
-    ostringstream text;
-    text << area;
-    xmlNewProp(xmlcell, BAD_CAST "area", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << target_area;
-    xmlNewProp(xmlcell, BAD_CAST "target_area", BAD_CAST text.str().c_str());
-  }
-
-
-  {
-    ostringstream text;
-    text << target_length;
-    xmlNewProp(xmlcell, BAD_CAST "target_length", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << lambda_celllength;
-    xmlNewProp(xmlcell, BAD_CAST "lambda_celllength", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << stiffness;
-    xmlNewProp(xmlcell, BAD_CAST "stiffness", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(fixed);
-    xmlNewProp(xmlcell, BAD_CAST "fixed", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(pin_fixed);
-    xmlNewProp(xmlcell, BAD_CAST "pin_fixed", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(at_boundary);
-    xmlNewProp(xmlcell, BAD_CAST "at_boundary", BAD_CAST text.str().c_str());
-  }
-
-
-  {
-    ostringstream text;
-    text << bool_name(dead);
-    xmlNewProp(xmlcell, BAD_CAST "dead", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(source);
-    xmlNewProp(xmlcell, BAD_CAST "source", BAD_CAST text.str().c_str());
-  }
-
-
-  {
-    ostringstream text;
-    text << boundary_type_names[boundary];
-    xmlNewProp(xmlcell, BAD_CAST "boundary", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << div_counter;
-    xmlNewProp(xmlcell, BAD_CAST "div_counter", BAD_CAST text.str().c_str());
-  }
-
-  { 
-    ostringstream text;
-    text << cell_type;
-    xmlNewProp(xmlcell, BAD_CAST "cell_type", BAD_CAST text.str().c_str());
-  }
+  writer.Attribute("index", index);
+  writer.Attribute("area", area);
+  writer.Attribute("target_area", target_area);
+  writer.Attribute("target_length", target_length);
+  writer.Attribute("lambda_celllength", lambda_celllength);
+  writer.Attribute("stiffness", stiffness);
+  writer.Attribute("fixed", bool_name(fixed));
+  writer.Attribute("pin_fixed", bool_name(pin_fixed));
+  writer.Attribute("at_boundary", bool_name(at_boundary));
+  writer.Attribute("dead", bool_name(dead));
+  writer.Attribute("source", bool_name(source));
+  writer.Attribute("boundary", boundary_type_names[boundary]);
+  writer.Attribute("div_counter", div_counter);
+  writer.Attribute("cell_type", cell_type);
 
   for (list<Node *>::const_iterator i=nodes.begin();i!=nodes.end();i++) {
-    {
-      ostringstream text;
-      xmlNodePtr node_xml = xmlNewChild(xmlcell, NULL, BAD_CAST "node", NULL);
-      text << (*i)->Index();
-      xmlNewProp(node_xml, BAD_CAST "n", BAD_CAST text.str().c_str());
-    }
+    writer.StartElement("node");
+    writer.Attribute("n", (*i)->Index());
+    writer.EndElement();
   }
 
-  for (list<Wall *>::const_iterator i=walls.begin();i!=walls.end();i++) {
-    {
-      ostringstream text;
-      xmlNodePtr wall_xml = xmlNewChild(xmlcell, NULL, BAD_CAST "wall", NULL);
-      text << XMLIO::list_index( m->walls.begin(), m->walls.end(), *i );
-      xmlNewProp(wall_xml, BAD_CAST "w", BAD_CAST text.str().c_str());
-    }
+  // a wall's position in Mesh::walls is its slot
+  for (CellWalls::const_iterator i=walls.begin();i!=walls.end();i++) {
+    writer.StartElement("wall");
+    writer.Attribute("w", m->walls.contains(*i) ? (long)(*i)->slot : -1L);
+    writer.EndElement();
   }
 
-
-
-
-  xmlNodePtr chem_xml = xmlNewChild(xmlcell, NULL, BAD_CAST "chem", NULL); 
-  {
-    ostringstream text;
-    text << NChem();
-    xmlNewProp(chem_xml, BAD_CAST "n", BAD_CAST text.str().c_str());
-  }
+  writer.StartElement("chem");
+  writer.Attribute("n", NChem());
 
   for (int i=0;i<NChem();i++) {
-    xmlNodePtr chem_val_xml = xmlNewChild(chem_xml, NULL, BAD_CAST "val", NULL);
-    { 
-      ostringstream text;
-      text << chem[i];
-      xmlNewProp(chem_val_xml, BAD_CAST "v", BAD_CAST text.str().c_str());
-    }
+    writer.StartElement("val");
+    writer.Attribute("v", chem[i]);
+    writer.EndElement();
   }
+  writer.EndElement();
 }
 
 
 
-void Node::XMLAdd(xmlNodePtr nodes_node) const { 
+void Node::XMLAdd(LeafMLWriter &writer) const { 
 
   // Save the node to a stream so we can reconstruct its state later
-  xmlNodePtr xmlnode = xmlNewChild(nodes_node, NULL, BAD_CAST "node",NULL);
-
-  {
-    ostringstream text;
-    text << x;
-    xmlNewProp(xmlnode, BAD_CAST "x", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << y;
-    xmlNewProp(xmlnode, BAD_CAST "y", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(fixed);
-    xmlNewProp(xmlnode, BAD_CAST "fixed", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(boundary);
-    xmlNewProp(xmlnode, BAD_CAST "boundary", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << bool_name(sam);
-    xmlNewProp(xmlnode, BAD_CAST "sam", BAD_CAST text.str().c_str());
-  }
+  writer.StartElement("node");
+  writer.Attribute("x", x);
+  writer.Attribute("y", y);
+  writer.Attribute("fixed", bool_name(fixed));
+  writer.Attribute("boundary", bool_name(boundary));
+  writer.Attribute("sam", bool_name(sam));
 
   if (node_set) {
-    ostringstream text;
-    text << XMLIO::list_index(m->node_sets.begin(),m->node_sets.end(),node_set);
-    xmlNewProp(xmlnode, BAD_CAST "nodeset", BAD_CAST text.str().c_str());    
+    writer.Attribute("nodeset", XMLIO::list_index(m->node_sets.begin(),m->node_sets.end(),node_set));
   }
+  writer.EndElement();
 }
 
 void Neighbor::XMLAdd(xmlNodePtr neighbors_node) const {
@@ -540,8 +431,8 @@ int Cell::XMLRead(xmlNode *cur)
     }
   }
 
-  // Recalculate moments and area
-  SetIntegrals();
+  // moments and area are recalculated by Mesh::XMLReadGeometry, for
+  // all cells at once
   return 0;
 }
 
@@ -573,100 +464,40 @@ void NodeSet::XMLRead(xmlNode *root, Mesh *m)
 
 
 
-void Wall::XMLAdd(xmlNode *parent) const { 
+void Wall::XMLAdd(LeafMLWriter &writer) const { 
 
   // Save the node to a stream so we can reconstruct its state later
-  xmlNodePtr xmlwall = xmlNewChild(parent, NULL, BAD_CAST "wall",NULL);
-
-  {
-    ostringstream text;
-    text << Index();
-    xmlNewProp(xmlwall, BAD_CAST "index" , BAD_CAST text.str().c_str() );
-  }
-
-  {
-    ostringstream text;
-    text << c1->Index();
-    xmlNewProp(xmlwall, BAD_CAST "c1", BAD_CAST text.str().c_str());
-  }
-
-
-  {
-    ostringstream text;
-    text << c2->Index();
-    xmlNewProp(xmlwall, BAD_CAST "c2", BAD_CAST text.str().c_str());
-  }
-
-
-  {
-    ostringstream text;
-    text << n1->Index();
-    xmlNewProp(xmlwall, BAD_CAST "n1", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << n2->Index();
-    xmlNewProp(xmlwall, BAD_CAST "n2", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << length;
-    xmlNewProp(xmlwall, BAD_CAST "length", BAD_CAST text.str().c_str());
-  }
-
-
-  {
-    ostringstream text;
-    text << viz_flux;
-    xmlNewProp(xmlwall, BAD_CAST "viz_flux", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << WallTypetoStr(wall_type).c_str();
-    xmlNewProp(xmlwall, BAD_CAST "wall_type", BAD_CAST text.str().c_str());
-  }
-
-
-  xmlNodePtr tr1_xml = xmlNewChild(xmlwall, NULL, BAD_CAST "transporters1", NULL); 
+  writer.StartElement("wall");
+  writer.Attribute("index", Index());
+  writer.Attribute("c1", c1->Index());
+  writer.Attribute("c2", c2->Index());
+  writer.Attribute("n1", n1->Index());
+  writer.Attribute("n2", n2->Index());
+  writer.Attribute("length", length);
+  writer.Attribute("viz_flux", viz_flux);
+  writer.Attribute("wall_type", WallTypetoStr(wall_type).c_str());
+
+  writer.StartElement("transporters1");
   if (transporters1) {
     for (int i=0;i<Cell::NChem();i++) {
-      xmlNodePtr tr1_val_xml = xmlNewChild(tr1_xml, NULL, BAD_CAST "val", NULL);
-      { 
-	ostringstream text;
-	text << transporters1[i];
-	xmlNewProp(tr1_val_xml, BAD_CAST "v", BAD_CAST text.str().c_str());
-
-      }
+      writer.StartElement("val");
+      writer.Attribute("v", transporters1[i]);
+      writer.EndElement();
     }
   }
-  if (transporters2) {
-    xmlNodePtr tr2_xml = xmlNewChild(xmlwall, NULL, BAD_CAST "transporters2", NULL); 
+  writer.EndElement();
 
+  if (transporters2) {
+    writer.StartElement("transporters2");
     for (int i=0;i<Cell::NChem();i++) {
-      xmlNodePtr tr2_val_xml = xmlNewChild(tr2_xml, NULL, BAD_CAST "val", NULL);
-      { 
-	ostringstream text;
-	text << transporters2[i];
-	xmlNewProp(tr2_val_xml, BAD_CAST "v", BAD_CAST text.str().c_str());
-      }
+      writer.StartElement("val");
+      writer.Attribute("v", transporters2[i]);
+      writer.EndElement();
     }
+    writer.EndElement();
   }
 
-/*  if (apoplast) {
-    xmlNodePtr apo_xml = xmlNewChild(xmlwall, NULL, BAD_CAST "apoplast", NULL); 
-
-    for (int i=0;i<Cell::NChem();i++) {
-      xmlNodePtr apo_val_xml = xmlNewChild(apo_xml, NULL, BAD_CAST "val", NULL);
-      { 
-	ostringstream text;
-	text << transporters2[i];
-	xmlNewProp(apo_val_xml, BAD_CAST "v", BAD_CAST text.str().c_str());
-      }
-    }
-  } */
+  writer.EndElement();
 }
 
 
@@ -694,29 +525,31 @@ vector<double> XMLIO::XMLReadValArray(xmlNode *cur)
   return result;
 }
 
+/*! Write the mesh to LeafML file "docname". The document is streamed
+  to the file as it is generated (see LeafMLWriter), rather than built
+  in memory first. The option tree, if any, is written after the mesh
+  and then freed, as it used to be freed together with the document.
+*/
 void Mesh::XMLSave(const char *docname, xmlNode *options) const
 {
+  LeafMLWriter writer(docname);
+  XMLSave(writer, docname, options);
+}
 
-  // based on libxml2 example code "tree2.c"
-
-  xmlDocPtr doc = NULL;       /* document pointer */
-  xmlNodePtr root_node = NULL;/* node pointers */
-  //xmlDtdPtr dtd = NULL;       /* DTD pointer */
-
-  //  LIBXML_TEST_VERSION;
+/*! Write the LeafML file that XMLSave would write to "docname" into
+  "buffer" instead, e.g. to have it written out in the background.
+*/
+void Mesh::XMLSave(xmlBufferPtr buffer, const char *docname, xmlNode *options) const
+{
+  LeafMLWriter writer(buffer);
+  XMLSave(writer, docname, options);
+}
 
-  /* 
-   * Creates a new document, a node and set it as a root node
-   */
-  doc = xmlNewDoc(BAD_CAST "1.0");
-  root_node = xmlNewNode(NULL, BAD_CAST "leaf");
-  xmlDocSetRootElement(doc, root_node);
+void Mesh::XMLSave(LeafMLWriter &writer, const char *docname, xmlNode *options) const
+{
 
-  /* 
-   * xmlNewProp() creates attributes, which is "attached" to an node.
-   * It returns xmlAttrPtr, which isn't used here.
-   */
-  xmlNewProp(root_node, BAD_CAST "name", BAD_CAST docname);
+  writer.StartElement("leaf");
+  writer.Attribute("name", docname);
 
   time_t t;
   std::time(&t);
@@ -727,127 +560,70 @@ void Mesh::XMLSave(const char *docname, xmlNode *options) const
   if (eol!=NULL)
     *eol='\0';
 
-  xmlNewProp(root_node, BAD_CAST "date", BAD_CAST tstring);
+  writer.Attribute("date", tstring);
   free(tstring);
 
-
   QString simtime = QString("%1").arg(time);
-  xmlNewProp(root_node, BAD_CAST "simtime", BAD_CAST simtime.toStdString().c_str()); 
-  /*
-   * Creates a DTD declaration. Isn't mandatory. 
-   */
-
-  par.XMLAdd(root_node);
-
-  xmlNodePtr xmlnodes = xmlNewChild(root_node, NULL, BAD_CAST "nodes",NULL);
-  { ostringstream text;
-    text << NNodes();
-    xmlNewProp(xmlnodes, BAD_CAST "n", BAD_CAST text.str().c_str());
-  }
-
-  { ostringstream text;
-    text << Node::target_length;
-    xmlNewProp(xmlnodes, BAD_CAST "target_length", BAD_CAST text.str().c_str());
-  }
+  writer.Attribute("simtime", simtime.toStdString().c_str());
 
-  for (vector<Node *>::const_iterator i=nodes.begin(); i!=nodes.end(); i++) {
-    (*i)->XMLAdd(xmlnodes) ;
-  }
-
-
-  /* 
-   * xmlNewChild() creates a new node, which is "attached" as child node
-   * of root_node node. 
-   */
-  xmlNodePtr xmlcells = xmlNewChild(root_node, NULL, BAD_CAST "cells",NULL);
+  // the parameters are few; build their tree as before, and stream it
   {
-    ostringstream text;
-    text << NCells();
-    xmlNewProp(xmlcells, BAD_CAST "n", BAD_CAST text.str().c_str());
-  }
-  {
-    ostringstream text;
-    text << Cell::offset[0];
-    xmlNewProp(xmlcells, BAD_CAST "offsetx", BAD_CAST text.str().c_str());
-  }
-
-  {
-    ostringstream text;
-    text << Cell::offset[1];
-    xmlNewProp(xmlcells, BAD_CAST "offsety", BAD_CAST text.str().c_str());
+    xmlNodePtr par_root = xmlNewNode(NULL, BAD_CAST "leaf");
+    par.XMLAdd(par_root);
+    for (xmlNode *c = par_root->children; c; c = c->next) {
+      writer.Subtree(c);
+    }
+    xmlFreeNode(par_root);
   }
 
-  {
-    ostringstream text;
-    text << Cell::factor;
-    xmlNewProp(xmlcells, BAD_CAST "magnification", BAD_CAST text.str().c_str());
-  }
+  writer.StartElement("nodes");
+  writer.Attribute("n", NNodes());
+  writer.Attribute("target_length", Node::target_length);
 
-  {
-    ostringstream text;
-    text << cells.front()->BaseArea();
-    xmlNewProp(xmlcells, BAD_CAST "base_area", BAD_CAST text.str().c_str());
+  for (vector<Node *>::const_iterator i=nodes.begin(); i!=nodes.end(); i++) {
+    (*i)->XMLAdd(writer) ;
   }
+  writer.EndElement();
 
-  { 
-    ostringstream text;
-    text << Cell::NChem();
-    xmlNewProp(xmlcells, BAD_CAST "nchem", BAD_CAST text.str().c_str());
-  }
+  writer.StartElement("cells");
+  writer.Attribute("n", NCells());
+  writer.Attribute("offsetx", Cell::offset[0]);
+  writer.Attribute("offsety", Cell::offset[1]);
+  writer.Attribute("magnification", Cell::factor);
+  writer.Attribute("base_area", cells.front()->BaseArea());
+  writer.Attribute("nchem", Cell::NChem());
 
   for (vector<Cell *>::const_iterator i=cells.begin(); i!=cells.end(); i++) {
-    (*i)->XMLAdd(xmlcells) ;
+    (*i)->XMLAdd(writer) ;
   }
 
-  boundary_polygon->XMLAdd(xmlcells);
-
-  xmlNodePtr xmlwalls = xmlNewChild(root_node, NULL, BAD_CAST "walls",NULL);
-  { 
-    ostringstream text;
-    text << walls.size();
-    xmlNewProp(xmlwalls, BAD_CAST "n", BAD_CAST text.str().c_str());
-  }
+  boundary_polygon->XMLAdd(writer);
+  writer.EndElement();
 
+  writer.StartElement("walls");
+  writer.Attribute("n", (long)walls.size());
 
-  for (list<Wall *>::const_iterator i=walls.begin(); i!=walls.end(); i++) {
-    (*i)->XMLAdd(xmlwalls) ;
+  for (SlotMap<Wall>::const_iterator i=walls.begin(); i!=walls.end(); i++) {
+    (*i)->XMLAdd(writer) ;
   }
+  writer.EndElement();
 
+  writer.StartElement("nodesets");
+  writer.Attribute("n", (long)node_sets.size());
 
-  xmlNodePtr xmlnodesets = xmlNewChild(root_node, NULL, BAD_CAST "nodesets",NULL);
-  { 
-    ostringstream text;
-    text << node_sets.size();
-    xmlNewProp(xmlnodesets, BAD_CAST "n", BAD_CAST text.str().c_str());
+  for (vector<NodeSet *>::const_iterator i=node_sets.begin(); i!=node_sets.end(); i++) {
+    (*i)->XMLAdd(writer);
   }
-
-  for_each( node_sets.begin(), node_sets.end(), bind2nd ( mem_fun( &NodeSet::XMLAdd ), xmlnodesets ) );
+  writer.EndElement();
 
   // Add option tree for interactive application
   if (options) {
-    xmlAddChild(root_node, options);
+    writer.Subtree(options);
+    xmlFreeNode(options);
   }
 
-
-  /* 
-   * Dumping document to stdio or file
-   */
-  // Transparent compression seems not to work on Windows. So write uncompressed XML to ensure compatibility of LeafML files.
-  xmlSetDocCompressMode(doc,0);
-  xmlSaveFormatFileEnc(docname, doc, "UTF-8", 1);
-
-  /*free the document */
-  xmlFreeDoc(doc);
-
-  /*
-   *Free the global variables that may
-   *have been allocated by the parser.
-   */
-  xmlCleanupParser();
-
-  /*
-   * this is to debug memory for regression tests
-   */
+  writer.EndElement();
+  writer.EndDocument();
 }
 
 
@@ -884,6 +660,10 @@ void Mesh::XMLReadPars(const xmlNode * a_node)
   xmlNode *root_node;
   root_node = (xmlNode *)a_node;
   par.XMLRead(root_node);
+  if (par.random_generator && !SelectRandomGenerator(par.random_generator)) {
+    MyWarning::unique_warning("Unknown random_generator \"%s\", using %s. Choose knuth or philox.",
+      par.random_generator, SelectedRandomGenerator() == PhiloxGenerator ? "philox" : "knuth");
+  }
   Seed(par.rseed);
   MakeDir(par.datadir);
 }
@@ -977,6 +757,12 @@ void Mesh::XMLReadGeometry(const xmlNode * a_node)
     cur=cur->next;
   }
 
+  XMLConnectGeometry();
+}
+
+// Tie together the nodes, cells and walls that have just been read
+void Mesh::XMLConnectGeometry(void)
+{
   boundary_polygon->ConstructNeighborList();
   boundary_polygon->ConstructConnections();
 
@@ -985,6 +771,9 @@ void Mesh::XMLReadGeometry(const xmlNode * a_node)
     (*c)->ConstructConnections();
   }
 
+  // Recalculate moments and area
+  SetCellIntegrals();
+
   shuffled_cells.clear();
   shuffled_cells = cells;
 
@@ -1097,7 +886,7 @@ void Mesh::XMLReadWalls(xmlNode *root, vector<Wall *> *tmp_walls)
   xmlNode *cur = root;
   cur = cur->xmlChildrenNode;
 
-  for (list<Wall *>::iterator i=walls.begin(); i!=walls.end(); i++) {
+  for (SlotMap<Wall>::iterator i=walls.begin(); i!=walls.end(); i++) {
     delete *i;
   }
 
@@ -1480,7 +1269,11 @@ void Mesh::XMLReadCells(xmlNode *root)
   }
 }
 
-void Mesh::XMLRead(const char *docname, xmlNode **settings, bool geometry, bool pars, bool simtime)
+/*! Read a LeafML file by first parsing it into a document tree; the
+  original loader. XMLRead reads the same files in a single pass, and
+  should be preferred.
+*/
+void Mesh::XMLReadTree(const char *docname, xmlNode **settings, bool geometry, bool pars, bool simtime)
 {
 
   xmlDocPtr doc = xmlParseFile(docname);
@@ -1509,6 +1302,13 @@ void Mesh::XMLRead(const char *docname, xmlNode **settings, bool geometry, bool
   if (geometry) XMLReadGeometry(root_element);
   if (pars) XMLReadPars(root_element);
   if (simtime) XMLReadSimtime(root_element);
+  // LeafML does not store the step size of the stiff solver
+  if (geometry || simtime) {
+    stiff_step = 0.;
+  }
+  if (geometry) {
+    InvalidateEdgeGrid();
+  }
 
   // If pointer settings defined, return a copy of the settings tree
   if (settings) {
@@ -1532,6 +1332,426 @@ void Mesh::XMLRead(const char *docname, xmlNode **settings, bool geometry, bool
 
   // We're doing this so we can manually delete walls with by adding the 'delete="true"' property
   CleanUpCellNodeLists();
+
+  if (geometry) {
+    int n_intersecting = TestSelfIntersections();
+    if (n_intersecting) {
+      MyWarning::unique_warning("%d cell(s) in %s intersect themselves.", n_intersecting, docname);
+    }
+  }
+}
+
+
+/*! Read a LeafML file in a single forward pass (see LeafMLReader).
+  Nodes, cells, walls and node sets are created as their elements go
+  by, in containers reserved from the counts in the file; only the
+  references that point forward in the file (from cells to walls) are
+  resolved at the end; nodes get their node set from the node set's
+  list of nodes, as in XMLReadTree. The result is the
+  same as that of XMLReadTree, including the order in which geometry,
+  parameters and simulation time are taken over, so that runs
+  continue identically.
+*/
+void Mesh::XMLRead(const char *docname, xmlNode **settings, bool geometry, bool pars, bool simtime)
+{
+
+  LeafMLReader reader(docname);
+
+  if (!reader.Next()) {
+    throw("Document not parsed successfully.");
+    return;
+  }
+
+  if (!reader.StartP() || !reader.Is("leaf")) {
+    throw("XML file of the wrong type, it is not a leaf.");
+    return;
+  }
+
+  // the parameters and the simulation time are taken over after the
+  // geometry has been read, as XMLReadTree does, so we collect them
+  // in a small tree of their own
+  xmlNode *root_element = xmlNewNode(NULL, BAD_CAST "leaf");
+  {
+    const char *simtimec = reader.Attribute("simtime");
+    if (simtimec) {
+      xmlNewProp(root_element, BAD_CAST "simtime", BAD_CAST simtimec);
+    }
+  }
+
+  // if settings field is not found, *settings will be returned 0.
+  if (settings) {
+    *settings = 0;
+  }
+
+  vector<int> wall_ind;
+  vector< pair<Cell *, int> > cell_wall_ind;
+  vector<Wall *> tmp_walls;
+
+  int depth = reader.Depth();
+  while (reader.NextChild(depth)) {
+    if (reader.Is("parameter") && pars) {
+      xmlAddChild(root_element, reader.CopySubtree());
+    } else if (reader.Is("settings") && settings) {
+      *settings = reader.CopySubtree();
+    } else if (reader.Is("nodes") && geometry) {
+      XMLStreamNodes(reader);
+    } else if (reader.Is("cells") && geometry) {
+      XMLStreamCells(reader, wall_ind, cell_wall_ind);
+    } else if (reader.Is("walls") && geometry) {
+      XMLStreamWalls(reader, tmp_walls);
+    } else if (reader.Is("nodesets") && geometry) {
+      XMLStreamNodeSets(reader);
+    } else {
+      reader.Skip();
+    }
+  }
+
+  if (reader.Failed()) {
+    xmlFreeNode(root_element);
+    throw("Document not parsed successfully.");
+    return;
+  }
+
+  if (geometry) {
+
+    // read walls to cells and boundary_polygon
+    int nwalls = tmp_walls.size();
+    for (int c=0; c<(int)cell_wall_ind.size(); c++) {
+      int last = c+1 < (int)cell_wall_ind.size() ? cell_wall_ind[c+1].second : wall_ind.size();
+      for (int i=cell_wall_ind[c].second; i<last; i++) {
+	if (wall_ind[i] < 0 || wall_ind[i] >= nwalls) {
+	  MyWarning::error("Cell %d refers to wall %d, but there are %d walls in %s.", cell_wall_ind[c].first->Index(), wall_ind[i], nwalls, docname);
+	}
+	cell_wall_ind[c].first->walls.push_back(tmp_walls[wall_ind[i]]);
+      }
+    }
+
+    XMLConnectGeometry();
+  }
+  if (pars) XMLReadPars(root_element);
+  if (simtime) XMLReadSimtime(root_element);
+  // LeafML does not store the step size of the stiff solver
+  if (geometry || simtime) {
+    stiff_step = 0.;
+  }
+  if (geometry) {
+    InvalidateEdgeGrid();
+  }
+
+  xmlFreeNode(root_element);
+
+  // We're doing this so we can manually delete walls with by adding the 'delete="true"' property
+  CleanUpCellNodeLists();
+
+  if (geometry) {
+    int n_intersecting = TestSelfIntersections();
+    if (n_intersecting) {
+      MyWarning::unique_warning("%d cell(s) in %s intersect themselves.", n_intersecting, docname);
+    }
+  }
+}
+
+// Read a boolean attribute; "dflt" if it is missing
+static bool StreamBool(const LeafMLReader &reader, const char *name, bool dflt = false)
+{
+  const char *v = reader.Attribute(name);
+  if (v==0) {
+    unique_warning("Token \"%s\" not found in <%s>.", name, reader.Name());
+    return dflt;
+  }
+  return strtobool(v);
+}
+
+// Read an integer attribute; "dflt" if it is missing
+static int StreamInt(const LeafMLReader &reader, const char *name, int dflt = 0)
+{
+  const char *v = reader.Attribute(name);
+  if (v==0) {
+    unique_warning("Token \"%s\" not found in <%s>.", name, reader.Name());
+    return dflt;
+  }
+  return atoi(v);
+}
+
+// Read a floating point attribute; "dflt" if it is missing, and a
+// warning if "required"
+static double StreamDouble(const LeafMLReader &reader, const char *name, double dflt = 0., bool required = true)
+{
+  const char *v = reader.Attribute(name);
+  if (v==0) {
+    if (required) {
+      unique_warning("Token \"%s\" not found in <%s>.", name, reader.Name());
+    }
+    return dflt;
+  }
+  return reader.ToDouble(v);
+}
+
+// Read the "val" children of the current element into vals, at most n
+static void StreamValArray(LeafMLReader &reader, double *vals, int n, const char *what)
+{
+  int depth = reader.Depth();
+  int nv=0;
+  while (reader.NextChild(depth)) {
+    if (reader.Is("val")) {
+      if (nv>=n) {
+	unique_warning("Exception in Mesh::XMLRead: Too many %s values given. Ignoring remaining values.", what);
+	reader.Skip();
+	continue;
+      }
+      vals[nv++] = StreamDouble(reader, "v");
+    }
+  }
+}
+
+void Mesh::XMLStreamNodes(LeafMLReader &reader)
+{
+
+  for (vector<Node *>::iterator i=nodes.begin(); i!=nodes.end(); i++) {
+    delete *i;
+  }
+
+  nodes.clear();
+  Node::nnodes=0;
+
+  if (reader.Attribute("target_length")) {
+    Node::target_length = StreamDouble(reader, "target_length");
+  } else {
+    // note that libxml2 also defines a token "warning"
+    MyWarning::unique_warning("Warning: value found in XML file for Node::target_length.");
+  }
+
+  int n = StreamInt(reader, "n");
+  nodes.reserve(n);
+
+  int depth = reader.Depth();
+  while (reader.NextChild(depth)) {
+    if (reader.Is("node")) {
+
+      Node *new_node = new Node(StreamDouble(reader, "x"), StreamDouble(reader, "y"));
+      nodes.push_back(new_node);
+
+      new_node->m = this;
+      new_node->fixed = StreamBool(reader, "fixed");
+      new_node->boundary = StreamBool(reader, "boundary");
+      new_node->sam = StreamBool(reader, "sam");
+      new_node->node_set = 0;
+    }
+  }
+
+  shuffled_nodes.clear();
+  shuffled_nodes = nodes;
+
+  MyUrand r(shuffled_nodes.size());
+  random_shuffle(shuffled_nodes.begin(),shuffled_nodes.end(),r);
+}
+
+void Mesh::XMLStreamCells(LeafMLReader &reader, vector<int> &wall_ind, vector< pair<Cell *, int> > &cell_wall_ind)
+{
+  for (vector<Cell *>::iterator i=cells.begin(); i!=cells.end(); i++) {
+    delete *i;
+  }
+
+  cells.clear();
+  Cell::NCells() = 0;
+
+  if (boundary_polygon) {
+    delete boundary_polygon;
+    boundary_polygon=0;
+  }
+
+  wall_ind.clear();
+  cell_wall_ind.clear();
+
+  {
+    double ox = StreamDouble(reader, "offsetx");
+    double oy = StreamDouble(reader, "offsety");
+    Cell::setOffset(ox, oy);
+    Cell::SetMagnification(StreamDouble(reader, "magnification"));
+    Cell::BaseArea() = StreamDouble(reader, "base_area");
+  }
+
+  int n = StreamInt(reader, "n");
+  cells.reserve(n);
+  cell_wall_ind.reserve(n+1);
+
+  int nnodes = nodes.size();
+  vector<int> tmp_nodes;
+
+  int depth = reader.Depth();
+  while (reader.NextChild(depth)) {
+
+    Cell *new_cell=0;
+
+    if (reader.Is("cell")) {
+      new_cell = new Cell(0,0);
+      new_cell->m = this;
+      cells.push_back(new_cell);
+    } else if (reader.Is("boundary_polygon")) {
+      new_cell = boundary_polygon = new BoundaryPolygon(0,0);
+      boundary_polygon->m = this;
+    } else {
+      reader.Skip();
+      continue;
+    }
+
+    // read cell properties; those that are missing keep their defaults
+    new_cell->area = StreamDouble(reader, "area", new_cell->area);
+    new_cell->target_area = StreamDouble(reader, "target_area", new_cell->target_area);
+    new_cell->target_length = StreamDouble(reader, "target_length", new_cell->target_length);
+    new_cell->lambda_celllength = StreamDouble(reader, "lambda_celllength", new_cell->lambda_celllength);
+    new_cell->stiffness = StreamDouble(reader, "stiffness", new_cell->stiffness);
+    new_cell->fixed = StreamBool(reader, "fixed", new_cell->fixed);
+    new_cell->pin_fixed = StreamBool(reader, "pin_fixed", new_cell->pin_fixed);
+    new_cell->at_boundary = StreamBool(reader, "at_boundary", new_cell->at_boundary);
+    new_cell->dead = StreamBool(reader, "dead", new_cell->dead);
+    new_cell->source = StreamBool(reader, "source", new_cell->source);
+    {
+      const char *v_str = reader.Attribute("boundary");
+      if (v_str==0) {
+	unique_warning("Token \"boundary\" not found in <%s>.", reader.Name());
+      } else {
+	for (int i=0;i<4;i++) {
+	  if (!strcmp(v_str, Cell::boundary_type_names[i])) {
+	    new_cell->boundary=(Cell::boundary_type)i;
+	    break;
+	  }
+	}
+      }
+    }
+    new_cell->div_counter = StreamInt(reader, "div_counter", new_cell->div_counter);
+    new_cell->cell_type = StreamInt(reader, "cell_type", new_cell->cell_type);
+
+    cell_wall_ind.push_back(pair<Cell *, int>(new_cell, wall_ind.size()));
+    tmp_nodes.clear();
+
+    int cell_depth = reader.Depth();
+    while (reader.NextChild(cell_depth)) {
+      if (reader.Is("node")) {
+	int nn = StreamInt(reader, "n");
+	if (nn < 0 || nn >= nnodes) {
+	  MyWarning::error("Cell %d refers to node %d, but there are %d nodes.", new_cell->Index(), nn, nnodes);
+	}
+	tmp_nodes.push_back(nn);
+      } else if (reader.Is("wall")) {
+	wall_ind.push_back(StreamInt(reader, "w"));
+      } else if (reader.Is("chem")) {
+	StreamValArray(reader, new_cell->chem, Cell::NChem(), "chemical");
+      }
+    }
+
+    int ncn = tmp_nodes.size();
+    for (int i=0;i<ncn;i++) {
+      AddNodeToCell( new_cell,
+		     nodes[tmp_nodes[i]],
+		     nodes[tmp_nodes[(ncn+i-1)%ncn]],
+		     nodes[tmp_nodes[(i+1)%ncn]] );
+    }
+  }
+}
+
+void Mesh::XMLStreamWalls(LeafMLReader &reader, vector<Wall *> &tmp_walls)
+{
+
+  for (SlotMap<Wall>::iterator i=walls.begin(); i!=walls.end(); i++) {
+    delete *i;
+  }
+
+  walls.clear();
+  Wall::nwalls = 0;
+  tmp_walls.clear();
+
+  int n = StreamInt(reader, "n");
+  walls.reserve(n);
+  tmp_walls.reserve(n);
+
+  int ncells = cells.size(), nnodes = nodes.size();
+
+  int depth = reader.Depth();
+  while (reader.NextChild(depth)) {
+    if (!reader.Is("wall")) {
+      reader.Skip();
+      continue;
+    }
+
+    int c1 = StreamInt(reader, "c1");
+    int c2 = StreamInt(reader, "c2");
+    int n1 = StreamInt(reader, "n1");
+    int n2 = StreamInt(reader, "n2");
+
+    // the walls refer back to the cells and nodes, which must therefore precede them
+    if (c1 < -1 || c1 >= ncells || c2 < -1 || c2 >= ncells || n1 < 0 || n1 >= nnodes || n2 < 0 || n2 >= nnodes) {
+      MyWarning::error("Wall %d refers to cells %d and %d and nodes %d and %d, but only %d cells and %d nodes were read before it.", (int)tmp_walls.size(), c1, c2, n1, n2, ncells, nnodes);
+    }
+
+    Cell *cc1 = c1 != -1 ? cells[c1] : boundary_polygon;
+    Cell *cc2 = c2 != -1 ? cells[c2] : boundary_polygon;
+
+    Wall *w = new Wall( nodes[n1], nodes[n2], cc1, cc2);
+    w->length = StreamDouble(reader, "length");
+    w->viz_flux = StreamDouble(reader, "viz_flux", 0., false);
+
+    const char *v_str = reader.Attribute("wall_type");
+    if (v_str != 0 && !strcmp(v_str, "aux_source")) {
+      w->wall_type = Wall::AuxSource;
+    } else if (v_str != 0 && !strcmp(v_str, "aux_sink")) {
+      w->wall_type = Wall::AuxSink;
+    } else {
+      w->wall_type = Wall::Normal;
+    }
+
+    // Note: property "delete" is used to manually clean up wall lists in XML files
+    // Simply add property 'delete="true"' to the wall and it will be removed from
+    // the mesh. (This saves us from manually reindexing the file). Otherwise do not use it.
+    v_str = reader.Attribute("delete");
+    w->dead = v_str != 0 && strtobool(v_str);
+
+    tmp_walls.push_back(w);
+    walls.push_back(w);
+
+    int wall_depth = reader.Depth();
+    while (reader.NextChild(wall_depth)) {
+      if (reader.Is("transporters1")) {
+	StreamValArray(reader, w->transporters1, Cell::NChem(), "transporter");
+      } else if (reader.Is("transporters2")) {
+	StreamValArray(reader, w->transporters2, Cell::NChem(), "transporter");
+      }
+    }
+  }
+}
+
+void Mesh::XMLStreamNodeSets(LeafMLReader &reader)
+{
+
+  for (vector<NodeSet *>::iterator i=node_sets.begin(); i!=node_sets.end(); i++) {
+    delete *i;
+  }
+
+  node_sets.clear();
+
+  int nnodes = nodes.size();
+
+  int depth = reader.Depth();
+  while (reader.NextChild(depth)) {
+    if (!reader.Is("nodeset")) {
+      reader.Skip();
+      continue;
+    }
+
+    NodeSet *new_nodeset = new NodeSet();
+    node_sets.push_back(new_nodeset);
+
+    int set_depth = reader.Depth();
+    while (reader.NextChild(set_depth)) {
+      if (reader.Is("node")) {
+	int nn = StreamInt(reader, "n");
+	if (nn < 0 || nn >= nnodes) {
+	  MyWarning::error("Node set %d refers to node %d, but there are %d nodes.", (int)node_sets.size()-1, nn, nnodes);
+	}
+	new_nodeset->AddNode(nodes[nn]);
+      }
+    }
+  }
 }
 
 